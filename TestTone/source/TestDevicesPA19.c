@@ -20,10 +20,18 @@
  * Further information: http://www.audioroot.net/mataa.html
  */
 
+/*
+TestDevices prints the properties of the audio devices used by TestTone: name, host API, number of channels, and the sample rates supported with the different sample formats (half duplex, i.e. only input or only output, and full duplex, i.e. input and output together as opened by TestTone). By default, the default input and output devices are checked, the -i and -o options select other devices in the same way as in TestTone (see ttDevice.h).
+
+Checking the sample rates and formats is slow with some audio devices (and causes relays clicking in others), so MATAA stores the results in a device database and runs the full check only once per device (see mataa_audio_info). For this, TestDevices writes its results in JSON format with the -j option, and only identifies the devices without checking the sample rates and formats with the -l option. Each device is identified by a hash of its host API, name, channel numbers, default sample rate and the PortAudio version (PortAudio does not report the version of the device driver).
+*/
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "portaudio.h"
+#include "ttDevice.h"
 
 #ifdef WIN32
 #ifndef PA_NO_ASIO
@@ -31,67 +39,271 @@
 #endif
 #endif
 
+#define MAX_RATES	64
+
+static double standardSampleRates[] = {
+    8000.0, 9600.0, 11025.0, 12000.0, 16000.0, 22050.0, 24000.0, 32000.0,
+    44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0, 352800.0, 384000.0, -1 /* negative terminated  list */
+};
+
+typedef struct
+{
+    const char		*name;	// name used in the -f option and the JSON output
+    const char		*label;	// description used in the text output
+    PaSampleFormat	format;
+    int			bits;
+}
+SampleFormat;
+
+static const SampleFormat sampleFormats[] = {
+    { "int16",   "16 bit",       paInt16,   16 },
+    { "int24",   "24 bit",       paInt24,   24 },
+    { "int32",   "32 bit",       paInt32,   32 },
+    { "float32", "32 bit float", paFloat32, 32 },
+    { NULL, NULL, 0, 0 }
+};
+
+/*******************************************************************/
+/* Check which of the sample rates are supported with the given stream parameters (NULL if the direction is not used) and sample format.
+** The supported rates are written to 'supported', returns their number. */
+static int ProbeSampleRates(
+        const PaStreamParameters *inputParameters,
+        const PaStreamParameters *outputParameters,
+        PaSampleFormat format, const double *rates, int numRates, double *supported )
+{
+    PaStreamParameters	in, out;
+    int			i, n = 0;
+
+    if( inputParameters ) { in = *inputParameters; in.sampleFormat = format; }
+    if( outputParameters ) { out = *outputParameters; out.sampleFormat = format; }
+    for( i=0; i<numRates; i++ )
+    {
+        if( Pa_IsFormatSupported( inputParameters ? &in : NULL, outputParameters ? &out : NULL, rates[i] ) == paFormatIsSupported )
+            supported[n++] = rates[i];
+    }
+    return n;
+}
+
 /*******************************************************************/
-static void PrintSupportedStandardSampleRates(
+static void PrintSupportedSampleRates(
         const PaStreamParameters *inputParameters,
-        const PaStreamParameters *outputParameters )
+        const PaStreamParameters *outputParameters,
+        PaSampleFormat format, const double *rates, int numRates )
 {
-    static double standardSampleRates[] = {
-        8000.0, 9600.0, 11025.0, 12000.0, 16000.0, 22050.0, 24000.0, 32000.0,
-        44100.0, 48000.0, 88200.0, 96000.0, 192000.0, -1 /* negative terminated  list */
-    };
-    int     i, printCount;
-    PaError err;
-
-    printCount = 0;
-    for( i=0; standardSampleRates[i] > 0; i++ )
+    double	supported[MAX_RATES];
+    int		i, n;
+
+    n = ProbeSampleRates( inputParameters, outputParameters, format, rates, numRates, supported );
+    for( i=0; i<n; i++ )
     {
-        err = Pa_IsFormatSupported( inputParameters, outputParameters, standardSampleRates[i] );
-        if( err == paFormatIsSupported )
+        if( i == 0 )
         {
-            if( printCount == 0 )
-            {
-                printf( "\t%8.2f", standardSampleRates[i] );
-            }
-            else
-            {
-                printf( ", %8.2f", standardSampleRates[i] );
-            }
-			printCount++;
+            printf( "\t%8.2f", supported[i] );
+        }
+        else
+        {
+            printf( ", %8.2f", supported[i] );
         }
     }
-    if( !printCount )
+    if( !n )
         printf( "None\n" );
     else
         printf( "\n" );
 }
+
+/*******************************************************************/
+static void PrintJSONString( const char *s )
+{
+    putchar( '"' );
+    for( ; *s; s++ )
+    {
+        if( *s == '"' || *s == '\\' )
+            printf( "\\%c", *s );
+        else if( (unsigned char) *s < 0x20 )
+            printf( "\\u%04x", (unsigned char) *s );
+        else
+            putchar( *s );
+    }
+    putchar( '"' );
+}
+
+static void PrintJSONRates(
+        const PaStreamParameters *inputParameters,
+        const PaStreamParameters *outputParameters,
+        PaSampleFormat format, const double *rates, int numRates )
+{
+    double	supported[MAX_RATES];
+    int		i, n;
+
+    n = ProbeSampleRates( inputParameters, outputParameters, format, rates, numRates, supported );
+    putchar( '[' );
+    for( i=0; i<n; i++ ) printf( i ? ",%.15g" : "%.15g", supported[i] );
+    putchar( ']' );
+}
+
+/*******************************************************************/
+/* Identifier of a device (64-bit FNV-1a hash of the device properties, as 16 hex digits). */
+static void DeviceID( const PaDeviceInfo *deviceInfo, char *id )
+{
+    char		s[1024];
+    unsigned long long	h = 14695981039346656037ULL;
+    const char		*c;
+
+    snprintf( s, sizeof(s), "%s\n%s\n%d\n%d\n%.15g\n%s", Pa_GetHostApiInfo( deviceInfo->hostApi )->name, deviceInfo->name,
+              deviceInfo->maxInputChannels, deviceInfo->maxOutputChannels, deviceInfo->defaultSampleRate, Pa_GetVersionText() );
+    for( c = s; *c; c++ )
+    {
+        h ^= (unsigned char) *c;
+        h *= 1099511628211ULL;
+    }
+    sprintf( id, "%016llx", h );
+}
+
+/*******************************************************************/
+/* JSON object describing the device of the stream parameters p (input device if isInput != 0, output device otherwise). The other parameters (NULL if there is no other device) are used for the full-duplex rates. */
+static void PrintJSONDevice(
+        const PaStreamParameters *p, const PaStreamParameters *other, int isInput,
+        const int *formats, const double *rates, int numRates, int identifyOnly )
+{
+    const PaDeviceInfo	*deviceInfo = Pa_GetDeviceInfo( p->device );
+    char		id[17];
+    int			k;
+
+    DeviceID( deviceInfo, id );
+    printf( "{\n\t\t\"id\": \"%s\",\n\t\t\"index\": %d,\n\t\t\"name\": ", id, p->device );
+    PrintJSONString( deviceInfo->name );
+    printf( ",\n\t\t\"api\": " );
+    PrintJSONString( Pa_GetHostApiInfo( deviceInfo->hostApi )->name );
+    printf( ",\n\t\t\"channels\": %d,\n\t\t\"defaultSampleRate\": %.15g", p->channelCount, deviceInfo->defaultSampleRate );
+    if( !identifyOnly )
+    {
+        printf( ",\n\t\t\"formats\": [" );
+        for( k=0; formats[k] >= 0; k++ )
+        {
+            printf( "%s\n\t\t\t{ \"format\": \"%s\", \"bits\": %d, \"halfDuplex\": ", k ? "," : "", sampleFormats[formats[k]].name, sampleFormats[formats[k]].bits );
+            PrintJSONRates( isInput ? p : NULL, isInput ? NULL : p, sampleFormats[formats[k]].format, rates, numRates );
+            printf( ", \"fullDuplex\": " );
+            if( other )
+                PrintJSONRates( isInput ? p : other, isInput ? other : p, sampleFormats[formats[k]].format, rates, numRates );
+            else
+                printf( "[]" );
+            printf( " }" );
+        }
+        printf( "\n\t\t]" );
+    }
+    printf( "\n\t}" );
+}
+
+/*******************************************************************/
+static void Usage( void )
+{
+    printf("TestDevices usage:\n");
+    printf("'TestDevices [options]' displays the properties of the audio devices for sound input and output.\n\n");
+    printf("Options:\n");
+    printf("   -i device: check the input device with this number or name (default: default input device, see TestTone for the device selection)\n");
+    printf("   -o device: check the output device with this number or name (default: default output device)\n");
+    printf("   -r rates: comma separated list of the sample rates to be checked (Hz, default: 'standard' rates from 8000 to 384000 Hz)\n");
+    printf("   -f formats: comma separated list of the sample formats to be checked (int16, int24, int32, float32, or 'all'; default: int16, or all formats with -j)\n");
+    printf("   -j: write the results in JSON format\n");
+    printf("   -l: only identify the devices (name, host API, channels and device ID; JSON format), don't check the sample rates and formats\n\n");
+    printf("Note: the list of supported sample rates reflects the rates offered by the operating system or the driver software of the sound device. This is not necessarily identical to the rates supported natively by hardware itself, as the operating system or the driver software may provide automatic sample-rate conversion (e.g. Mac OS X / CoreAudio). Also, the list of supported sample rates may be incomplete, because the TestDevices program checks for 'standard' rates only (unless other rates are given with -r). It is therefore possible that sample rates other than those listed may be used with the device.\n\n");
+    printf("TestDevices is part of MATAA. MATAA is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.\n\n");
+    printf("MATAA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.\n\n");
+    printf("You should have received a copy of the GNU General Public License along with MATAA; if not, write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA\n\n");
+    printf("Copyright (C) 2007, 2008, 2009 Matthias S. Brennwald.\nContact: info@audioroot.net\nFurther information: http://www.audioroot.net/mataa.html\n");
+}
+
 /*******************************************************************/
 int main(int argc, char *argv[]);
 int main(int argc, char *argv[])
 {
-    int     i, numDevices, defaultInputFound, defaultOutputFound;
-    const   PaDeviceInfo *deviceInfo;
-    PaStreamParameters inputParameters, outputParameters;
-    PaError err;
-
-    argc -=1; /* first argument is call to TestTone itself */
-
-    if (argc > 0) {
-		printf("TestDevices usage:\n");
-		printf("'TestDevices' displays the properties of the default audio devices for sound input and output.\n\n");
-		printf("Note: the list of supported sample rates reflects the 'standard' rates offered by the operating system or the driver software of the sound device. This is not necessarily identical to the rates supported natively by hardware itself, as the operating system or the driver software may provide automatic sample-rate conversion (e.g. Mac OS X / CoreAudio). Also, the list of supported sample rates may be incomplete, because the TestDevices program checks for 'standard' rates only. It is therefore possible that sample rates other than those listed may be used with the device.\n\n");
-		printf("TestDevices is part of MATAA. MATAA is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.\n\n");
-		printf("MATAA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.\n\n");
-		printf("You should have received a copy of the GNU General Public License along with MATAA; if not, write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA\n\n");
-		printf("Copyright (C) 2007, 2008, 2009 Matthias S. Brennwald.\nContact: info@audioroot.net\nFurther information: http://www.audioroot.net/mataa.html\n");
-		exit(1);
-	}
-    
-    Pa_Initialize();
+    int			i, k, numDevices, numRates, json = 0, identifyOnly = 0;
+    int			formats[sizeof(sampleFormats)/sizeof(SampleFormat)];
+    double		rates[MAX_RATES];
+    const char		*inputSpec = NULL, *outputSpec = NULL, *formatList = NULL;
+    char		*s, *end, buf[256];
+    PaDeviceIndex	inputDevice, outputDevice;
+    const PaDeviceInfo	*deviceInfo;
+    PaStreamParameters	inputParameters, outputParameters, *in = NULL, *out = NULL;
+    PaError		err;
+
+    argc -=1; /* first argument is call to TestDevices itself */
+    argv++;
+
+    numRates = 0;
+    while( standardSampleRates[numRates] > 0 )
+    {
+        rates[numRates] = standardSampleRates[numRates];
+        numRates++;
+    }
+
+    while( argc > 0 )
+    {
+        if( strcmp(argv[0],"-i") == 0 && argc > 1 ) {
+            inputSpec = argv[1];
+            argc--; argv++;
+        }
+        else if( strcmp(argv[0],"-o") == 0 && argc > 1 ) {
+            outputSpec = argv[1];
+            argc--; argv++;
+        }
+        else if( strcmp(argv[0],"-r") == 0 && argc > 1 ) {
+            numRates = 0;
+            for( s = argv[1]; *s && numRates < MAX_RATES; s = ( *end == ',' ) ? end+1 : end )
+            {
+                rates[numRates] = strtod( s, &end );
+                if( end == s || rates[numRates] <= 0 || ( *end != ',' && *end != '\0' ) ) {
+                    fprintf( stderr, "ERROR: invalid list of sample rates (%s).\n", argv[1] );
+                    exit(1);
+                }
+                numRates++;
+            }
+            argc--; argv++;
+        }
+        else if( strcmp(argv[0],"-f") == 0 && argc > 1 ) {
+            formatList = argv[1];
+            argc--; argv++;
+        }
+        else if( strcmp(argv[0],"-j") == 0 ) {
+            json = 1;
+        }
+        else if( strcmp(argv[0],"-l") == 0 ) {
+            json = identifyOnly = 1;
+        }
+        else {
+            Usage();
+            exit(1);
+        }
+        argc--; argv++;
+    }
+
+    // sample formats to be checked (indices into sampleFormats, terminated by -1):
+    k = 0;
+    if( formatList == NULL )
+        formatList = json ? "all" : "int16";
+    if( strcmp(formatList,"all") == 0 ) {
+        for( k=0; sampleFormats[k].name; k++ ) formats[k] = k;
+    }
+    else {
+        strncpy( buf, formatList, sizeof(buf)-1 );
+        buf[sizeof(buf)-1] = '\0';
+        for( s = strtok( buf, "," ); s; s = strtok( NULL, "," ) )
+        {
+            for( i=0; sampleFormats[i].name && strcmp(sampleFormats[i].name,s) != 0; i++ );
+            if( sampleFormats[i].name == NULL ) {
+                fprintf( stderr, "ERROR: unknown sample format (%s).\n", s );
+                exit(1);
+            }
+            formats[k++] = i;
+        }
+    }
+    formats[k] = -1;
+
+    err = Pa_Initialize();
+    if( err != paNoError ) goto error;
 
     //printf( "PortAudio version number = %d\nPortAudio version text = '%s'\n", Pa_GetVersion(), Pa_GetVersionText() );
 
-            
     numDevices = Pa_GetDeviceCount();
     if( numDevices < 0 )
     {
@@ -99,89 +311,93 @@ int main(int argc, char *argv[])
         err = numDevices;
         goto error;
     }
-    
-	defaultInputFound = 0;
-	defaultOutputFound = 0;
 
-    for( i=0; i<numDevices; i++ )
+    inputDevice = inputSpec ? ttFindDevice( inputSpec, 1 ) : Pa_GetDefaultInputDevice();
+    outputDevice = outputSpec ? ttFindDevice( outputSpec, 0 ) : Pa_GetDefaultOutputDevice();
+    if( ( inputSpec && inputDevice == paNoDevice ) || ( outputSpec && outputDevice == paNoDevice ) )
+    {
+        fprintf( stderr, "ERROR: could not find the %s device '%s'.\n", inputDevice == paNoDevice ? "input" : "output", inputDevice == paNoDevice ? inputSpec : outputSpec );
+        err = paInvalidDevice;
+        goto error;
+    }
+
+    if( inputDevice != paNoDevice && Pa_GetDeviceInfo( inputDevice )->maxInputChannels > 0 )
+    {
+        inputParameters.device = inputDevice;
+        inputParameters.channelCount = Pa_GetDeviceInfo( inputDevice )->maxInputChannels;
+        inputParameters.sampleFormat = paInt16;
+        inputParameters.suggestedLatency = 0; /* ignored by Pa_IsFormatSupported() */
+        inputParameters.hostApiSpecificStreamInfo = NULL;
+        in = &inputParameters;
+    }
+    if( outputDevice != paNoDevice && Pa_GetDeviceInfo( outputDevice )->maxOutputChannels > 0 )
+    {
+        outputParameters.device = outputDevice;
+        outputParameters.channelCount = Pa_GetDeviceInfo( outputDevice )->maxOutputChannels;
+        outputParameters.sampleFormat = paInt16;
+        outputParameters.suggestedLatency = 0; /* ignored by Pa_IsFormatSupported() */
+        outputParameters.hostApiSpecificStreamInfo = NULL;
+        out = &outputParameters;
+    }
+
+    if( json )
+    {
+        printf( "{\n\t\"portaudio\": " );
+        PrintJSONString( Pa_GetVersionText() );
+        printf( ",\n\t\"input\": " );
+        if( in ) PrintJSONDevice( in, out, 1, formats, rates, numRates, identifyOnly );
+        else printf( "null" );
+        printf( ",\n\t\"output\": " );
+        if( out ) PrintJSONDevice( out, in, 0, formats, rates, numRates, identifyOnly );
+        else printf( "null" );
+        printf( "\n}\n" );
+    }
+    else
     {
-        deviceInfo = Pa_GetDeviceInfo( i );
-        //printf( "--------------------------------------- device #%d\n", i );
-                
-        if( i == Pa_GetDefaultInputDevice() )
+        if( in )
         {
-            defaultInputFound = 1;
-			printf( "Default input device = %s\n", deviceInfo->name );
-			printf( "Host API (input) = %s\n",  Pa_GetHostApiInfo( deviceInfo->hostApi )->name );
-			printf( "Max input channels = %d\n", deviceInfo->maxInputChannels  );
-			
-			/* poll for standard sample rates */
-			inputParameters.device = i;
-			inputParameters.channelCount = deviceInfo->maxInputChannels;
-			inputParameters.sampleFormat = paInt16;
-			inputParameters.suggestedLatency = 0; /* ignored by Pa_IsFormatSupported() */
-			inputParameters.hostApiSpecificStreamInfo = NULL;
-			
-			outputParameters.device = i;
-			outputParameters.channelCount = deviceInfo->maxOutputChannels;
-			outputParameters.sampleFormat = paInt16;
-			outputParameters.suggestedLatency = 0; /* ignored by Pa_IsFormatSupported() */
-			outputParameters.hostApiSpecificStreamInfo = NULL;
-			
-			if( inputParameters.channelCount > 0 )
-			{
-				printf("Supported standard sample rates (input, half-duplex, 16 bit, %d channels) = ",
-					   inputParameters.channelCount );
-				PrintSupportedStandardSampleRates( &inputParameters, NULL );
-			}
-			
-			if( inputParameters.channelCount > 0 && outputParameters.channelCount > 0 )
-			{
-				printf("Supported standard sample rates (input, full-duplex, 16 bit, %d channels) = ",
-					   inputParameters.channelCount );
-				PrintSupportedStandardSampleRates( &inputParameters, &outputParameters );
-			}
-		}
-		
-		if( i == Pa_GetDefaultOutputDevice() )
-		{
-			defaultOutputFound = 1;
-			printf( "Default output device = %s\n", deviceInfo->name );
-			printf( "Host API (output) = %s\n",  Pa_GetHostApiInfo( deviceInfo->hostApi )->name );
-			printf( "Max output channels = %d\n", deviceInfo->maxOutputChannels  );
-			
-			/* poll for standard sample rates */
-			inputParameters.device = i;
-			inputParameters.channelCount = deviceInfo->maxInputChannels;
-			inputParameters.sampleFormat = paInt16;
-			inputParameters.suggestedLatency = 0; /* ignored by Pa_IsFormatSupported() */
-			inputParameters.hostApiSpecificStreamInfo = NULL;
-			
-			outputParameters.device = i;
-			outputParameters.channelCount = deviceInfo->maxOutputChannels;
-			outputParameters.sampleFormat = paInt16;
-			outputParameters.suggestedLatency = 0; /* ignored by Pa_IsFormatSupported() */
-			outputParameters.hostApiSpecificStreamInfo = NULL;
-			
-			if( outputParameters.channelCount > 0 )
-			{
-				printf("Supported standard sample rates (output, half-duplex, 16 bit, %d channels) = ",
-					   outputParameters.channelCount );
-				PrintSupportedStandardSampleRates( NULL, &outputParameters );
-			}
-			
-			if( inputParameters.channelCount > 0 && outputParameters.channelCount > 0 )
-			{
-				printf("Supported standard sample rates (output, full-duplex, 16 bit, %d channels) = ",
-					   outputParameters.channelCount );
-				PrintSupportedStandardSampleRates( &inputParameters, &outputParameters );
-			}
-		}
-	}
+            deviceInfo = Pa_GetDeviceInfo( inputDevice );
+            printf( "Default input device = %s\n", deviceInfo->name );
+            printf( "Host API (input) = %s\n",  Pa_GetHostApiInfo( deviceInfo->hostApi )->name );
+            printf( "Max input channels = %d\n", deviceInfo->maxInputChannels  );
+            for( k=0; formats[k] >= 0; k++ )
+            {
+                printf("Supported standard sample rates (input, half-duplex, %s, %d channels) = ",
+                       sampleFormats[formats[k]].label, in->channelCount );
+                PrintSupportedSampleRates( in, NULL, sampleFormats[formats[k]].format, rates, numRates );
+                if( out )
+                {
+                    printf("Supported standard sample rates (input, full-duplex, %s, %d channels) = ",
+                           sampleFormats[formats[k]].label, in->channelCount );
+                    PrintSupportedSampleRates( in, out, sampleFormats[formats[k]].format, rates, numRates );
+                }
+            }
+        }
 
-    Pa_Terminate();
+        if( out )
+        {
+            deviceInfo = Pa_GetDeviceInfo( outputDevice );
+            printf( "Default output device = %s\n", deviceInfo->name );
+            printf( "Host API (output) = %s\n",  Pa_GetHostApiInfo( deviceInfo->hostApi )->name );
+            printf( "Max output channels = %d\n", deviceInfo->maxOutputChannels  );
+            for( k=0; formats[k] >= 0; k++ )
+            {
+                printf("Supported standard sample rates (output, half-duplex, %s, %d channels) = ",
+                       sampleFormats[formats[k]].label, out->channelCount );
+                PrintSupportedSampleRates( NULL, out, sampleFormats[formats[k]].format, rates, numRates );
+                if( in )
+                {
+                    printf("Supported standard sample rates (output, full-duplex, %s, %d channels) = ",
+                           sampleFormats[formats[k]].label, out->channelCount );
+                    PrintSupportedSampleRates( in, out, sampleFormats[formats[k]].format, rates, numRates );
+                }
+            }
+        }
 
-    printf("----------------------------------------------\n");
+        printf("----------------------------------------------\n");
+    }
+
+    Pa_Terminate();
     return 0;
 
 error:
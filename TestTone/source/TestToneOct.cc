@@ -0,0 +1,214 @@
+/*
+ * TestToneOct: play and record audio data from Octave, without temporary files or external processes.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+TestToneOct is an Octave module (.oct file) built from the TestTone source. It plays the test signal directly from an Octave matrix and returns the recorded data as an Octave matrix, using the in-memory engine in ttPlayRec.c: the PortAudio callback reads the samples of the test-signal matrix and writes the recorded samples into the matrix that is returned to Octave. If the test signal is given as a single-precision matrix, its data are used without any conversion or copy. The recorded data are returned in single precision (the sample format of the audio stream).
+
+Compile the module with mkoctfile (see README.txt), e.g.:
+   mkoctfile TestToneOct.cc ttPlayRec.c ttDevice.c ttRingBuffer.c -lportaudio
+and move TestToneOct.oct to a directory in the Octave path (e.g. the TestTone directory of your platform, see mataa_path).
+*/
+
+#include <octave/oct.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "portaudio.h"
+#include "ttDevice.h"
+#include "ttPlayRec.h"
+}
+
+// device given by its index (number) or by (part of) its name (string), default device if empty:
+static PaDeviceIndex
+get_device (const octave_scalar_map& opts, const char *field, int isInput)
+{
+  octave_value v = opts.getfield (field);
+  if (v.is_undefined () || v.isempty ())
+    return isInput ? Pa_GetDefaultInputDevice () : Pa_GetDefaultOutputDevice ();
+  if (v.is_string ())
+    return ttFindDevice (v.string_value ().c_str (), isInput);
+  return ttFindDevice (std::to_string (v.int_value ()).c_str (), isInput);
+}
+
+// zero-based channel map from a vector of one-based channel numbers, all channels if empty. Returns false if a channel number is invalid.
+static bool
+get_channels (const octave_scalar_map& opts, const char *field, int maxChannels, std::vector<unsigned int>& map)
+{
+  octave_value v = opts.getfield (field);
+  map.clear ();
+  if (v.is_undefined () || v.isempty ())
+    {
+      for (int k = 0; k < maxChannels; k++)
+        map.push_back (k);
+      return maxChannels > 0;
+    }
+  NDArray c = v.array_value ();
+  for (octave_idx_type k = 0; k < c.numel (); k++)
+    {
+      if (c(k) < 1 || c(k) > maxChannels || c(k) != std::round (c(k)))
+        return false;
+      map.push_back (static_cast<unsigned int> (c(k)) - 1);
+    }
+  return true;
+}
+
+static double
+get_scalar (const octave_scalar_map& opts, const char *field, double defaultValue)
+{
+  octave_value v = opts.getfield (field);
+  if (v.is_undefined () || v.isempty ())
+    return defaultValue;
+  return v.double_value ();
+}
+
+DEFUN_DLD (TestToneOct, args, ,
+           "-*- texinfo -*-\n\
+@deftypefn {} {[@var{rec}, @var{info}] =} TestToneOct (@var{signal}, @var{fs})\n\
+@deftypefnx {} {[@var{rec}, @var{info}] =} TestToneOct (@var{signal}, @var{fs}, @var{opts})\n\
+Play the test signal @var{signal} (one column per channel) at the sampling rate @var{fs} (Hz) and record the response.\n\
+\n\
+If @var{signal} has less columns than output channels, the last column is also played on the remaining output channels. @var{rec} contains the recorded data (single precision, one column per recorded channel).\n\
+\n\
+@var{opts} is a struct with the following optional fields:\n\
+@table @code\n\
+@item input_device, output_device\n\
+device number or (part of the) device name (default: default devices)\n\
+@item input_channels, output_channels\n\
+channels to be used (vector of channel numbers, default: all channels)\n\
+@item frames_per_buffer\n\
+buffer size of the audio stream (default: 0, let PortAudio decide)\n\
+@item latency\n\
+suggested latency of the audio stream (s, default: default low latency of the devices)\n\
+@item trim\n\
+discard the frames recorded before the test signal arrived (round-trip delay from the time stamps of the audio stream), so that @var{rec} is aligned with @var{signal} (default: false)\n\
+@item record_frames\n\
+number of frames to record (default: number of frames in @var{signal})\n\
+@end table\n\
+\n\
+@var{info} is a struct with the sampling rate, the input and output latency and the round-trip delay of the audio stream (s), the names of the devices, and the flag xrun, which is set if the audio stream reported lost samples.\n\
+@end deftypefn")
+{
+  if (args.length () < 2 || args.length () > 3)
+    print_usage ();
+
+  // test signal (a single-precision matrix is used without copying):
+  const FloatMatrix play = args(0).float_matrix_value ();
+  const double fs = args(1).double_value ();
+  octave_scalar_map opts;
+  if (args.length () > 2)
+    opts = args(2).scalar_map_value ();
+  if (fs <= 0)
+    error ("TestToneOct: invalid sampling rate.");
+  if (play.rows () < 1 || play.columns () < 1)
+    error ("TestToneOct: the test signal is empty.");
+
+  PaError err = Pa_Initialize ();
+  if (err != paNoError)
+    error ("TestToneOct: could not initialize PortAudio (%s).", Pa_GetErrorText (err));
+
+  ttPlayRec pr;
+  memset (&pr, 0, sizeof (pr));
+  std::vector<unsigned int> inputMap, outputMap;
+  std::string msg;
+
+  pr.inputDevice = get_device (opts, "input_device", 1);
+  pr.outputDevice = get_device (opts, "output_device", 0);
+  const PaDeviceInfo *inputInfo = ( pr.inputDevice >= 0 ) ? Pa_GetDeviceInfo (pr.inputDevice) : NULL;
+  const PaDeviceInfo *outputInfo = ( pr.outputDevice >= 0 ) ? Pa_GetDeviceInfo (pr.outputDevice) : NULL;
+  if (inputInfo == NULL)
+    msg = "could not find input device";
+  else if (outputInfo == NULL)
+    msg = "could not find output device";
+  else if (! get_channels (opts, "input_channels", inputInfo->maxInputChannels, inputMap))
+    msg = "invalid input channels (the input device has " + std::to_string (inputInfo->maxInputChannels) + " channels)";
+  else if (! get_channels (opts, "output_channels", outputInfo->maxOutputChannels, outputMap))
+    msg = "invalid output channels (the output device has " + std::to_string (outputInfo->maxOutputChannels) + " channels)";
+  if (! msg.empty ())
+    {
+      Pa_Terminate ();
+      error ("TestToneOct: %s.", msg.c_str ());
+    }
+
+  pr.inputChannelMap = inputMap.data ();
+  pr.numInputChannels = inputMap.size ();
+  pr.outputChannelMap = outputMap.data ();
+  pr.numOutputChannels = outputMap.size ();
+  pr.samplingRate = fs;
+  pr.framesPerBuffer = static_cast<unsigned long> (get_scalar (opts, "frames_per_buffer", 0));
+  pr.suggestedLatency = get_scalar (opts, "latency", -1);
+  pr.trimCapture = get_scalar (opts, "trim", 0) != 0;
+
+  // the callback reads from play and writes to rec directly:
+  pr.play = play.data ();
+  pr.numPlayChannels = play.columns ();
+  pr.numFrames = play.rows ();
+  pr.recordFrames = static_cast<unsigned long> (get_scalar (opts, "record_frames", pr.numFrames));
+  FloatMatrix rec (pr.recordFrames, pr.numInputChannels, 0.0f);
+  pr.rec = rec.fortran_vec ();
+
+  err = ttPlayRecOpen (&pr);
+  if (err == paNoError)
+    err = ttPlayRecStart (&pr);
+  if (err != paNoError)
+    {
+      ttPlayRecClose (&pr);
+      Pa_Terminate ();
+      error ("TestToneOct: could not start the audio stream (%s).", Pa_GetErrorText (err));
+    }
+
+  // wait for the recording, stop the stream if the user interrupts (Ctrl-C):
+  try
+    {
+      while (! ttPlayRecIsDone (&pr))
+        {
+          Pa_Sleep (1);
+          octave_quit ();
+        }
+    }
+  catch (...)
+    {
+      ttPlayRecClose (&pr);
+      Pa_Terminate ();
+      throw;
+    }
+
+  err = ttPlayRecClose (&pr);
+  octave_scalar_map info;
+  info.setfield ("fs", fs);
+  info.setfield ("inputLatency", pr.inputLatency);
+  info.setfield ("outputLatency", pr.outputLatency);
+  info.setfield ("delay", pr.delay);
+  info.setfield ("trimmed", pr.trimCapture != 0);
+  info.setfield ("xrun", pr.xrun != 0);
+  info.setfield ("inputDevice", inputInfo->name);
+  info.setfield ("outputDevice", outputInfo->name);
+  Pa_Terminate ();
+  if (err != paNoError)
+    warning ("TestToneOct: error while closing the audio stream (%s).", Pa_GetErrorText (err));
+  if (pr.xrun)
+    warning ("TestToneOct: the audio stream reported an input overflow or output underflow, samples may have been lost.");
+
+  return ovl (rec, info);
+}
@@ -32,34 +32,243 @@ console> TestTone testSignal.in > testSignal.out
 
 console> TestTone  > testSignal.out
 (As above, but without specifying an input signal. A default signal is generated by TestTone)
+
+console> TestTone -b 96000 testSignal.bin > testSignal.out
+(as above, but the recorded data are written in the binary TestTone format described below. The input file may be a text file or a binary TestTone file, and '-' reads the input signal from STDIN.)
+
+Binary TestTone format (same layout for input and output, native byte order of the machine running TestTone):
+   offset  0: 8 bytes   magic string "MATAAF32"
+   offset  8: uint32    size of the header in bytes (data start at this offset)
+   offset 12: uint32    number of channels
+   offset 16: uint64    number of frames
+   offset 24: float64   sampling rate (Hz, 0 if unknown)
+   offset 32: float64   input latency of the sound stream (s, output files only, 0 if unknown)
+   offset 40: float64   output latency of the sound stream (s, output files only, 0 if unknown)
+   offset 48: float64   round-trip delay of the sound I/O (s, output files only, see below)
+   offset 56: uint32    number of averaged periods (output files only, see below)
+   offset 60: uint32    flags (output files only): 1 = the level statistics are valid, 2 = the recording was aborted because of clipping (see below)
+   offset 64: float64   noise RMS of a single period, one value for each channel (output files only, see below)
+   offset 64+8*numChannels: float64   level statistics of the recorded data (output files only, see below): peak level (maximum absolute sample value), RMS level, DC offset (mean) and number of clipped samples, numChannels values each (all peak levels first, then all RMS levels, etc.)
+   offset 64+40*numChannels: float32   samples, interleaved (frame by frame, one sample per channel)
+Input files may use the short 32-byte header without the fields for the recorded data.
+Readers must use the header-size field to find the start of the data, so that fields may be appended to the header in later versions.
+
+console> TestTone -S /tmp/mataa_TestTone 96000
+(runs TestTone as a server with the sound stream kept open, see below)
+
+console> TestTone -b -d "RTX6001" -c 1,2 -C 1,2 -f 512 -l 0.02 96000 testSignal.bin > testSignal.out
+(uses the device 'RTX6001' for input and output, records input channels 1 and 2 only, plays the test signal on output channels 1 and 2, uses 512 frames per buffer and a suggested latency of 20 ms. The actual input and output latencies of the stream are reported in the header of the output data.)
+
+console> TestTone -b -t -L 2 96000 testSignal.bin > testSignal.out
+(as above, but the recorded data are trimmed to the test-signal window: the first recorded frame corresponds to the first frame of the test signal.)
+
+console> TestTone -b -t -A 16 96000 testSignal.bin > testSignal.out
+(plays the test signal 16 times back to back, and returns the average of the 16 recorded periods.)
+
+Synchronized averaging: with the -A K option, TestTone plays the test signal K times without gaps in the same sound stream, and the writer thread accumulates the recorded periods frame by frame into a running mean (and the running sum of squared deviations from the mean, Welford's method). Only the averaged period is written, together with the noise RMS of a single period for each channel (the RMS deviation of the recorded periods from their mean). The memory needed does not depend on K. With the -w option, the test signal is played once more before the K periods, and the response to this warm-up period is discarded (useful for periodic test signals such as MLS, where the first period contains the transient response to the start of the signal). Without the -t option, the recorded periods are not aligned with the test signal, but with the start of the playback (all periods are shifted by the same round-trip delay).
+
+Level statistics: the callback keeps the minimum and maximum, the sum and the sum of squares of the recorded samples, and the number of clipped samples (absolute value of at least the clip level given with -k, default 0.99) for each input channel, while the samples of each buffer are still in the cache. This covers all frames recorded while the test signal is played (including the round-trip delay and, with -A, all periods before averaging), so no separate scan of the recorded data is needed. The peak level, RMS level, DC offset and number of clipped samples of each recorded channel are printed at the end of the recording (text output: as comment lines after the data), and are written to the header of binary output. The header is written before the recorded data, so the level statistics are filled in after the recording by seeking back to the header; if the output cannot be repositioned (e.g. a pipe), the flag in the header remains 0. With the -x option, the recording is stopped as soon as a recorded channel clips, the rest of the recorded data is padded with zeros, and this is indicated by the flags in the header (or a warning for text output). Thus, a long measurement with a clipped signal can be repeated immediately with a lower level instead of waiting for its end.
+
+Round-trip delay: TestTone determines the delay between playing a frame of the test signal and recording it from the time stamps PortAudio passes to the callback with the first buffer of the test signal (outputBufferDacTime - inputBufferAdcTime, or the sum of the input and output latencies of the stream if the host API does not provide time stamps). If a loopback input channel is given (-L option), the delay is instead determined from the onset of the test signal in the loopback channel, which also accounts for the delay of the converters. The delay is reported in the header of the recorded data. With the -t option, TestTone keeps recording after the end of the test signal until the delayed signal has been recorded completely, and discards the frames recorded before the test signal arrived, so that the recorded data are aligned with the test signal.
+
+TestTone streams the data: a reader thread reads (or generates) the test signal and feeds it to the PortAudio callback through a lock-free ring buffer, and a writer thread takes the recorded samples from a second ring buffer and writes them to STDOUT while the recording is still running. The memory used by TestTone therefore does not depend on the length of the test signal.
+
+Server mode (not available on Windows): with the -S option, TestTone initializes PortAudio and opens the sound stream once, and then plays / records one test signal per request. Requests are sent through the named pipe (FIFO) <base>.req, the replies are returned through the named pipe <base>.rsp, and the process ID and the sampling rate of the server are written to <base>.pid (<base> is the path given with the -S option). A request is a single line of text:
+   PLAY<TAB>input-file<TAB>output-file[<TAB>K]   plays the test signal in input-file (text or binary) and writes the recorded data to output-file (binary). If K is given, the test signal is played K times, and the average is written (see -A option).
+   QUIT                                  stops the server
+The server answers each request with a single line, either "OK" or "ERROR: <message>". While no request is being processed, the server plays silence and discards the recorded data, so the next measurement starts within one buffer period.
+
+console> TestTone -R /tmp/mataa_analyser -c 1 -F 8192 -A 4 -e 96000 testSignal.bin
+(runs TestTone as a real-time spectrum analyser, see below)
+
+Spectrum analyser mode (not available on Windows): with the -R option, TestTone records continuously and plays the test signal in a loop (or silence if no test signal is given). The recorded data are analysed with Hann-windowed FFTs of -F frames, overlapping by the fraction given with -V, while the callback keeps copying the recorded data to the input ring buffer, so no samples are lost if the analysis is slow for a moment. The power spectra are averaged linearly in blocks of K spectra (-A K), or exponentially with a time constant of K spectra (-e), and a peak hold of the individual spectra is kept. The averaged and peak-hold amplitude spectra are published to the file <base>.spc every -u seconds (written to a temporary file and renamed, so that a reader never sees a partial spectrum; see ttSpectrum.h for the format). The process ID and the sampling rate are written to <base>.pid, and the analyser runs until it receives SIGINT or SIGTERM.
+
+With -T in addition to -R, the analyser estimates the transfer function from the first to the second recorded channel (e.g. '-c 2,1' for the reference channel 2 and the response channel 1) instead of the spectra: the auto and cross spectra of all FFTs since the start are averaged (Welch method), and the H1 and H2 estimates and the coherence are published to <base>.tfe (see ttTransfer.h). The estimates improve continuously while the excitation (noise or a chirp given as the test signal) is played, so the reader can stop the analyser as soon as the coherence is good enough.
+
+console> TestTone -H 20,20000,30 -a 0.5 -N 5 -F 8192 -A 2 -c 1 -C 1 96000 > sweep.txt
+(measures the harmonic distortion of 30 sine tones from 20 Hz to 20 kHz, see below)
+
+Stepped-sine sweep mode: with the -H f1,f2,n option, TestTone plays n sine tones with logarithmically spaced frequencies from f1 to f2 (amplitude -a) back to back in one sound stream, and determines the fundamental, the harmonics up to -N, THD and THD+N of the first recorded channel for each tone (see ttSineSweep.h). The tones are generated by the reader thread while the previous tones are played. The recorded frames are aligned with the tones using the round-trip delay from the time stamps, and each tone is analysed as soon as its response has settled (settle detection on the fly, maximum settling time -s) and -A blocks of -F frames were recorded. The FFTs of a tone are computed by an analysis thread while the next tone is recorded, so the measurement takes about as long as the sum of the tone durations. The results are written to STDOUT as text, one line per tone (columns: frequency (Hz), amplitude of the fundamental, THD, THD+N, settling time (s), settled (1) or not (0), amplitudes of the harmonics 2...N; amplitudes are zero-to-peak values in digital full scale, THD and THD+N are ratios relative to the fundamental).
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <limits.h>
 #include "portaudio.h"
+#include "ttRingBuffer.h"
+#include "ttSpectrum.h"
+#include "ttDevice.h"
+#include "ttSineSweep.h"
+#include "ttTransfer.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
 
 #define PI		(3.141592653589793)
 #define PA_SAMPLE_TYPE  paFloat32
 
+#define TT_BINARY_MAGIC		"MATAAF32"
+#define TT_BINARY_HEADERSIZE_MIN	32	// header size of files without latency information (test signals written by MATAA)
+#define TT_BINARY_HEADERSIZE_LATENCY	48	// header size of files with latency but without delay information
+#define TT_BINARY_HEADERSIZE_DELAY	56	// header size of files with delay but without averaging information
+#define TT_BINARY_HEADERSIZE	64	// size of the fixed part of the header (followed by the noise RMS and the level statistics of each channel)
+#define TT_BINARY_LEVELS	4	// level statistics per channel in the header (peak, RMS, DC, clipped samples)
+
+#define TT_DEFAULT_FRAMES_PER_BUFFER	256
+
+#define TT_CHUNK_FRAMES		1024	// number of frames handled at a time by the reader and writer threads
+#define TT_RING_SECONDS		1.0	// minimum duration of the audio data held in the ring buffers
+#define TT_TRIM_MARGIN_SECONDS	0.05	// extra recording time after the delayed test signal if the capture is trimmed (allows for converter delays not included in the time stamps)
+#define TT_LOOPBACK_THRESHOLD	0.05	// onset of the test signal (and its loopback) is the first sample exceeding this level
+#define TT_CLIP_LEVEL		0.99	// default clip level (-k option)
+
+#define TT_BINARY_FLAG_LEVELS	1	// flags in the binary header: level statistics are valid
+#define TT_BINARY_FLAG_ABORTED	2	// recording was stopped because of clipping
+
+#define TT_SOURCE_SINE		0	// default signal (1 kHz sine)
+#define TT_SOURCE_TEXT		1	// CSV text file
+#define TT_SOURCE_BINARY	2	// binary TestTone file
+#define TT_SOURCE_SWEEP		3	// stepped-sine sweep (generated, see ttSineSweep.h)
+
+#ifdef _WIN32
+typedef HANDLE		ttThread;
+#define TT_THREAD_FUNC(f)	unsigned __stdcall f( void *arg )
+#define TT_THREAD_RETURN	return 0
+#else
+typedef pthread_t	ttThread;
+#define TT_THREAD_FUNC(f)	void *f( void *arg )
+#define TT_THREAD_RETURN	return NULL
+#endif
+
 typedef float		SAMPLE;
 
 typedef struct
 {
-    unsigned long	numFrames;
-    unsigned long	processedFrames;
-    unsigned int	numInputDeviceChannels;
-    unsigned int	numOutputDeviceChannels;
+    unsigned int	headerSize;
+    unsigned int	numChannels;
+    unsigned long long	numFrames;
+    double		samplingRate;
+    double		inputLatency;
+    double		outputLatency;
+    double		delay;
+    unsigned int	numAverages;
+    unsigned int	flags;			// TT_BINARY_FLAG_xxx
+    const double	*noise;			// numChannels values (NULL: not available)
+    const double	*levels;		// TT_BINARY_LEVELS*numChannels values, in blocks of numChannels (NULL: not available)
+}
+ttBinaryHeader;
+
+typedef struct
+{
+    int			type;			// TT_SOURCE_xxx
+    FILE		*file;
+    unsigned int	numChannels;		// number of channels in the test signal
+    long		dataOffset;		// file position of the first frame (used to rewind the file for repeated playback)
+    float		frequency;		// frequency of the default signal
+    const ttSineSweep	*sweep;			// stepped-sine sweep
+}
+ttSource;
+
+typedef struct
+{
+    unsigned long	numFrames;		// frames in the test signal (one period)
+    unsigned long	numAverages;		// number of recorded periods averaged (1: no averaging)
+    int			warmup;			// play one additional period before the averaged periods, and discard its response
+    unsigned long	playFrames;		// frames played by the callback (numFrames * (numAverages + warmup))
+    unsigned long	recordFrames;		// frames recorded by the callback (playFrames, plus the delay and margin if the capture is trimmed; set by the callback with the first buffer)
+    unsigned long	processedFrames;	// frames handled by the callback (only modified by the callback)
+    unsigned long	trimMarginFrames;	// extra frames recorded after the delayed test signal if the capture is trimmed
+    int			continuous;		// record until stopped (spectrum analyser), the test signal is played in a loop
+    unsigned int	numInputDeviceChannels;	// number of channels opened on the input device
+    unsigned int	numOutputDeviceChannels;	// number of channels opened on the output device
+    unsigned int	numInputChannels;	// number of input channels recorded (channels listed in inputChannelMap)
+    unsigned int	numOutputChannels;	// number of output channels used for the test signal (channels listed in outputChannelMap)
+    unsigned int	*inputChannelMap;	// device channels to be recorded (zero-based)
+    unsigned int	*outputChannelMap;	// device channels used for the test signal (zero-based)
     float		samplingRate;
-    SAMPLE		*inputSamples;
-    SAMPLE		*outputSamples;
+    double		inputLatency;		// latencies reported by Pa_GetStreamInfo
+    double		outputLatency;
+    int			trimCapture;		// discard the frames recorded before the test signal arrived, and record until the delayed signal is complete
+    int			loopbackChannel;	// input device channel carrying a loopback of the test signal (zero-based), -1 if none
+    volatile long	streamDelayFrames;	// round-trip delay from the time stamps of the first buffer (set by the callback)
+    volatile int	delayKnown;		// set by the callback after streamDelayFrames was determined
+    volatile long	signalOnset;		// first frame of the test signal exceeding TT_LOOPBACK_THRESHOLD (set by the reader thread), -1 if not known
+    long		captureDelay;		// round-trip delay used for the recorded data (set by the writer thread)
+    double		*noise;			// noise RMS of a single period for each recorded channel (set by the writer thread if numAverages > 1)
+    float		clipLevel;		// recorded samples with an absolute value of at least clipLevel are counted as clipped
+    int			abortOnClip;		// stop the recording as soon as a recorded channel clips
+    volatile int	clipAbort;		// set by the callback if the recording was stopped because of clipping
+    float		*levelMin, *levelMax;	// minimum and maximum of the recorded samples of each input device channel (updated by the callback)
+    double		*levelSum, *levelSumSq;	// sum and sum of squares of the recorded samples of each input device channel
+    unsigned long	*clipCount;		// number of clipped samples of each input device channel
+    unsigned long	levelFrames;		// number of frames in the level statistics
+    double		*levels;		// level statistics of the recorded channels (TT_BINARY_LEVELS*numInputChannels, see WriteLevels)
+    ttRingBuffer	outputRing;		// test signal: reader thread --> callback
+    ttRingBuffer	inputRing;		// recorded data: callback --> writer thread
+    volatile int	running;		// set when a test signal is ready to be played, cleared by the callback after the last frame
+    volatile int	outputUnderflow;	// set by the callback if the reader thread did not keep up
+    volatile int	inputOverflow;		// set by the callback if the writer thread did not keep up
+    volatile int	callbackFinished;	// set by the callback after the last frame
+    volatile int	readerDone;		// set by the reader thread when it is done (successfully or not)
+    volatile int	readerError;		// set by the reader thread if the test signal could not be read
+    volatile int	writerError;		// set by the writer thread if the recorded data could not be written
+    ttSource		source;
+    int			binaryOutput;
+    FILE		*outFile;		// where to write the recorded data
+    FILE		*msg;			// where to print information and error messages
 }
 paTestData, *paTestDataPtr;
 
+/* Add n frames of recorded data (numInputDeviceChannels samples per frame) to the level statistics. Called by the callback while the samples are in the cache.
+** Each channel is accumulated in local variables, and the minimum and maximum are branch-free, so that the compiler can keep the accumulators in registers and vectorise the loop.
+*/
+static void UpdateLevels( paTestData *data, const SAMPLE *in, unsigned long n )
+{
+    unsigned int	nDev = data->numInputDeviceChannels;
+    unsigned int	iChannel;
+    unsigned long	k, clip;
+    float		x, lo, hi, c = data->clipLevel;
+    double		sum, sumSq;
+    
+    for ( iChannel = 0; iChannel < nDev; iChannel++ ) {
+		lo = data->levelMin[iChannel];
+		hi = data->levelMax[iChannel];
+		sum = sumSq = 0;
+		clip = 0;
+		for ( k = 0; k < n; k++ ) {
+			x = in[k*nDev+iChannel];
+			lo = ( x < lo ) ? x : lo;
+			hi = ( x > hi ) ? x : hi;
+			sum += x;
+			sumSq += x*x;
+			clip += ( x >= c ) | ( x <= -c );
+		}
+		data->levelMin[iChannel] = lo;
+		data->levelMax[iChannel] = hi;
+		data->levelSum[iChannel] += sum;
+		data->levelSumSq[iChannel] += sumSq;
+		data->clipCount[iChannel] += clip;
+	}
+    data->levelFrames += n;
+}
+
 /* This routine will be called by the PortAudio engine when audio is needed.
 ** It may be called at interrupt level on some machines so don't do anything
 ** that could mess up the system like calling malloc() or free().
+** The callback only moves data from / to the ring buffers, which were allocated and touched before the stream was started.
+** While no test signal is being played (data->running == 0), the callback plays silence and discards the recorded data. This keeps the stream open in between the measurements of the TestTone server.
 */
 static int RecordAndPlayCallback(
                             const void *inputBuffer,
@@ -69,18 +278,36 @@ static int RecordAndPlayCallback(
 							PaStreamCallbackFlags statusFlags,
                             void *userData )
 {
-    unsigned long iF,iFmax,remainingFrames,iC;
+    unsigned long iFmax,remainingFrames,outFrames,n,nOut,nIn,avail;
+    unsigned int iChannel;
     paTestData* data;
     int finished;
+    double delay;
     
 /* Cast data passed through stream to our structure. */
     data = (paTestDataPtr)userData;
+    (void) statusFlags; /* Prevent unused variable warnings. */
     
-/* Handle sound output buffer */
-    SAMPLE *out = (SAMPLE*)outputBuffer;
-    //(void) outTime; /* Prevent unused variable warnings. */
-    //(void) inputBuffer;
-    remainingFrames = data->numFrames - data->processedFrames;
+    if ( !data->running ) {
+		memset( outputBuffer, 0, framesPerBuffer*data->numOutputDeviceChannels*sizeof(SAMPLE) );
+		return paContinue;
+	}
+    ttMemoryBarrier(); // make sure the job data set up before data->running are visible
+    
+    if ( data->processedFrames == 0 ) {
+		// first buffer of the test signal: the first output frame reaches the DAC at outputBufferDacTime, the first input frame was sampled by the ADC at inputBufferAdcTime
+		delay = outTime->outputBufferDacTime - outTime->inputBufferAdcTime;
+		if ( outTime->outputBufferDacTime <= 0 || outTime->inputBufferAdcTime <= 0 || delay <= 0 ) {
+			delay = data->inputLatency + data->outputLatency; // no time stamps from the host API
+		}
+		data->streamDelayFrames = (long) (delay*data->samplingRate + 0.5);
+		data->recordFrames = data->continuous ? ULONG_MAX : data->playFrames;
+		if ( data->trimCapture && !data->continuous ) data->recordFrames += data->streamDelayFrames + data->trimMarginFrames;
+		ttMemoryBarrier();
+		data->delayKnown = 1;
+	}
+    
+    remainingFrames = data->recordFrames - data->processedFrames;
     if (remainingFrames > framesPerBuffer)
     {
         iFmax=framesPerBuffer;
@@ -91,25 +318,1288 @@ static int RecordAndPlayCallback(
         iFmax=remainingFrames;
         finished=1;
     }
+
+/* Handle sound output buffer (the test signal may end before the recording if the capture is trimmed) */
+    SAMPLE *out = (SAMPLE*)outputBuffer;
+    outFrames = ( data->processedFrames < data->playFrames ) ? data->playFrames - data->processedFrames : 0;
+    if ( outFrames > iFmax ) outFrames = iFmax;
+    nOut = outFrames * data->numOutputDeviceChannels;
+    avail = ttRingBufferGetReadAvailable( &data->outputRing );
+    if ( avail < nOut ) { // the reader thread did not keep up: play whole frames only, so that the silence below starts at a frame boundary
+		nOut = avail - avail % data->numOutputDeviceChannels;
+		data->outputUnderflow = 1;
+	}
+    n = ttRingBufferRead( &data->outputRing, out, nOut );
+    memset( out+n, 0, (framesPerBuffer*data->numOutputDeviceChannels-n)*sizeof(SAMPLE) ); // silence after the end of the signal (or if the reader did not keep up)
+
+/* Handle sound input buffer */
+    const SAMPLE *in = (const SAMPLE*)inputBuffer;
+    nIn = iFmax * data->numInputDeviceChannels;
+    if ( in == NULL ) {
+		data->inputOverflow = 1; // no input data, should not happen
+	}
+	else {
+		avail = ttRingBufferGetWriteAvailable( &data->inputRing );
+		if ( avail < nIn ) { // the writer thread did not keep up: keep whole frames only, so that the channels of the following frames stay in place
+			nIn = avail - avail % data->numInputDeviceChannels;
+			data->inputOverflow = 1;
+		}
+		ttRingBufferWrite( &data->inputRing, in, nIn );
+		UpdateLevels( data, in, iFmax );
+		if ( data->abortOnClip && !data->continuous ) { // stop if a recorded channel clips
+			for ( iChannel = 0; iChannel < data->numInputChannels; iChannel++ ) {
+				if ( data->clipCount[data->inputChannelMap[iChannel]] > 0 ) {
+					data->clipAbort = 1;
+					finished = 1;
+				}
+			}
+		}
+	}
+    
+/* Prepare for next callback-cycle: */    
+    data->processedFrames += iFmax;
+    if (finished) {
+		data->running = 0;
+		ttMemoryBarrier();
+		data->callbackFinished = 1;
+	}
+
+return paContinue;
+}
+
+
+/* Read the header of a binary TestTone file. Returns 0 on success, -1 if the file is not in binary TestTone format or the header is broken.
+** On success, the file position is at the start of the sample data.
+*/
+static int ReadBinaryHeader( FILE *f, ttBinaryHeader *h )
+{
+    char magic[8];
+    unsigned int u32;
+    
+    if ( fread(magic,1,8,f) != 8 ) return -1;
+    if ( memcmp(magic,TT_BINARY_MAGIC,8) != 0 ) return -1;
+    if ( fread(&h->headerSize,4,1,f) != 1 ) return -1;
+    if ( fread(&h->numChannels,4,1,f) != 1 ) return -1;
+    if ( fread(&h->numFrames,8,1,f) != 1 ) return -1;
+    if ( fread(&h->samplingRate,8,1,f) != 1 ) return -1;
+    if ( h->headerSize < TT_BINARY_HEADERSIZE_MIN || h->numChannels < 1 ) return -1;
+    h->inputLatency = h->outputLatency = h->delay = 0;
+    u32 = TT_BINARY_HEADERSIZE_MIN;
+    if ( h->headerSize >= TT_BINARY_HEADERSIZE_LATENCY ) {
+		if ( fread(&h->inputLatency,8,1,f) != 1 ) return -1;
+		if ( fread(&h->outputLatency,8,1,f) != 1 ) return -1;
+		u32 = TT_BINARY_HEADERSIZE_LATENCY;
+	}
+    if ( h->headerSize >= TT_BINARY_HEADERSIZE_DELAY ) {
+		if ( fread(&h->delay,8,1,f) != 1 ) return -1;
+		u32 = TT_BINARY_HEADERSIZE_DELAY;
+	}
+    
+    // skip header fields appended by later versions of the format:
+    for ( ; u32 < h->headerSize; u32++ ) {
+		if ( fgetc(f) == EOF ) return -1;
+	}
+    return 0;
+}
+
+/* Write the header of a binary TestTone file. Returns 0 on success, -1 on failure. */
+static int WriteBinaryHeader( FILE *f, const ttBinaryHeader *h )
+{
+    unsigned int k;
+    double noise, level;
+    
+    if ( fwrite(TT_BINARY_MAGIC,1,8,f) != 8 ) return -1;
+    if ( fwrite(&h->headerSize,4,1,f) != 1 ) return -1;
+    if ( fwrite(&h->numChannels,4,1,f) != 1 ) return -1;
+    if ( fwrite(&h->numFrames,8,1,f) != 1 ) return -1;
+    if ( fwrite(&h->samplingRate,8,1,f) != 1 ) return -1;
+    if ( fwrite(&h->inputLatency,8,1,f) != 1 ) return -1;
+    if ( fwrite(&h->outputLatency,8,1,f) != 1 ) return -1;
+    if ( fwrite(&h->delay,8,1,f) != 1 ) return -1;
+    if ( fwrite(&h->numAverages,4,1,f) != 1 ) return -1;
+    if ( fwrite(&h->flags,4,1,f) != 1 ) return -1;
+    for ( k = 0; k < h->numChannels; k++ ) {
+		noise = h->noise ? h->noise[k] : 0;
+		if ( fwrite(&noise,8,1,f) != 1 ) return -1;
+	}
+    for ( k = 0; k < TT_BINARY_LEVELS*h->numChannels; k++ ) {
+		level = h->levels ? h->levels[k] : 0;
+		if ( fwrite(&level,8,1,f) != 1 ) return -1;
+	}
+    return 0;
+}
+
+/* Switch a stream to binary mode (only needed on Windows, where STDIN and STDOUT are opened in text mode). */
+static void SetBinaryMode( FILE *f )
+{
+#ifdef _WIN32
+    _setmode( _fileno(f), _O_BINARY );
+#else
+    (void) f;
+#endif
+}
+
+static int StartThread( ttThread *thread, TT_THREAD_FUNC((*func)), void *arg )
+{
+#ifdef _WIN32
+    *thread = (HANDLE) _beginthreadex( NULL, 0, func, arg, 0, NULL );
+    return ( *thread == 0 ) ? -1 : 0;
+#else
+    return pthread_create( thread, NULL, func, arg ) ? -1 : 0;
+#endif
+}
+
+static void JoinThread( ttThread thread )
+{
+#ifdef _WIN32
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+#else
+    pthread_join( thread, NULL );
+#endif
+}
+
+/* Read (or generate) the frames startFrame...startFrame+n-1 of the test signal into buf (numChannels samples per frame).
+** Returns 0 on success, -1 on failure.
+*/
+static int ReadSourceFrames( paTestData *data, SAMPLE *buf, unsigned long startFrame, unsigned long n )
+{
+    ttSource		*src = &data->source;
+    unsigned long	iFrame,iChannel;
+    char		s[1000];
+    char		*u;
+    
+    switch ( src->type ) {
+		case TT_SOURCE_SINE:
+			for (iFrame=0; iFrame<n; iFrame++) buf[iFrame]=sin((float)(iFrame+startFrame)/data->samplingRate*src->frequency*2.0*PI);
+			return 0;
+			
+		case TT_SOURCE_SWEEP:
+			ttSineSweepGenerate(src->sweep,buf,startFrame,n);
+			return 0;
+			
+		case TT_SOURCE_BINARY:
+			if ( fread(buf,sizeof(SAMPLE),n*src->numChannels,src->file) != n*src->numChannels ) {
+				fprintf(data->msg,"ERROR: input file is truncated (expected %lu frames).\n",data->numFrames);
+				return -1;
+			}
+			return 0;
+			
+		case TT_SOURCE_TEXT:
+			for (iFrame = 0; iFrame < n; iFrame++) {
+				iChannel = 0;
+				if (fgets(s,1000,src->file) == NULL) {
+					fprintf(data->msg,"ERROR: could not read input file on line %lu.\n",iFrame+startFrame);
+					return -1;
+				}
+				u = strtok(s,",");
+				while (iChannel < src->numChannels) {
+					if (!u) {
+						fprintf(data->msg,"ERROR: could not read input file on line %lu.\n",iFrame+startFrame);
+						return -1;
+					}
+					buf[ src->numChannels*iFrame + iChannel ]=atof(u);
+					iChannel++;
+					u = strtok(NULL,",");
+				}
+			}
+			return 0;
+	}
+    return -1;
+}
+
+/* Go back to the first frame of the test signal (for repeated playback). Returns 0 on success, -1 on failure. */
+static int RewindSource( paTestData *data )
+{
+    if ( data->source.type == TT_SOURCE_SINE || data->source.type == TT_SOURCE_SWEEP ) return 0;
+    if ( data->source.file == stdin || fseek( data->source.file, data->source.dataOffset, SEEK_SET ) != 0 ) {
+		fprintf(data->msg,"ERROR: could not rewind the input file for repeated playback.\n");
+		return -1;
+	}
+    return 0;
+}
+
+/* Reader thread: reads the test signal, maps it to the output channels of the sound device, and feeds it to the callback through the output ring buffer. */
+static TT_THREAD_FUNC(ReaderThread)
+{
+    paTestData		*data = (paTestData *) arg;
+    SAMPLE		*srcBuf = NULL, *devBuf = NULL;
+    int			*srcChannel = NULL;	// test-signal channel played on each device channel (-1: silence)
+    unsigned long	iFrame,iPeriodFrame,n,k,nSamples;
+    unsigned int	iDev,iOut;
+    
+    srcBuf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*data->source.numChannels*sizeof(SAMPLE) );
+    devBuf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*data->numOutputDeviceChannels*sizeof(SAMPLE) );
+    srcChannel = (int *) malloc( data->numOutputDeviceChannels*sizeof(int) );
+    if ( !srcBuf || !devBuf || !srcChannel ) {
+		fprintf(data->msg,"ERROR: could not allocate memory for test data\n");
+		data->readerError = 1;
+		goto done;
+	}
+    
+    // map the test signal to the output channels (if the test signal has less channels than used on the output device, the last channel of the test signal is copied to the remaining channels):
+    for ( iDev = 0; iDev < data->numOutputDeviceChannels; iDev++ ) srcChannel[iDev] = -1;
+    for ( iOut = 0; iOut < data->numOutputChannels; iOut++ ) {
+		srcChannel[data->outputChannelMap[iOut]] = ( iOut < data->source.numChannels ) ? (int)iOut : (int)data->source.numChannels-1;
+	}
+    
+    for ( iFrame = 0; iFrame < data->playFrames; iFrame += n ) {
+		iPeriodFrame = iFrame % data->numFrames; // frame within the current period of the test signal
+		if ( iPeriodFrame == 0 && iFrame > 0 && RewindSource(data) != 0 ) { // start of the next period
+			data->readerError = 1;
+			goto done;
+		}
+		n = data->numFrames - iPeriodFrame;
+		if ( n > TT_CHUNK_FRAMES ) n = TT_CHUNK_FRAMES;
+		
+		if ( ReadSourceFrames(data,srcBuf,iPeriodFrame,n) != 0 ) {
+			data->readerError = 1;
+			goto done;
+		}
+		
+		// find the onset of the test signal (needed to determine the delay from the loopback channel):
+		if ( data->loopbackChannel >= 0 && data->signalOnset < 0 ) {
+			for ( k = 0; k < n*data->source.numChannels; k++ ) {
+				if ( fabs(srcBuf[k]) > TT_LOOPBACK_THRESHOLD ) {
+					data->signalOnset = iFrame + k/data->source.numChannels;
+					break;
+				}
+			}
+		}
 		
-    for( iF=0; iF<iFmax; iF++ )
+		for ( k = 0; k < n; k++ ) {
+			for ( iDev = 0; iDev < data->numOutputDeviceChannels; iDev++ ) {
+				devBuf[k*data->numOutputDeviceChannels+iDev] = ( srcChannel[iDev] < 0 ) ? 0 : srcBuf[k*data->source.numChannels+srcChannel[iDev]];
+			}
+		}
+		
+		// wait for space in the ring buffer:
+		nSamples = n*data->numOutputDeviceChannels;
+		k = 0;
+		while ( k < nSamples ) {
+			k += ttRingBufferWrite( &data->outputRing, devBuf+k, nSamples-k );
+			if ( k < nSamples ) Pa_Sleep(1);
+			if ( data->callbackFinished ) goto done; // stream was stopped
+		}
+	}
+
+done:
+    free(srcBuf);
+    free(devBuf);
+    free(srcChannel);
+    data->readerDone = 1;
+    TT_THREAD_RETURN;
+}
+
+/* Print the information on the recording and write the header of the recorded data to the output file. Returns 0 on success, -1 on failure. */
+static int WriteOutputHeader( paTestData *data )
+{
+    ttBinaryHeader	header;
+    unsigned long	iChannel;
+    
+    fprintf(data->msg,"%% Number of frames = %lu\n", data->numFrames);
+    fprintf(data->msg,"%% Number of sound output channels = %d\n", data->numOutputChannels);
+    fprintf(data->msg,"%% Number of sound input channels = %d\n", data->numInputChannels);
+    fprintf(data->msg,"%% Sampling rate = %f Hz\n", data->samplingRate);
+    fprintf(data->msg,"%% Input latency = %f s\n", data->inputLatency);
+    fprintf(data->msg,"%% Output latency = %f s\n", data->outputLatency);
+    fprintf(data->msg,"%% Round-trip delay = %f s (%ld frames, %s)\n", data->captureDelay/data->samplingRate, data->captureDelay, ( data->loopbackChannel >= 0 ) ? "loopback" : "time stamps" );
+    if ( data->trimCapture ) fprintf(data->msg,"%% Recorded data trimmed to the test signal\n");
+    if ( data->numAverages > 1 ) {
+		fprintf(data->msg,"%% Number of averaged periods = %lu\n", data->numAverages);
+		fprintf(data->msg,"%% Noise RMS of a single period =");
+		for ( iChannel = 0; iChannel < data->numInputChannels; iChannel++ ) fprintf(data->msg," %E", data->noise ? data->noise[iChannel] : 0.0);
+		fprintf(data->msg,"\n");
+	}
+	
+	if (data->binaryOutput) {
+		header.headerSize = TT_BINARY_HEADERSIZE + 8*(1+TT_BINARY_LEVELS)*data->numInputChannels;
+		header.numChannels = data->numInputChannels;
+		header.numFrames = data->numFrames;
+		header.samplingRate = data->samplingRate;
+		header.inputLatency = data->inputLatency;
+		header.outputLatency = data->outputLatency;
+		header.delay = data->captureDelay/data->samplingRate;
+		header.numAverages = data->numAverages;
+		header.flags = 0; // the level statistics are filled in after the recording (see WriteLevels)
+		header.noise = data->noise;
+		header.levels = NULL;
+		if ( WriteBinaryHeader(data->outFile,&header) != 0 ) {
+			fprintf(data->msg,"ERROR: could not write recorded data.\n");
+			return -1;
+		}
+	}
+	else {
+		fprintf(data->outFile,"%%\n");
+		fprintf(data->outFile,"%% Recorded data:\n"),
+		fprintf(data->outFile,"%% time (s)\t");
+		for( iChannel=0; iChannel < data->numInputChannels; iChannel++)
+		{
+			fprintf(data->outFile,"channel-%u ",data->inputChannelMap[iChannel]+1);
+		}
+		fprintf(data->outFile,"\n");
+	}
+	return 0;
+}
+
+/* Pick the recorded channels listed in the input channel map from m frames of device data (numInputDeviceChannels samples per frame, m <= TT_CHUNK_FRAMES).
+** Returns buf if no channels need to be dropped or reordered, or recBuf with the recorded channels.
+*/
+static const SAMPLE *PickInputChannels( paTestData *data, const SAMPLE *buf, unsigned long m, SAMPLE *recBuf )
+{
+    unsigned long	iChannel,k;
+    unsigned int	nIn = data->numInputChannels;
+    unsigned int	nDev = data->numInputDeviceChannels;
+    int			mapInput = 0;
+    
+    // the device channels are opened up to the highest channel in the map or the loopback channel only:
+    if ( nIn != nDev ) mapInput = 1;
+    for ( iChannel = 0; iChannel < nIn; iChannel++ ) {
+		if ( data->inputChannelMap[iChannel] != iChannel ) mapInput = 1;
+	}
+    if ( !mapInput ) return buf;
+    
+    for ( k = 0; k < m; k++ ) {
+		for ( iChannel = 0; iChannel < nIn; iChannel++ ) {
+			recBuf[k*nIn+iChannel] = buf[k*nDev+data->inputChannelMap[iChannel]];
+		}
+	}
+    return recBuf;
+}
+
+/* Write m frames of recorded data (numInputChannels samples per frame) to the output file. iFrame is the index of the first frame. Returns 0 on success, or -1 (and sets data->writerError) if the data could not be written. */
+static int WriteRecordedFrames( paTestData *data, const SAMPLE *rec, unsigned long m, unsigned long iFrame )
+{
+    unsigned long	iChannel,k;
+    unsigned int	nIn = data->numInputChannels;
+    
+    if ( data->binaryOutput ) {
+		if ( fwrite( rec, sizeof(SAMPLE), m*nIn, data->outFile ) != m*nIn ) goto error;
+		return 0;
+	}
+    for( k=0; k<m; k++ )
     {
-        for( iC=0; iC < data->numOutputDeviceChannels; iC++ ) {
-			*out++ = data->outputSamples[(iF+data->processedFrames)*data->numOutputDeviceChannels+iC];
+		fprintf(data->outFile,"%E",(float)(iFrame+k) / data->samplingRate); // print frame sampling time
+		for( iChannel = 0; iChannel < nIn; iChannel++ )
+		{
+			fprintf(data->outFile,"\t%E",rec[k*nIn+iChannel]);
+		}
+		fprintf(data->outFile,"\n");
+	}
+    if ( ferror(data->outFile) ) goto error;
+    return 0;
+    
+error:
+    fprintf(data->msg,"ERROR: could not write the recorded data to the output file.\n");
+    data->writerError = 1;
+    return -1;
+}
+
+/* Handle n recorded frames (numInputDeviceChannels samples per frame), starting at frame 'captured' of the capture: write them to the output file, or add them to the running mean and sum of squared deviations (avgMean, avgM2) if periods are averaged.
+** recBuf must have space for TT_CHUNK_FRAMES frames of numInputChannels samples. Returns the number of frames used (stops after numFrames * numAverages frames, or if the frames could not be written to the output file).
+*/
+static unsigned long StoreFrames( paTestData *data, const SAMPLE *buf, unsigned long n, SAMPLE *recBuf, unsigned long captured, double *avgMean, double *avgM2 )
+{
+    unsigned long	total = data->numFrames * data->numAverages;
+    unsigned long	k,m,i,iChannel,done = 0;
+    unsigned long	iFrame,count;
+    unsigned int	nIn = data->numInputChannels;
+    const SAMPLE	*rec;
+    double		delta;
+    
+    if ( n > total - captured ) n = total - captured;
+    while ( done < n ) {
+		m = n - done;
+		if ( m > TT_CHUNK_FRAMES ) m = TT_CHUNK_FRAMES;
+		rec = PickInputChannels( data, buf+done*data->numInputDeviceChannels, m, recBuf );
+		
+		if ( data->numAverages <= 1 ) {
+			if ( WriteRecordedFrames( data, rec, m, captured+done ) != 0 ) return done;
+		}
+		else { // Welford's method, in place
+			for ( k = 0; k < m; k++ ) {
+				iFrame = (captured+done+k) % data->numFrames;
+				count = (captured+done+k) / data->numFrames + 1; // number of periods including this one
+				for ( iChannel = 0; iChannel < nIn; iChannel++ ) {
+					i = iFrame*nIn + iChannel;
+					delta = rec[k*nIn+iChannel] - avgMean[i];
+					avgMean[i] += delta / count;
+					avgM2[i] += delta * ( rec[k*nIn+iChannel] - avgMean[i] );
+				}
+			}
+		}
+		done += m;
+	}
+    return n;
+}
+
+/* Writer thread: takes the recorded data from the input ring buffer and writes them to the output file. Stops after all frames were written, or if the stream is finished and no more data is available.
+** The header of the recorded data is written once the round-trip delay is known (from the time stamps of the first buffer, or from the loopback channel). If the capture is trimmed, the frames recorded before the test signal arrived are discarded.
+** If periods are averaged, the recorded periods are accumulated, and the header and the averaged period are written after the last period.
+*/
+static TT_THREAD_FUNC(WriterThread)
+{
+    paTestData		*data = (paTestData *) arg;
+    SAMPLE		*buf = NULL, *recBuf = NULL, *pending = NULL;
+    double		*avgMean = NULL, *avgM2 = NULL;
+    unsigned long	k,n,skip,iChannel;
+    unsigned long	captured = 0, nPending = 0, maxPending = 0;
+    unsigned long	total = data->numFrames * data->numAverages;
+    unsigned int	nDev = data->numInputDeviceChannels;
+    unsigned int	nIn = data->numInputChannels;
+    long		onset = -1;
+    int			finished;
+    
+    buf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*nDev*sizeof(SAMPLE) );
+    recBuf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*nIn*sizeof(SAMPLE) );
+    if ( data->loopbackChannel >= 0 ) { // frames held back until the test signal was found in the loopback channel
+		maxPending = data->inputRing.size / nDev;
+		pending = (SAMPLE *) malloc( maxPending*nDev*sizeof(SAMPLE) );
+	}
+    if ( data->numAverages > 1 ) { // running mean and sum of squared deviations of one period
+		avgMean = (double *) calloc( data->numFrames*nIn, sizeof(double) );
+		avgM2 = (double *) calloc( data->numFrames*nIn, sizeof(double) );
+	}
+    if ( !buf || !recBuf || ( data->loopbackChannel >= 0 && !pending ) || ( data->numAverages > 1 && ( !avgMean || !avgM2 ) ) ) {
+		fprintf(data->msg,"ERROR: could not allocate input frames buffer.\n");
+		data->writerError = 1;
+		goto done;
+	}
+    
+    // wait for the first buffer of the test signal:
+    while ( !data->delayKnown && !data->callbackFinished ) Pa_Sleep(1);
+    ttMemoryBarrier();
+    data->captureDelay = data->streamDelayFrames;
+    
+    // find the onset of the test signal in the loopback channel:
+    if ( data->loopbackChannel >= 0 ) {
+		while ( onset < 0 && nPending < maxPending ) {
+			finished = data->callbackFinished;
+			n = ttRingBufferGetReadAvailable( &data->inputRing ) / nDev;
+			if ( n > maxPending - nPending ) n = maxPending - nPending;
+			if ( n == 0 ) {
+				if ( finished ) break;
+				Pa_Sleep(1);
+				continue;
+			}
+			ttRingBufferRead( &data->inputRing, pending+nPending*nDev, n*nDev );
+			for ( k = nPending; k < nPending+n; k++ ) {
+				if ( fabs(pending[k*nDev+data->loopbackChannel]) > TT_LOOPBACK_THRESHOLD ) {
+					onset = k;
+					break;
+				}
+			}
+			nPending += n;
+		}
+		ttMemoryBarrier();
+		if ( onset >= 0 && data->signalOnset >= 0 && onset >= data->signalOnset ) {
+			data->captureDelay = onset - data->signalOnset;
+		}
+		else {
+			fprintf(data->msg,"%% *** Warning: could not find the test signal in the loopback channel, using the delay reported by the sound device.\n");
+		}
+	}
+    
+    if ( data->numAverages <= 1 && WriteOutputHeader( data ) != 0 ) {
+		data->writerError = 1;
+		goto done;
+	}
+    
+    skip = data->trimCapture ? (unsigned long) data->captureDelay : 0;
+    if ( data->warmup ) skip += data->numFrames; // response to the warm-up period
+    
+    // frames held back while looking for the loopback signal:
+    if ( nPending > skip ) {
+		captured += StoreFrames( data, pending+skip*nDev, nPending-skip, recBuf, captured, avgMean, avgM2 );
+		skip = 0;
+	}
+    else {
+		skip -= nPending;
+	}
+    
+    while ( captured < total && !data->writerError ) {
+		finished = data->callbackFinished; // check before reading, so no data written by the callback will be missed
+		n = ttRingBufferGetReadAvailable( &data->inputRing ) / nDev;
+		if ( n > TT_CHUNK_FRAMES ) n = TT_CHUNK_FRAMES;
+		if ( n == 0 ) {
+			if ( finished ) break;
+			Pa_Sleep(1);
+			continue;
 		}
+		ttRingBufferRead( &data->inputRing, buf, n*nDev );
+		
+		if ( skip >= n ) { // recorded before the test signal arrived
+			skip -= n;
+			continue;
+		}
+		captured += StoreFrames( data, buf+skip*nDev, n-skip, recBuf, captured, avgMean, avgM2 );
+		skip = 0;
+	}
+    
+    if ( captured < total && !data->writerError && ( data->clipAbort || ( data->trimCapture && data->processedFrames >= data->recordFrames ) ) ) {
+		// recording stopped because of clipping, or the delay found in the loopback channel exceeds the extra recording time:
+		if ( !data->clipAbort ) fprintf(data->msg,"%% *** Warning: the end of the recorded data was padded with %lu zero frames (round-trip delay longer than expected).\n",total-captured);
+		memset( buf, 0, TT_CHUNK_FRAMES*nDev*sizeof(SAMPLE) );
+		while ( captured < total && !data->writerError ) {
+			n = total - captured;
+			if ( n > TT_CHUNK_FRAMES ) n = TT_CHUNK_FRAMES;
+			captured += StoreFrames( data, buf, n, recBuf, captured, avgMean, avgM2 );
+		}
+	}
+    
+    if ( data->numAverages > 1 ) {
+		if ( captured < total ) { // stopped early
+			data->writerError = 1;
+			goto done;
+		}
+		
+		// noise RMS of a single period (RMS deviation of the periods from their mean):
+		for ( iChannel = 0; iChannel < nIn; iChannel++ ) {
+			data->noise[iChannel] = 0;
+			for ( k = 0; k < data->numFrames; k++ ) data->noise[iChannel] += avgM2[k*nIn+iChannel];
+			data->noise[iChannel] = sqrt( data->noise[iChannel] / ( (double)data->numFrames * (data->numAverages-1) ) );
+		}
+		
+		if ( WriteOutputHeader( data ) != 0 ) {
+			data->writerError = 1;
+			goto done;
+		}
+		for ( captured = 0; captured < data->numFrames; captured += n ) {
+			n = data->numFrames - captured;
+			if ( n > TT_CHUNK_FRAMES ) n = TT_CHUNK_FRAMES;
+			for ( k = 0; k < n*nIn; k++ ) recBuf[k] = avgMean[captured*nIn+k];
+			if ( WriteRecordedFrames( data, recBuf, n, captured ) != 0 ) goto done;
+		}
+	}
+    
+done:
+    fflush(data->outFile);
+    free(buf);
+    free(recBuf);
+    free(pending);
+    free(avgMean);
+    free(avgM2);
+    TT_THREAD_RETURN;
+}
+
+
+/* Prepare the test signal source: open the input file (path), or use the default signal if path == NULL. The test-signal data are read later by the reader thread.
+** Returns 0 on success, -1 on failure.
+*/
+static int OpenSource( paTestData *data, const char *path )
+{
+    char		s[1000];
+    char		*u = NULL;
+    FILE		*inFile;
+    FILE		*msg = data->msg;
+    ttBinaryHeader	header;
+    
+    memset( &data->source, 0, sizeof(data->source) );
+    
+    if ( path == NULL ) { // no input file is given, use some default signal instead
+        fprintf(msg,"%% No input file given! Using default signal instead: 1 kHz sine, 1 sec duration\n");
+		data->source.type = TT_SOURCE_SINE;
+		data->source.numChannels = 1;
+		data->source.frequency = 1000.0; // frequency of test tone 
+        data->numFrames=data->samplingRate; // determines signal duration
+		if (data->samplingRate <= 2*data->source.frequency) {
+			fprintf(msg,"%% *** Warning: Nyquist frequency too low because sampling rate is too low!\n");
+		}
+		return 0;
     }
 
-/* Handle sound input buffer */
-    SAMPLE *in = (SAMPLE*)inputBuffer;
-    for( iF=0; iF<iFmax; iF++ )
+    if ( strcmp(path,"-") == 0 ) {
+		fprintf(msg,"%% Input file: (STDIN)\n");
+		SetBinaryMode(stdin);
+		inFile = stdin;
+	}
+	else {
+		fprintf(msg,"%% Input file: %s\n", path);
+		inFile=fopen(path,"rb");
+	}
+    if (!inFile) {
+		fprintf(msg,"ERROR: could not open the input file.\n");
+		return -1;
+	}
+	data->source.file = inFile;
+	
+	if ( ReadBinaryHeader(inFile,&header) == 0 ) { // binary TestTone file
+		data->source.type = TT_SOURCE_BINARY;
+		data->source.dataOffset = ( inFile == stdin ) ? 0 : ftell( inFile );
+		data->source.numChannels = header.numChannels;
+		data->numFrames = header.numFrames;
+		fprintf(msg,"%% Input file format: binary\n");
+		if ( header.samplingRate > 0 && header.samplingRate != data->samplingRate ) {
+			fprintf(msg,"%% *** Warning: sampling rate of input file (%f Hz) differs from the requested sampling rate (%f Hz)!\n",header.samplingRate,data->samplingRate);
+		}
+	}
+	else { // text file
+		if ( inFile == stdin ) {
+			fprintf(msg,"ERROR: reading text data from STDIN is not supported, use the binary TestTone format.\n");
+			return -1;
+		}
+		data->source.type = TT_SOURCE_TEXT;
+		
+		// get number of input signal frames:
+		fseek(inFile,0,SEEK_SET); // go back to the beginning of the file
+		data->numFrames=0;
+		while (fgets(s,1000,inFile)!=NULL) {
+			data->numFrames +=1;
+		}
+		
+		// get number of data channels in input file:
+		fseek(inFile,0,SEEK_SET); // go back to the beginning of the file
+		if ( fgets(s,1000,inFile) == NULL ) { // read first line of the input file
+			fprintf(msg,"ERROR: the input file is empty.\n");
+			return -1;
+		}
+		// find and count delimiters:
+		u = strtok(s,",");
+		while( u != NULL) {
+			data->source.numChannels++;
+			u = strtok(NULL,",");
+		}
+		fseek(inFile,0,SEEK_SET); // go back to the beginning of the file
+	}
+	fprintf(msg,"%% Number of data channels in input file = %d\n", data->source.numChannels);
+
+	if ( data->source.numChannels > data->numOutputChannels ) {
+		fprintf(msg,"ERROR: the input file has more channels (%d) than used on the sound output device (%d).\n",data->source.numChannels,data->numOutputChannels);
+		return -1;
+	}
+	return 0;
+}
+
+static void CloseSource( paTestData *data )
+{
+    if ( data->source.file && data->source.file != stdin ) fclose( data->source.file );
+    data->source.file = NULL;
+}
+
+/* Reset the job state before playing a new test signal (the callback does not touch the ring buffers or the job data while data->running == 0). */
+static void ResetJob( paTestData *data )
+{
+    ttRingBufferFlush( &data->outputRing );
+    ttRingBufferFlush( &data->inputRing );
+    data->processedFrames = 0;
+    data->outputUnderflow = 0;
+    data->inputOverflow = 0;
+    data->callbackFinished = 0;
+    data->readerDone = 0;
+    data->readerError = 0;
+    data->writerError = 0;
+    data->playFrames = data->numFrames * ( data->numAverages + data->warmup );
+    data->recordFrames = data->playFrames;
+    data->streamDelayFrames = 0;
+    data->delayKnown = 0;
+    data->signalOnset = -1;
+    data->captureDelay = 0;
+    data->continuous = 0;
+    data->clipAbort = 0;
+    data->levelFrames = 0;
+    memset( data->levelMin, 0, data->numInputDeviceChannels*sizeof(float) );
+    memset( data->levelMax, 0, data->numInputDeviceChannels*sizeof(float) );
+    memset( data->levelSum, 0, data->numInputDeviceChannels*sizeof(double) );
+    memset( data->levelSumSq, 0, data->numInputDeviceChannels*sizeof(double) );
+    memset( data->clipCount, 0, data->numInputDeviceChannels*sizeof(unsigned long) );
+}
+
+/* Start the reader thread and wait until the output ring buffer is full (or the whole signal was read). Returns 0 on success, -1 on failure. */
+static int StartReader( paTestData *data, ttThread *readerThread )
+{
+	if ( StartThread( readerThread, ReaderThread, data ) != 0 ) {
+		fprintf(data->msg,"ERROR: could not start reader thread.\n");
+		return -1;
+	}
+	while ( !data->readerDone && ttRingBufferGetWriteAvailable(&data->outputRing) >= TT_CHUNK_FRAMES*data->numOutputDeviceChannels ) {
+		Pa_Sleep(1);
+	}
+	if ( data->readerError ) {
+		JoinThread( *readerThread );
+		return -1;
+	}
+	return 0;
+}
+
+/* Report the level statistics of the recorded channels after the recording: print them, and fill them into the header of binary output (if the output file can be repositioned). Returns 0 on success, -1 on failure. */
+static int WriteLevels( paTestData *data )
+{
+    unsigned int	nIn = data->numInputChannels;
+    unsigned int	iChannel, iDev, flags;
+    double		*peak = data->levels, *rms = peak+nIn, *dc = rms+nIn, *clipped = dc+nIn;
+    long		pos;
+    FILE		*f = data->outFile;
+    
+    for ( iChannel = 0; iChannel < nIn; iChannel++ ) {
+		iDev = data->inputChannelMap[iChannel];
+		peak[iChannel] = ( -data->levelMin[iDev] > data->levelMax[iDev] ) ? -data->levelMin[iDev] : data->levelMax[iDev];
+		rms[iChannel] = data->levelFrames ? sqrt( data->levelSumSq[iDev] / data->levelFrames ) : 0;
+		dc[iChannel] = data->levelFrames ? data->levelSum[iDev] / data->levelFrames : 0;
+		clipped[iChannel] = data->clipCount[iDev];
+	}
+    
+    if ( data->clipAbort ) fprintf(data->msg,"%% *** Warning: recording stopped because of clipping, the rest of the recorded data was padded with zeros.\n");
+    fprintf(data->msg,"%% Peak level =");
+    for ( iChannel = 0; iChannel < nIn; iChannel++ ) fprintf(data->msg," %E", peak[iChannel]);
+    fprintf(data->msg,"\n%% RMS level =");
+    for ( iChannel = 0; iChannel < nIn; iChannel++ ) fprintf(data->msg," %E", rms[iChannel]);
+    fprintf(data->msg,"\n%% DC offset =");
+    for ( iChannel = 0; iChannel < nIn; iChannel++ ) fprintf(data->msg," %E", dc[iChannel]);
+    fprintf(data->msg,"\n%% Clipped samples (level %g) =", data->clipLevel);
+    for ( iChannel = 0; iChannel < nIn; iChannel++ ) fprintf(data->msg," %.0f", clipped[iChannel]);
+    fprintf(data->msg,"\n");
+    
+    if ( !data->binaryOutput ) return 0;
+    fflush( f );
+    pos = ftell( f );
+    if ( pos < 0 || fseek( f, 60, SEEK_SET ) != 0 ) return 0; // not seekable, keep the flags at 0
+    flags = TT_BINARY_FLAG_LEVELS | ( data->clipAbort ? TT_BINARY_FLAG_ABORTED : 0 );
+    if ( fwrite(&flags,4,1,f) != 1
+      || fseek( f, TT_BINARY_HEADERSIZE + 8*nIn, SEEK_SET ) != 0
+      || fwrite(data->levels,8,TT_BINARY_LEVELS*nIn,f) != TT_BINARY_LEVELS*nIn
+      || fseek( f, pos, SEEK_SET ) != 0 ) {
+		fprintf(data->msg,"ERROR: could not write the level statistics to the header of the recorded data.\n");
+		return -1;
+	}
+    return 0;
+}
+
+/* Play the test signal from data->source and record the response through the running stream. Returns 0 on success, -1 on failure. */
+static int RunJob( paTestData *data, PaStream *stream )
+{
+    ttThread	readerThread, writerThread;
+    int		status = 0;
+    
+    if ( ( data->numAverages > 1 || data->warmup ) && data->source.file == stdin ) {
+		fprintf(data->msg,"ERROR: repeated playback of a test signal read from STDIN is not supported.\n");
+		return -1;
+	}
+    
+    ResetJob( data );
+    
+	// start the reader thread and wait until the output ring buffer is full (or the whole signal was read):
+	if ( StartReader( data, &readerThread ) != 0 ) return -1;
+	
+	if ( StartThread( &writerThread, WriterThread, data ) != 0 ) {
+		fprintf(data->msg,"ERROR: could not start writer thread.\n");
+		data->callbackFinished = 1;
+		JoinThread( readerThread );
+		return -1;
+	}
+	
+	// tell the callback to start playing / recording with the next buffer:
+	ttMemoryBarrier();
+	data->running = 1;
+	
+    while( !data->callbackFinished )
     {
-        for( iC=0; iC<data->numInputDeviceChannels; iC++ ) data->inputSamples[(iF+data->processedFrames)*data->numInputDeviceChannels+iC]=*in++;
+        Pa_Sleep(1); // sleep while audio I/O
+        if ( data->readerError || data->writerError ) break;
+        if ( Pa_IsStreamActive( stream ) != 1 ) {
+			fprintf(data->msg,"ERROR: the sound stream stopped unexpectedly.\n");
+			status = -1;
+			break;
+		}
     }
+    if ( !data->callbackFinished ) { // stop early
+		data->running = 0;
+		Pa_Sleep(100); // make sure the callback is done with the current buffer
+		data->callbackFinished = 1; // make sure the reader and writer threads terminate
+	}
     
-/* Prepare for next callback-cycle: */    
-    data->processedFrames += iFmax;
+    JoinThread( readerThread );
+    JoinThread( writerThread );
+    
+    if ( data->readerError || data->writerError ) return -1;
+    if ( data->outputUnderflow ) {
+		fprintf(data->msg,"ERROR: the test signal could not be read fast enough (output buffer underflow).\n");
+		return -1;
+	}
+    if ( data->inputOverflow ) {
+		fprintf(data->msg,"ERROR: the recorded data could not be written fast enough (input buffer overflow).\n");
+		return -1;
+	}
+    if ( status == 0 && WriteLevels( data ) != 0 ) {
+		data->writerError = 1;
+		return -1;
+	}
+    return status;
+}
+
+#ifndef _WIN32
+static volatile sig_atomic_t serverQuit = 0;
+
+static void ServerSignalHandler( int sig )
+{
+    (void) sig;
+    serverQuit = 1;
+}
+
+/* Stop the server (or the spectrum analyser) on SIGINT / SIGTERM (without restarting the blocking open of the request pipe). */
+static void SetQuitSignals( void )
+{
+    struct sigaction	sa;
+    
+    memset( &sa, 0, sizeof(sa) );
+    sa.sa_handler = ServerSignalHandler;
+    sigaction( SIGINT, &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+    signal( SIGPIPE, SIG_IGN );
+}
+
+/* Handle one PLAY request of the server (numAverages: number of averaged periods, 0 for the default given on the command line). Returns NULL on success, or an error message. */
+static const char *ServeRequest( paTestData *data, PaStream *stream, const char *inPath, const char *outPath, unsigned long numAverages )
+{
+    const char *errText = NULL;
+    unsigned long defaultAverages = data->numAverages;
+    
+    if ( numAverages > 0 ) data->numAverages = numAverages;
+    if ( OpenSource( data, inPath ) != 0 ) {
+		errText = "could not read the input file";
+	}
+    else if ( ( data->outFile = fopen(outPath,"wb") ) == NULL ) {
+		errText = "could not open the output file";
+	}
+    else {
+		if ( RunJob( data, stream ) != 0 ) {
+			errText = data->writerError ? "could not write the output file" : "sound I/O failed";
+		}
+		if ( fclose( data->outFile ) != 0 && !errText ) errText = "could not write the output file";
+		data->outFile = NULL;
+	}
+    CloseSource( data );
+    data->numAverages = defaultAverages;
+    return errText;
+}
+#endif
+
+/* Run the TestTone server (see description at the top of this file). Returns 0 on success, -1 on failure. */
+static int RunServer( paTestData *data, PaStream *stream, const char *base )
+{
+#ifdef _WIN32
+    (void) stream;
+    (void) base;
+    fprintf(data->msg,"ERROR: the TestTone server is not supported on Windows.\n");
+    return -1;
+#else
+    char		reqPath[1024], rspPath[1024], pidPath[1024], line[3000];
+    char		*inPath, *outPath, *avgText;
+    const char		*errText;
+    FILE		*f;
+    
+    if ( snprintf(reqPath,sizeof(reqPath),"%s.req",base) >= (int)sizeof(reqPath) ||
+		 snprintf(rspPath,sizeof(rspPath),"%s.rsp",base) >= (int)sizeof(rspPath) ||
+		 snprintf(pidPath,sizeof(pidPath),"%s.pid",base) >= (int)sizeof(pidPath) ) {
+		fprintf(data->msg,"ERROR: server path is too long.\n");
+		return -1;
+	}
+    unlink(reqPath);
+    unlink(rspPath);
+    if ( mkfifo(reqPath,0600) != 0 || mkfifo(rspPath,0600) != 0 ) {
+		fprintf(data->msg,"ERROR: could not create the named pipes %s / %s.\n",reqPath,rspPath);
+		unlink(reqPath);
+		return -1;
+	}
+    f = fopen(pidPath,"w");
+    if (f) {
+		fprintf(f,"%ld %f\n",(long)getpid(),data->samplingRate);
+		fclose(f);
+	}
+    
+    SetQuitSignals();
+    
+    fprintf(data->msg,"%% TestTone server ready (%s, sampling rate = %f Hz)\n",base,data->samplingRate);
+    
+    while ( !serverQuit ) {
+		f = fopen(reqPath,"r"); // blocks until a client opens the pipe for writing
+		if ( f == NULL ) continue; // interrupted by a signal
+		if ( fgets(line,sizeof(line),f) == NULL ) {
+			fclose(f);
+			continue;
+		}
+		fclose(f);
+		line[strcspn(line,"\r\n")] = '\0';
+		
+		if ( strcmp(line,"QUIT") == 0 ) break;
+		
+		errText = "unknown request";
+		if ( strncmp(line,"PLAY\t",5) == 0 ) {
+			inPath = line+5;
+			outPath = strchr(inPath,'\t');
+			if ( outPath ) {
+				*outPath++ = '\0';
+				avgText = strchr(outPath,'\t');
+				if ( avgText ) *avgText++ = '\0';
+				errText = ServeRequest( data, stream, inPath, outPath, avgText ? strtoul(avgText,NULL,10) : 0 );
+			}
+		}
+		
+		f = fopen(rspPath,"w"); // blocks until the client opens the pipe for reading
+		if ( f == NULL ) continue;
+		if ( errText ) {
+			fprintf(f,"ERROR: %s\n",errText);
+		}
+		else {
+			fprintf(f,"OK\n");
+		}
+		fclose(f);
+	}
+    
+    unlink(reqPath);
+    unlink(rspPath);
+    unlink(pidPath);
+    fprintf(data->msg,"%% TestTone server stopped.\n");
+    return 0;
+#endif
+}
 
-return finished;
+/* Run the spectrum analyser: record continuously (playing the test signal in a loop if one was given, or silence otherwise), compute the spectra of the recorded channels (see ttSpectrum.h), and publish them to <base>.spc every 'interval' seconds until SIGINT or SIGTERM is received. If 'transfer' is set, the transfer function from the first to the second recorded channel is estimated instead (see ttTransfer.h) and published to <base>.tfe.
+** The analysis runs in this thread, the callback only copies the recorded data to the input ring buffer. Returns 0 on success, -1 on failure.
+*/
+static int RunAnalyser( paTestData *data, PaStream *stream, const char *base, int playSignal, unsigned long fftSize, double overlap, int exponential, double interval, int transfer )
+{
+#ifdef _WIN32
+    (void) stream;
+    (void) base;
+    (void) playSignal;
+    (void) fftSize;
+    (void) overlap;
+    (void) exponential;
+    (void) interval;
+    (void) transfer;
+    fprintf(data->msg,"ERROR: the TestTone spectrum analyser is not supported on Windows.\n");
+    return -1;
+#else
+    char		spcPath[1024], tmpPath[1024], pidPath[1024];
+    ttSpectrum		spectrum;
+    ttTransfer		tf;
+    ttThread		readerThread;
+    SAMPLE		*buf = NULL, *recBuf = NULL;
+    const SAMPLE	*rec;
+    unsigned long	n, m, hop, publishFrames;
+    unsigned long long	lastPublished = 0;
+    unsigned int	nDev = data->numInputDeviceChannels;
+    int			dropped = 0, underflow = 0, status = 0;
+    FILE		*f;
+    
+    const char		*ext = transfer ? "tfe" : "spc";
+    
+    memset( &spectrum, 0, sizeof(spectrum) );
+    memset( &tf, 0, sizeof(tf) );
+    if ( snprintf(spcPath,sizeof(spcPath),"%s.%s",base,ext) >= (int)sizeof(spcPath) ||
+		 snprintf(tmpPath,sizeof(tmpPath),"%s.%s.tmp",base,ext) >= (int)sizeof(tmpPath) ||
+		 snprintf(pidPath,sizeof(pidPath),"%s.pid",base) >= (int)sizeof(pidPath) ) {
+		fprintf(data->msg,"ERROR: analyser path is too long.\n");
+		return -1;
+	}
+    if ( playSignal && data->source.file == stdin ) {
+		fprintf(data->msg,"ERROR: repeated playback of a test signal read from STDIN is not supported.\n");
+		return -1;
+	}
+    
+    hop = (unsigned long) ( fftSize*(1.0-overlap) + 0.5 );
+    if ( hop < 1 ) hop = 1;
+    publishFrames = (unsigned long) ( interval*data->samplingRate );
+    if ( transfer ) {
+		if ( data->numInputChannels != 2 ) {
+			fprintf(data->msg,"ERROR: the transfer-function analyser needs exactly two recorded channels (reference and response, see -c).\n");
+			return -1;
+		}
+		if ( ttTransferInit( &tf, fftSize, hop ) != 0 ) {
+			fprintf(data->msg,"ERROR: could not set up the transfer-function analyser (the FFT size must be a power of two, at least 16).\n");
+			return -1;
+		}
+	}
+    else if ( ttSpectrumInit( &spectrum, fftSize, hop, data->numInputChannels, data->numAverages, exponential ) != 0 ) {
+		fprintf(data->msg,"ERROR: could not set up the spectrum analyser (the FFT size must be a power of two, at least 16).\n");
+		return -1;
+	}
+    buf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*nDev*sizeof(SAMPLE) );
+    recBuf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*data->numInputChannels*sizeof(SAMPLE) );
+    if ( !buf || !recBuf ) {
+		fprintf(data->msg,"ERROR: could not allocate input frames buffer.\n");
+		status = -1;
+		goto done;
+	}
+    
+    ResetJob( data );
+    data->continuous = 1;
+    data->playFrames = playSignal ? ULONG_MAX : 0; // the reader thread rewinds the test signal after each period
+    if ( playSignal && StartReader( data, &readerThread ) != 0 ) {
+		status = -1;
+		goto done;
+	}
+    
+    f = fopen(pidPath,"w");
+    if (f) {
+		fprintf(f,"%ld %f\n",(long)getpid(),data->samplingRate);
+		fclose(f);
+	}
+    SetQuitSignals();
+    
+    if ( transfer ) {
+		fprintf(data->msg,"%% TestTone transfer-function analyser running (%s, sampling rate = %f Hz, FFT size = %lu, hop size = %lu, averaging of all FFTs)\n",spcPath,data->samplingRate,fftSize,hop);
+	}
+    else {
+		fprintf(data->msg,"%% TestTone spectrum analyser running (%s, sampling rate = %f Hz, FFT size = %lu, hop size = %lu, %s averaging of %lu spectra)\n",spcPath,data->samplingRate,fftSize,hop,exponential ? "exponential" : "linear",spectrum.numAverages);
+	}
+    fflush(data->msg);
+    
+    ttMemoryBarrier();
+    data->running = 1;
+    
+    while ( !serverQuit ) {
+		if ( data->readerError ) {
+			status = -1;
+			break;
+		}
+		if ( Pa_IsStreamActive( stream ) != 1 ) {
+			fprintf(data->msg,"ERROR: the sound stream stopped unexpectedly.\n");
+			status = -1;
+			break;
+		}
+		if ( data->inputOverflow ) {
+			if ( !dropped ) fprintf(data->msg,"%% *** Warning: the recorded data could not be analysed fast enough, samples were lost!\n");
+			dropped = 1;
+			data->inputOverflow = 0;
+			if ( transfer ) { // discard the frames recorded up to the gap and restart the FFT history, so that no FFT of the REF and DUT channels spans the lost samples
+				ttMemoryBarrier();
+				n = ttRingBufferGetReadAvailable( &data->inputRing ) / nDev;
+				while ( n > 0 ) {
+					m = ( n > TT_CHUNK_FRAMES ) ? TT_CHUNK_FRAMES : n;
+					ttRingBufferRead( &data->inputRing, buf, m*nDev );
+					tf.numFrames += m;
+					n -= m;
+				}
+				ttTransferRestart( &tf );
+			}
+		}
+		if ( data->outputUnderflow && !underflow ) {
+			fprintf(data->msg,"%% *** Warning: the test signal could not be read fast enough (output buffer underflow).\n");
+			underflow = 1;
+		}
+		
+		n = ttRingBufferGetReadAvailable( &data->inputRing ) / nDev;
+		if ( n > TT_CHUNK_FRAMES ) n = TT_CHUNK_FRAMES;
+		if ( n == 0 ) {
+			Pa_Sleep(1);
+			continue;
+		}
+		ttRingBufferRead( &data->inputRing, buf, n*nDev );
+		rec = PickInputChannels( data, buf, n, recBuf );
+		
+		if ( transfer ) {
+			ttTransferAddFrames( &tf, rec, n, data->numInputChannels );
+			if ( tf.numSpectra > 0 && tf.numFrames - lastPublished >= publishFrames ) {
+				if ( ttTransferWrite( &tf, spcPath, tmpPath, data->samplingRate, dropped ) != 0 ) {
+					fprintf(data->msg,"ERROR: could not write the transfer-function file %s.\n",spcPath);
+					status = -1;
+					break;
+				}
+				lastPublished = tf.numFrames;
+			}
+			continue;
+		}
+		
+		ttSpectrumAddFrames( &spectrum, rec, n );
+		if ( spectrum.ready && spectrum.numFrames - lastPublished >= publishFrames ) {
+			if ( ttSpectrumWrite( &spectrum, spcPath, tmpPath, data->samplingRate, dropped ) != 0 ) {
+				fprintf(data->msg,"ERROR: could not write the spectrum file %s.\n",spcPath);
+				status = -1;
+				break;
+			}
+			lastPublished = spectrum.numFrames;
+		}
+	}
+    
+    // stop playing / recording:
+    data->running = 0;
+    Pa_Sleep(100); // make sure the callback is done with the current buffer
+    data->callbackFinished = 1; // make sure the reader thread terminates
+    if ( playSignal ) JoinThread( readerThread );
+    unlink(pidPath);
+    fprintf(data->msg,"%% TestTone spectrum analyser stopped.\n");
+    
+done:
+    ttSpectrumFree( &spectrum );
+    ttTransferFree( &tf );
+    free( buf );
+    free( recBuf );
+    return status;
+#endif
+}
+
+
+/* State shared by RunSweep and the sweep analysis thread. */
+typedef struct
+{
+    paTestData		*data;
+    ttSineSweep		*sweep;
+    volatile int	jobReady;	// set by RunSweep when a tone is ready for the analysis, cleared by the analysis thread when done
+    volatile int	quit;		// set by RunSweep when no more tones will follow
+    unsigned int	step;		// tone to be analysed
+    unsigned int	buffer;
+    unsigned long	start;
+    int			settled;
+}
+ttSweepJob;
+
+/* Analysis thread of the stepped-sine sweep: analyses one tone at a time (while the next tone is recorded), and writes the results of the tone to the output file. */
+static TT_THREAD_FUNC(SweepAnalysisThread)
+{
+    ttSweepJob		*job = (ttSweepJob *) arg;
+    ttSineSweepResult	r;
+    unsigned int	h;
+    
+    for (;;) {
+		if ( !job->jobReady ) {
+			if ( job->quit ) break;
+			Pa_Sleep(1);
+			continue;
+		}
+		ttMemoryBarrier();
+		ttSineSweepAnalyse( job->sweep, job->step, job->buffer, job->start, job->settled, &r );
+		fprintf(job->data->outFile,"%E\t%E\t%E\t%E\t%E\t%d",r.frequency,r.amplitude,r.thd,r.thdn,r.settleTime,r.settled);
+		for ( h = 1; h < r.numHarmonics; h++ ) fprintf(job->data->outFile,"\t%E",r.harmonic[h]);
+		fprintf(job->data->outFile,"\n");
+		fflush(job->data->outFile);
+		ttMemoryBarrier();
+		job->jobReady = 0;
+	}
+    TT_THREAD_RETURN;
+}
+
+/* Pass the tone that is ready to the analysis thread (waits until the analysis thread is done with the previous tone). */
+static void PostSweepJob( ttSweepJob *job )
+{
+    ttSineSweep *sw = job->sweep;
+    
+    while ( job->jobReady ) Pa_Sleep(1);
+    ttMemoryBarrier();
+    job->step = sw->readyStep;
+    job->buffer = sw->readyBuffer;
+    job->start = sw->readyStart;
+    job->settled = sw->readySettled;
+    ttMemoryBarrier();
+    job->jobReady = 1;
+    sw->ready = 0;
+}
+
+/* Run the stepped-sine sweep (see description at the top of this file): the reader thread generates the tones, this thread takes the recorded frames, aligns them with the tones and finds the analysis windows, and the analysis thread computes the results of each tone. Returns 0 on success, -1 on failure. */
+static int RunSweep( paTestData *data, PaStream *stream, ttSineSweep *sweep )
+{
+    ttThread		readerThread, analysisThread;
+    ttSweepJob		job;
+    SAMPLE		*buf = NULL, *recBuf = NULL;
+    const SAMPLE	*rec;
+    unsigned long	n, k, skip;
+    unsigned int	nDev = data->numInputDeviceChannels;
+    unsigned int	h;
+    int			finished, status = 0;
+    
+    buf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*nDev*sizeof(SAMPLE) );
+    recBuf = (SAMPLE *) malloc( TT_CHUNK_FRAMES*data->numInputChannels*sizeof(SAMPLE) );
+    if ( !buf || !recBuf ) {
+		fprintf(data->msg,"ERROR: could not allocate input frames buffer.\n");
+		status = -1;
+		goto done;
+	}
+    
+    fprintf(data->msg,"%% Stepped-sine sweep: %u tones from %f Hz to %f Hz, %f s per tone, %lu block(s) of %lu frames analysed per tone\n",sweep->numSteps,ttSineSweepFrequency(sweep,0),ttSineSweepFrequency(sweep,sweep->numSteps-1),sweep->stepFrames/data->samplingRate,sweep->numBlocks,sweep->blockSize);
+    fprintf(data->outFile,"%% frequency (Hz)\tfundamental\tTHD\tTHD+N\tsettling time (s)\tsettled");
+    for ( h = 2; h <= sweep->numHarmonics; h++ ) fprintf(data->outFile,"\tharmonic-%u",h);
+    fprintf(data->outFile,"\n");
+    fflush(data->outFile);
+    
+    ResetJob( data );
+    data->trimCapture = 1; // keep recording until the response to the last tone is complete
+    
+    memset( &job, 0, sizeof(job) );
+    job.data = data;
+    job.sweep = sweep;
+    if ( StartReader( data, &readerThread ) != 0 ) {
+		status = -1;
+		goto done;
+	}
+    if ( StartThread( &analysisThread, SweepAnalysisThread, &job ) != 0 ) {
+		fprintf(data->msg,"ERROR: could not start analysis thread.\n");
+		data->callbackFinished = 1;
+		JoinThread( readerThread );
+		status = -1;
+		goto done;
+	}
+    
+    ttMemoryBarrier();
+    data->running = 1;
+    
+    // wait for the first buffer of the sweep:
+    while ( !data->delayKnown && !data->callbackFinished ) Pa_Sleep(1);
+    ttMemoryBarrier();
+    data->captureDelay = data->streamDelayFrames;
+    skip = data->captureDelay; // frames recorded before the sweep arrived
+    
+    while ( sweep->captureStep < sweep->numSteps ) {
+		if ( data->readerError ) {
+			status = -1;
+			break;
+		}
+		if ( Pa_IsStreamActive( stream ) != 1 ) {
+			fprintf(data->msg,"ERROR: the sound stream stopped unexpectedly.\n");
+			status = -1;
+			break;
+		}
+		finished = data->callbackFinished; // check before reading, so no data written by the callback will be missed
+		n = ttRingBufferGetReadAvailable( &data->inputRing ) / nDev;
+		if ( n > TT_CHUNK_FRAMES ) n = TT_CHUNK_FRAMES;
+		if ( n == 0 ) {
+			if ( finished ) break;
+			Pa_Sleep(1);
+			continue;
+		}
+		ttRingBufferRead( &data->inputRing, buf, n*nDev );
+		if ( skip >= n ) {
+			skip -= n;
+			continue;
+		}
+		rec = PickInputChannels( data, buf+skip*nDev, n-skip, recBuf );
+		n -= skip;
+		skip = 0;
+		
+		for ( k = 0; k < n && sweep->captureStep < sweep->numSteps; ) {
+			k += ttSineSweepAddFrames( sweep, rec+k*data->numInputChannels, n-k, data->numInputChannels );
+			if ( sweep->ready ) PostSweepJob( &job );
+		}
+	}
+    if ( sweep->ready ) PostSweepJob( &job );
+    if ( status == 0 && sweep->captureStep < sweep->numSteps ) {
+		fprintf(data->msg,"ERROR: the recording stopped before all tones were recorded.\n");
+		status = -1;
+	}
+    
+    // wait for the analysis of the last tone:
+    job.quit = 1;
+    JoinThread( analysisThread );
+    
+    if ( !data->callbackFinished ) { // stop early (or stop recording the margin after the last tone)
+		data->running = 0;
+		Pa_Sleep(100); // make sure the callback is done with the current buffer
+		data->callbackFinished = 1; // make sure the reader thread terminates
+	}
+    JoinThread( readerThread );
+    
+    if ( data->outputUnderflow ) {
+		fprintf(data->msg,"ERROR: the sweep could not be generated fast enough (output buffer underflow).\n");
+		status = -1;
+	}
+    if ( data->inputOverflow ) {
+		fprintf(data->msg,"ERROR: the recorded data could not be analysed fast enough (input buffer overflow).\n");
+		status = -1;
+	}
+    
+done:
+    free( buf );
+    free( recBuf );
+    return status;
 }
 
 
@@ -117,35 +1607,238 @@ return finished;
 int main(int argc, char *argv[]);
 int main(int argc, char *argv[])
 {
-    PaStream		*stream;
+    PaStream		*stream = NULL;
     PaError			err;
     paTestData		data;
-    unsigned long	iFrame,iChannel;
-    unsigned long	numBytes;
-    SAMPLE			*testSignal;
-	unsigned int	numChanTestSignal = 0;    // number of channels in the test signal generated or read from disk. This should be less or equal than the number of output channels supported by the sound output device
+	int				binaryOutput = 0;         // write recorded data in binary TestTone format instead of text
+	const char		*serverBase = NULL;       // run as a server using this path for the named pipes
+	const char		*analyserBase = NULL;     // run as a spectrum analyser using this path for the spectrum file
+	unsigned long	fftSize = 4096;           // FFT size of the spectrum analyser
+	double			overlap = 0.5;            // overlap of consecutive FFTs of the spectrum analyser
+	int				exponential = 0;          // exponential instead of linear averaging of the spectra
+	int				transfer = 0;             // estimate the transfer function from the first to the second recorded channel instead of the spectra
+	double			interval = 0.1;           // time between updates of the spectrum file (s)
+	int				sweepMode = 0;            // run a stepped-sine distortion sweep
+	double			sweepF1 = 0, sweepF2 = 0; // frequency range of the sweep (Hz)
+	unsigned int	sweepSteps = 0;           // number of tones of the sweep
+	double			sweepAmplitude = 0.5;     // amplitude of the sweep tones
+	double			settleTime = 0.2;         // maximum settling time per tone (s)
+	unsigned int	numHarmonics = 5;         // highest harmonic analysed by the sweep
+	ttSineSweep		sweep;
+	const char		*inputDeviceName = NULL;  // input / output device (index or name), NULL for the default devices
+	const char		*outputDeviceName = NULL;
+	const char		*inputChannelList = NULL; // input / output channels to be used (e.g. "1,2"), NULL for all channels
+	const char		*outputChannelList = NULL;
+	unsigned long	framesPerBuffer = TT_DEFAULT_FRAMES_PER_BUFFER;
+	double			suggestedLatency = -1;    // negative: use the default low latency of the devices
+	int				trimCapture = 0;          // trim the recorded data to the test-signal window
+	unsigned long	numAverages = 1;          // number of periods of the test signal to be averaged
+	int				warmup = 0;               // play a warm-up period before the averaged periods
+	long			loopbackChannel = 0;      // input channel with a loopback of the test signal (one-based), 0 if none
+	double			clipLevel = TT_CLIP_LEVEL; // recorded samples with an absolute value of at least clipLevel are counted as clipped
+	int				abortOnClip = 0;          // stop the recording if a recorded channel clips
+	FILE			*msg = stdout;            // where to print information and error messages (STDERR if STDOUT carries binary data)
+	int				status;
+	PaStreamParameters	inputParameters, outputParameters;
+	const PaStreamInfo	*streamInfo;
 
     /* check for proper input */
 	
+	// options (optional): -b (binary output), -S base (server), -R base (spectrum analyser), -H f1,f2,n (stepped-sine sweep), -a amplitude, -s settling time, -N harmonics, -d/-i/-o device, -c/-C channels, -f frames per buffer, -l latency, -t (trim), -L loopback channel, -k clip level, -x (abort on clipping), -A averages, -w (warm-up), -F FFT size, -V overlap, -e (exponential averaging), -T (transfer function), -u update interval
 	// argv[1]: sample rate in Hz
-	// argv[2]: input file name (optional)
+	// argv[2]: input file name (optional, '-' for STDIN)
 	
     argc -=1; /* first argument is call to TestTone itself */
+    argv +=1;
+	
+	while ( argc > 0 && argv[0][0] == '-' && argv[0][1] != '\0' ) {
+		if ( strcmp(argv[0],"-b") == 0 ) {
+			binaryOutput = 1;
+			msg = stderr;
+		}
+		else if ( strcmp(argv[0],"-S") == 0 && argc > 1 ) {
+			serverBase = argv[1];
+			binaryOutput = 1;
+			msg = stderr;
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-R") == 0 && argc > 1 ) {
+			analyserBase = argv[1];
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-H") == 0 && argc > 1 ) {
+			if ( sscanf(argv[1],"%lf,%lf,%u",&sweepF1,&sweepF2,&sweepSteps) != 3 || sweepF1 <= 0 || sweepF2 < sweepF1 || sweepSteps < 1 ) {
+				fprintf(stderr,"ERROR: the sweep must be given as 'f1,f2,n' with 0 < f1 <= f2 and n >= 1.\n");
+				exit(1);
+			}
+			sweepMode = 1;
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-a") == 0 && argc > 1 ) {
+			sweepAmplitude = atof(argv[1]);
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-s") == 0 && argc > 1 ) {
+			settleTime = atof(argv[1]);
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-N") == 0 && argc > 1 ) {
+			numHarmonics = (unsigned int) strtoul(argv[1],NULL,10);
+			if ( numHarmonics < 1 || numHarmonics > TT_SWEEP_MAX_HARMONICS ) {
+				fprintf(stderr,"ERROR: the number of harmonics must be between 1 and %d.\n",TT_SWEEP_MAX_HARMONICS);
+				exit(1);
+			}
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-F") == 0 && argc > 1 ) {
+			fftSize = strtoul(argv[1],NULL,10);
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-V") == 0 && argc > 1 ) {
+			overlap = atof(argv[1]);
+			if ( overlap < 0 || overlap >= 1 ) {
+				fprintf(stderr,"ERROR: the overlap must be at least 0 and less than 1.\n");
+				exit(1);
+			}
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-e") == 0 ) {
+			exponential = 1;
+		}
+		else if ( strcmp(argv[0],"-T") == 0 ) {
+			transfer = 1;
+		}
+		else if ( strcmp(argv[0],"-u") == 0 && argc > 1 ) {
+			interval = atof(argv[1]);
+			argc -=1;
+			argv +=1;
+		}
+		else if ( ( strcmp(argv[0],"-d") == 0 || strcmp(argv[0],"-i") == 0 || strcmp(argv[0],"-o") == 0 ) && argc > 1 ) {
+			if ( argv[0][1] != 'o' ) inputDeviceName = argv[1];
+			if ( argv[0][1] != 'i' ) outputDeviceName = argv[1];
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-c") == 0 && argc > 1 ) {
+			inputChannelList = argv[1];
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-C") == 0 && argc > 1 ) {
+			outputChannelList = argv[1];
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-f") == 0 && argc > 1 ) {
+			framesPerBuffer = strtoul(argv[1],NULL,10); // 0 = paFramesPerBufferUnspecified
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-l") == 0 && argc > 1 ) {
+			suggestedLatency = atof(argv[1]);
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-t") == 0 ) {
+			trimCapture = 1;
+		}
+		else if ( strcmp(argv[0],"-A") == 0 && argc > 1 ) {
+			numAverages = strtoul(argv[1],NULL,10);
+			if ( numAverages < 1 ) numAverages = 1;
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-w") == 0 ) {
+			warmup = 1;
+		}
+		else if ( strcmp(argv[0],"-L") == 0 && argc > 1 ) {
+			loopbackChannel = atol(argv[1]);
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-k") == 0 && argc > 1 ) {
+			clipLevel = atof(argv[1]);
+			if ( clipLevel <= 0 ) {
+				fprintf(stderr,"ERROR: the clip level must be larger than zero.\n");
+				exit(1);
+			}
+			argc -=1;
+			argv +=1;
+		}
+		else if ( strcmp(argv[0],"-x") == 0 ) {
+			abortOnClip = 1;
+		}
+		else {
+			fprintf(stderr,"ERROR: unknown option '%s'.\n",argv[0]);
+			exit(1);
+		}
+		argc -=1;
+		argv +=1;
+	}
 	
     if (argc == 0) // print usage information
 	{
         printf("Not enough input arguments.\n\n");
 		printf("Usage:\n");
 		printf("'TestTone 44100' plays a 1-kHz sine with a sampling rate of 44.1 kHz and records the response signal.\n");
-		printf("'TestTone 44100 myTestSignal' plays the test-signal samples in the ASCII-file 'myTestSignal' at a sampling rate of 44.1 kHz and records the response signal.\n\n");
-		printf("The file format of the input file is as follows:\n");
+		printf("'TestTone 44100 myTestSignal' plays the test-signal samples in the file 'myTestSignal' at a sampling rate of 44.1 kHz and records the response signal.\n");
+		printf("'TestTone 44100 -' reads the test-signal samples from STDIN (binary TestTone format only).\n\n");
+		printf("Options:\n");
+		printf(" -b   write the recorded data to STDOUT in binary TestTone format (see below) instead of text. Messages are then written to STDERR.\n");
+		printf(" -d device   use the given device for input and output (device number or name, or part of the name). Default: default devices of the system.\n");
+		printf(" -i device   use the given input device.\n");
+		printf(" -o device   use the given output device.\n");
+		printf(" -c list   record the given input channels only (comma separated channel numbers, e.g. '1,2'). Default: all channels.\n");
+		printf(" -C list   play the test signal on the given output channels (the first test-signal channel is played on the first channel in the list, etc.). The other output channels are silent. Default: all channels.\n");
+		printf(" -f frames   number of frames per buffer (default: %d, 0: let PortAudio decide).\n",TT_DEFAULT_FRAMES_PER_BUFFER);
+		printf(" -l latency   suggested latency in seconds (default: default low latency of the devices). The actual input and output latency of the stream are reported in the header of the recorded data.\n");
+		printf(" -t   trim the recorded data to the test signal: discard the frames recorded before the test signal arrived (round-trip delay), and keep recording until the delayed test signal was recorded completely.\n");
+		printf(" -A K   play the test signal K times back to back and write the average of the K recorded periods (synchronized averaging). The noise RMS of a single period is reported in the header.\n");
+		printf(" -w   play the test signal once more before the averaged periods, and discard the response to this warm-up period.\n");
+		printf(" -L channel   input channel with a loopback of the test signal (e.g. a cable from the output to the input). The round-trip delay is then determined from the onset of the test signal in this channel instead of the time stamps of the sound device.\n");
+		printf(" -k level   clip level (default: %g). Recorded samples with an absolute value of at least this level are counted as clipped. The peak level, RMS level, DC offset and number of clipped samples of each recorded channel are reported after the recording (and in the header of binary output).\n",TT_CLIP_LEVEL);
+		printf(" -x   stop the recording as soon as a recorded channel clips (the rest of the recorded data is padded with zeros, and this is indicated in the header of binary output).\n");
+		printf(" -S base   run as a server with the sound stream kept open (not available on Windows). Requests are read from the named pipe 'base.req', replies are written to 'base.rsp'. Each request is a line 'PLAY<TAB>input-file<TAB>output-file[<TAB>K]' (the recorded data are written to output-file in binary format) or 'QUIT'. The server replies 'OK' or 'ERROR: <message>'.\n");
+		printf(" -R base   run as a real-time spectrum analyser of the recorded channels (not available on Windows). The test signal (if given) is played in a loop, otherwise silence is played. The spectra are written to the file 'base.spc' (see ttSpectrum.h for the format) until TestTone is stopped by SIGINT or SIGTERM. With -R, -A K sets the number of averaged spectra.\n");
+		printf(" -F size   FFT size of the spectrum analyser (power of two, default: 4096).\n");
+		printf(" -V overlap   overlap of consecutive FFTs of the spectrum analyser (0...<1, default: 0.5).\n");
+		printf(" -e   exponential averaging of the spectra with a time constant of K spectra (default: linear averaging of blocks of K spectra).\n");
+		printf(" -u interval   time between updates of the spectrum file in seconds (default: 0.1).\n");
+		printf(" -T   with -R, estimate the transfer function from the first to the second recorded channel (H1 and H2 estimates and coherence, Welch averaging of all FFTs since the start) instead of the spectra. The estimates are written to the file 'base.tfe' (see ttTransfer.h for the format).\n");
+		printf(" -H f1,f2,n   run a stepped-sine distortion sweep of n tones from f1 to f2 (Hz, logarithmic spacing) instead of playing a test signal. For each tone, the frequency, the amplitude of the fundamental, THD, THD+N, the settling time, a flag indicating if the response settled, and the amplitudes of the harmonics are written to STDOUT (one line per tone). The first recorded channel is analysed. With -H, -F sets the FFT size (default: 4096) and -A K the number of FFT blocks analysed per tone.\n");
+		printf(" -a amplitude   amplitude of the sweep tones (default: 0.5).\n");
+		printf(" -s time   maximum settling time per tone in seconds (default: 0.2). The analysis of each tone starts as soon as the response has settled.\n");
+		printf(" -N n   highest harmonic analysed by the sweep (default: 5).\n\n");
+		printf("The file format of the input file is either text or binary. Text files are formatted as follows:\n");
 		printf(" - data is given using comma separated values (CSV).");
 		printf(" - each column corresponds to one data channel.");
 		printf(" - each line corresponds to one frame (one frame corresponds to all samples from the same time step.\n");
 		printf(" - data channels are separated by commas.\n");
 		printf(" - no headers or extra information are allowed.\n");
 		printf("\n");
-		printf("If the input file contains less data channels than supported by the sound output device, the last channel in the input file will be copied to the remaining channels of the output device.\n\n");
+		printf("Binary TestTone files (native byte order) consist of a header followed by the sample data:\n");
+		printf(" - 8 bytes: magic string '%s'\n",TT_BINARY_MAGIC);
+		printf(" - uint32: header size in bytes (offset of the first sample)\n");
+		printf(" - uint32: number of channels\n");
+		printf(" - uint64: number of frames\n");
+		printf(" - float64: sampling rate in Hz (0 if unknown)\n");
+		printf(" - float64: input latency in seconds (recorded data only)\n");
+		printf(" - float64: output latency in seconds (recorded data only)\n");
+		printf(" - float64: round-trip delay in seconds (recorded data only)\n");
+		printf(" - uint32: number of averaged periods, uint32: flags (1: level statistics valid, 2: recording stopped because of clipping; recorded data only)\n");
+		printf(" - float64: noise RMS of a single period for each channel (recorded data only)\n");
+		printf(" - float64: peak level, RMS level, DC offset and number of clipped samples for each channel (all peak levels first, etc.; recorded data only)\n");
+		printf(" - float32 samples, interleaved frame by frame\n");
+		printf("\n");
+		printf("If the input file contains less data channels than used on the sound output device, the last channel in the input file will be copied to the remaining channels of the output device.\n\n");
 		printf("Some input file examples:\n\n");
  		printf(" 1. square-wave signal with one data channel\n\n");
  		printf("    -1\n"); 
@@ -178,25 +1871,40 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	if (binaryOutput) SetBinaryMode(stdout);
+
+	memset( &data, 0, sizeof(data) );
+	data.msg = msg;
+	data.binaryOutput = binaryOutput;
+	data.outFile = stdout;
+
 	// initialize PortAudio:
     err = Pa_Initialize();
     if( err != paNoError ) goto pa_error;
 	
 	// get audio devices info:
-	int inputDevice = Pa_GetDefaultInputDevice();
+	int inputDevice = inputDeviceName ? ttFindDevice( inputDeviceName, 1 ) : Pa_GetDefaultInputDevice();
 	if (inputDevice < 0)
 	{
-        printf( "ERROR: Pa_GetDefaultInputDevice returned %i\n", inputDevice );
+		if ( inputDeviceName ) {
+			fprintf(msg, "ERROR: could not find input device '%s'\n", inputDeviceName );
+			goto error;
+		}
+        fprintf(msg, "ERROR: Pa_GetDefaultInputDevice returned %i\n", inputDevice );
         err = inputDevice;
         goto pa_error;
     }
 	const   PaDeviceInfo *inputInfo;
 	inputInfo = Pa_GetDeviceInfo( inputDevice );
 	
-	int outputDevice = Pa_GetDefaultOutputDevice();
+	int outputDevice = outputDeviceName ? ttFindDevice( outputDeviceName, 0 ) : Pa_GetDefaultOutputDevice();
 	if (outputDevice < 0)
 	{
-        printf( "ERROR: Pa_GetDefaultOutputDevice returned %i\n", outputDevice );
+		if ( outputDeviceName ) {
+			fprintf(msg, "ERROR: could not find output device '%s'\n", outputDeviceName );
+			goto error;
+		}
+        fprintf(msg, "ERROR: Pa_GetDefaultOutputDevice returned %i\n", outputDevice );
         err = outputDevice;
         goto pa_error;
     }
@@ -204,206 +1912,167 @@ int main(int argc, char *argv[])
 	outputInfo = Pa_GetDeviceInfo( outputDevice );
 
 	// Prepare data:
-    data.processedFrames = 0;
-    data.numInputDeviceChannels = inputInfo->maxInputChannels;
-    data.numOutputDeviceChannels = outputInfo->maxOutputChannels;
-	data.samplingRate = atof(argv[1]);
+	data.numInputChannels = ttParseChannelList( inputChannelList, inputInfo->maxInputChannels, &data.inputChannelMap );
+	if ( data.numInputChannels == 0 ) {
+		fprintf(msg, "ERROR: invalid input channels (the input device has %d channels)\n", inputInfo->maxInputChannels );
+		goto error;
+	}
+	data.numOutputChannels = ttParseChannelList( outputChannelList, outputInfo->maxOutputChannels, &data.outputChannelMap );
+	if ( data.numOutputChannels == 0 ) {
+		fprintf(msg, "ERROR: invalid output channels (the output device has %d channels)\n", outputInfo->maxOutputChannels );
+		goto error;
+	}
+    data.numInputDeviceChannels = ttMaxChannel( data.inputChannelMap, data.numInputChannels ); // no need to transfer channels above the highest channel used
+	if ( loopbackChannel < 0 || loopbackChannel > inputInfo->maxInputChannels ) {
+		fprintf(msg, "ERROR: invalid loopback channel (the input device has %d channels)\n", inputInfo->maxInputChannels );
+		goto error;
+	}
+	data.loopbackChannel = (int) loopbackChannel - 1;
+	if ( (unsigned int) loopbackChannel > data.numInputDeviceChannels ) data.numInputDeviceChannels = loopbackChannel;
+	data.trimCapture = trimCapture;
+	data.numAverages = numAverages;
+	data.warmup = warmup;
+	data.noise = (double *) calloc( data.numInputChannels, sizeof(double) );
+	data.levels = (double *) calloc( TT_BINARY_LEVELS*data.numInputChannels, sizeof(double) );
+	data.levelMin = (float *) calloc( data.numInputDeviceChannels, sizeof(float) );
+	data.levelMax = (float *) calloc( data.numInputDeviceChannels, sizeof(float) );
+	data.levelSum = (double *) calloc( data.numInputDeviceChannels, sizeof(double) );
+	data.levelSumSq = (double *) calloc( data.numInputDeviceChannels, sizeof(double) );
+	data.clipCount = (unsigned long *) calloc( data.numInputDeviceChannels, sizeof(unsigned long) );
+	data.clipLevel = clipLevel;
+	data.abortOnClip = abortOnClip;
+	if ( !data.noise || !data.levels || !data.levelMin || !data.levelMax || !data.levelSum || !data.levelSumSq || !data.clipCount ) {
+		fprintf(msg,"ERROR: could not allocate memory.\n");
+		goto error;
+	}
+    data.numOutputDeviceChannels = ttMaxChannel( data.outputChannelMap, data.numOutputChannels );
+	data.samplingRate = atof(argv[0]);
+	data.trimMarginFrames = (unsigned long) (TT_TRIM_MARGIN_SECONDS*data.samplingRate) + framesPerBuffer;
+	fprintf(msg,"%% Input device = %s\n", inputInfo->name);
+	fprintf(msg,"%% Output device = %s\n", outputInfo->name);
 	
-    if (argc == 1) { // no input file is given, use some default signal instead
-        printf("%% No input file given! Using default signal instead: 1 kHz sine, 1 sec duration\n");
-		numChanTestSignal = 1;
-        data.numFrames=data.samplingRate; // determines signal duration
-        float f=1000.0; // frequency of test tone 
-        testSignal = (SAMPLE*)malloc(numChanTestSignal*data.numFrames*sizeof(SAMPLE));
-		if (!testSignal) {
-			printf("ERROR: could not allocate memory for test data\n");
+	if ( sweepMode ) {
+		if ( serverBase || analyserBase || binaryOutput || loopbackChannel || abortOnClip ) {
+			fprintf(msg,"ERROR: the sweep (-H) cannot be combined with -S, -R, -b, -L or -x.\n");
 			goto error;
 		}
-		if (data.samplingRate <= 2*f) {
-			printf("%% *** Warning: Nyquist frequency too low because sampling rate is too low!\n");
-		}
-        for (iFrame=0; iFrame<data.numFrames; iFrame++) testSignal[iFrame]=sin((float)iFrame/data.samplingRate*f*2.0*PI);
-    }
-
-    if (argc == 2) // read the input file specified in argv[2]
-    {
-        char	s[1000];
-		char	*u = NULL;
-		char	*delim;
-        FILE	*inFile;
-        
-        printf("%% Input file: %s\n", argv[2]);
-        
-    	inFile=fopen(argv[2],"r");
-        if (!inFile) {
-			printf("ERROR: could not open the input file.");
-			goto error;
-		}
-		
-        // get number of input signal frames:
-        data.numFrames=0;
-        while (fgets(s,1000,inFile)!=NULL) {
-            data.numFrames +=1;
-        }
-		
-		// get number of data channels in input file:
-		fseek(inFile,0,SEEK_SET); // go back to the beginning of the file
-		delim = ",";
-		fgets(s,1000,inFile); // read first line of the input file
-		// find and count delimiters:
-		u = strtok(s,delim);
-		while( u != NULL) {
-			numChanTestSignal++;
-			// printf("%s\n",u);
-			u = strtok(NULL,delim);
-		}
-		printf("%% Number of data channels in input file = %d\n", numChanTestSignal);
-
-		if ( numChanTestSignal > data.numOutputDeviceChannels ) {
-			printf("ERROR: the input file has more channels (%d) than supported by the sound output device (%d).\n",numChanTestSignal,data.numOutputDeviceChannels);
+		if ( ttSineSweepInit( &sweep, data.samplingRate, sweepF1, sweepF2, sweepSteps, sweepAmplitude, fftSize, numAverages, settleTime, data.trimMarginFrames, numHarmonics ) != 0 ) {
+			fprintf(msg,"ERROR: could not set up the sweep (the FFT size must be a power of two, at least 16).\n");
 			goto error;
 		}
-
-		// allocate memory to hold the data read from the input file:
-        testSignal = (SAMPLE*)malloc(numChanTestSignal*data.numFrames*sizeof(SAMPLE));
-		if (!testSignal) {
-			printf("ERROR: could not allocate memory for test data\n");
-			goto error;
-		}
-        fseek(inFile,0,SEEK_SET); // go back to the beginning of the file
-		iFrame = 0;
-				
-        for (iFrame = 0; iFrame < data.numFrames; iFrame++) {
-			iChannel = 0;
-			if (fgets(s,1000,inFile) == NULL) {
-				printf("ERROR: could not read input file on line %lu.\n",iFrame);
-				goto error;
-			}
-			u = strtok(s,delim);
-			// printf(u);
-			while (iChannel < numChanTestSignal) {
-				if (!u) {
-					printf("ERROR: could not read input file on line %lu.\n",iFrame);
-					goto error;
-				}
-				// printf("%s",u);
-				testSignal[ numChanTestSignal*iFrame + iChannel ]=atof(u);
-				iChannel++;
-				u = strtok(NULL,delim);
-			}
-        }
-        fclose(inFile);
-    }
-	
-	// allocate memory for output data:
-    numBytes = data.numFrames * data.numOutputDeviceChannels * sizeof(SAMPLE);
-    data.outputSamples= (SAMPLE *) malloc( numBytes );
-    if( data.outputSamples == NULL )
-    {
-        printf("ERROR: could not allocate output frames buffer.");
-        exit(1);
-    }
-    
-	// move the testSignal to data.outputSamples:
-	unsigned int dummy;
-	for ( dummy = 0; dummy < data.numOutputDeviceChannels; dummy++ ) {
-		if (dummy < numChanTestSignal) {
-			iChannel = dummy;
-		}
-		else {
-			iChannel = numChanTestSignal-1;
-		}
-		for( iFrame = 0; iFrame < data.numFrames; iFrame++ ) {
-			data.outputSamples[data.numOutputDeviceChannels*iFrame+dummy] = testSignal[numChanTestSignal*iFrame+iChannel];
-		}
+		data.source.type = TT_SOURCE_SWEEP;
+		data.source.numChannels = 1;
+		data.source.sweep = &sweep;
+		data.numFrames = ttSineSweepFrames( &sweep );
+		data.numAverages = 1;
+		data.warmup = 0;
+	}
+	else if ( analyserBase ) {
+		if ( argc == 2 && OpenSource( &data, argv[1] ) != 0 ) goto error; // no default signal, the analyser plays silence if no test signal is given
+	}
+	else if ( !serverBase ) {
+		if ( OpenSource( &data, (argc == 2) ? argv[1] : NULL ) != 0 ) goto error;
 	}
 	
-    free(testSignal);
-
-    data.inputSamples= (SAMPLE *) malloc( numBytes );
-    if( data.inputSamples == NULL )
-    {
-        printf("Could not allocate output frames buffer");
-        exit(1);
+	// allocate the ring buffers (their size does not depend on the length of the test signal):
+	if ( ttRingBufferInit( &data.outputRing, (unsigned long) (TT_RING_SECONDS*data.samplingRate) * data.numOutputDeviceChannels ) != 0 ) {
+        fprintf(msg,"ERROR: could not allocate output frames buffer.\n");
+        goto error;
     }
-
-    for( iFrame=0; iFrame<data.numFrames; iFrame++ ) // initialize input frames:
-    {
-        for( iChannel=0; iChannel < data.numInputDeviceChannels; iChannel++ ) {
-			data.inputSamples[iFrame*data.numInputDeviceChannels+iChannel] = 0;
-		}
+	if ( ttRingBufferInit( &data.inputRing, (unsigned long) (TT_RING_SECONDS*data.samplingRate) * data.numInputDeviceChannels ) != 0 ) {
+        fprintf(msg,"ERROR: could not allocate input frames buffer.\n");
+        goto error;
     }
 	
-	// Record and play audio data:	
-    err = Pa_OpenDefaultStream( &stream,
-                                data.numInputDeviceChannels,          // number of input channels
-                                data.numOutputDeviceChannels,         // number of input channels
-								PA_SAMPLE_TYPE,					// sample type
-								data.samplingRate,				// sampling rate
-                                256,							// frames per buffer (use something in the 128-1024 range, or use paFramesPerBufferUnspecified to let portaudio decide)
-								RecordAndPlayCallback,			// the callback function
-                                &data );						// pointer to the audio data
+	// Open the audio stream (the callback plays silence until a test signal is ready):
+	inputParameters.device = inputDevice;
+	inputParameters.channelCount = data.numInputDeviceChannels;
+	inputParameters.sampleFormat = PA_SAMPLE_TYPE;
+	inputParameters.suggestedLatency = ( suggestedLatency >= 0 ) ? suggestedLatency : inputInfo->defaultLowInputLatency;
+	inputParameters.hostApiSpecificStreamInfo = NULL;
+	
+	outputParameters.device = outputDevice;
+	outputParameters.channelCount = data.numOutputDeviceChannels;
+	outputParameters.sampleFormat = PA_SAMPLE_TYPE;
+	outputParameters.suggestedLatency = ( suggestedLatency >= 0 ) ? suggestedLatency : outputInfo->defaultLowOutputLatency;
+	outputParameters.hostApiSpecificStreamInfo = NULL;
+	
+    err = Pa_OpenStream( &stream,
+                         &inputParameters,
+                         &outputParameters,
+                         data.samplingRate,				// sampling rate
+                         framesPerBuffer,				// frames per buffer (use something in the 128-1024 range, or use paFramesPerBufferUnspecified to let portaudio decide)
+                         paClipOff,					// the test signal is within -1...+1 anyway
+                         RecordAndPlayCallback,			// the callback function
+                         &data );					// pointer to the audio data
 	if( err != paNoError ) 
 	{
-		printf( "ERROR: Pa_OpenDefaultStream returned %i\n", err );
+		fprintf(msg, "ERROR: Pa_OpenStream returned %i\n", err );
         goto pa_error;
 	}
+	
+	// get the actual latencies of the stream:
+	streamInfo = Pa_GetStreamInfo( stream );
+	if ( streamInfo ) {
+		data.inputLatency = streamInfo->inputLatency;
+		data.outputLatency = streamInfo->outputLatency;
+	}
+	
+	// the header of the recorded data is written by the writer thread once the round-trip delay is known
 									
     err = Pa_StartStream( stream );
 	if( err != paNoError ) 
 	{
-		printf( "ERROR: Pa_StartStream returned %i\n", err );
+		fprintf(msg, "ERROR: Pa_StartStream returned %i\n", err );
         goto pa_error;
 	}
 
-    while( Pa_IsStreamActive( stream ) )
-    {
-        Pa_Sleep(1); // sleep while audio I/O
-    }
+	// Record and play audio data:	
+	if ( serverBase ) {
+		status = RunServer( &data, stream, serverBase );
+	}
+	else if ( sweepMode ) {
+		status = RunSweep( &data, stream, &sweep );
+		ttSineSweepFree( &sweep );
+	}
+	else if ( analyserBase ) {
+		status = RunAnalyser( &data, stream, analyserBase, argc == 2, fftSize, overlap, exponential, interval, transfer );
+	}
+	else {
+		status = RunJob( &data, stream );
+	}
+
+    err = Pa_StopStream( stream );
+	if( err != paNoError ) 
+	{
+		fprintf(msg, "ERROR: Pa_StopStream returned %i\n", err );
+        goto pa_error;
+	}
     err = Pa_CloseStream( stream );
 	if( err != paNoError ) 
 	{
-		printf( "ERROR: Pa_CloseStream returned %i\n", err );
+		fprintf(msg, "ERROR: Pa_CloseStream returned %i\n", err );
         goto pa_error;
 	}
 
     Pa_Terminate();
-
-	// print header:
-    printf("%% Number of frames = %lu\n", data.numFrames);
-    printf("%% Number of sound output channels = %d\n", data.numOutputDeviceChannels);
-    printf("%% Number of sound input channels = %d\n", data.numInputDeviceChannels);
-    printf("%% Sampling rate = %f Hz\n", data.samplingRate);
-	printf("%%\n");
-	printf("%% Recorded data:\n"),
-    printf("%% time (s)\t");
-    for( iChannel=0; iChannel < data.numInputDeviceChannels;)
-    {
-        iChannel++;
-        printf("channel-%lu ",iChannel);
-    }
-    printf("\n");
-    
-	// print recorded data:
-    float frameTime;
-    for( iFrame=0; iFrame<data.numFrames; iFrame++ )
-    {
-	frameTime = (float)iFrame / data.samplingRate;
-        printf("%E",frameTime); // print frame sampling time
-        for( iChannel = 0; iChannel < data.numInputDeviceChannels; iChannel++ )
-        {
-            printf("\t");
-            printf("%E",data.inputSamples[iFrame*data.numInputDeviceChannels+iChannel]);
-        }
-        printf("\n");
-    }
 		
 	// clean up:
-    free(data.inputSamples);
-    free(data.outputSamples);
+    ttRingBufferFree( &data.inputRing );
+    ttRingBufferFree( &data.outputRing );
+    CloseSource( &data );
+    free( data.inputChannelMap );
+    free( data.outputChannelMap );
+    free( data.noise );
+    free( data.levels );
+    free( data.levelMin );
+    free( data.levelMax );
+    free( data.levelSum );
+    free( data.levelSumSq );
+    free( data.clipCount );
 					
 	// exit:
-    return 0;
+    return status;
 	
 pa_error:
     fprintf( stderr, "An error occured while using the portaudio stream\n" );
@@ -413,6 +2082,7 @@ pa_error:
 	goto error;
 
 error:
+    if ( stream ) Pa_AbortStream( stream );
     Pa_Terminate();
 	return -1;
 	
@@ -0,0 +1,98 @@
+/*
+ * Audio device and channel selection for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ttDevice.h"
+
+/* Find an audio device by its index or its name (exact match, or else the first device whose name contains the given string).
+** Only devices with input channels (isInput != 0) or output channels (isInput == 0) are considered. Returns the device index, or paNoDevice if no device was found.
+*/
+PaDeviceIndex ttFindDevice( const char *spec, int isInput )
+{
+    PaDeviceIndex	i, numDevices;
+    const PaDeviceInfo	*info;
+    char		*end;
+    long		k;
+    
+    numDevices = Pa_GetDeviceCount();
+    
+    k = strtol( spec, &end, 10 );
+    if ( *spec != '\0' && *end == '\0' ) { // device index
+		return ( k >= 0 && k < numDevices ) ? (PaDeviceIndex) k : paNoDevice;
+	}
+    
+    for ( i = 0; i < numDevices; i++ ) { // exact match
+		info = Pa_GetDeviceInfo( i );
+		if ( ( isInput ? info->maxInputChannels : info->maxOutputChannels ) > 0 && strcmp(info->name,spec) == 0 ) return i;
+	}
+    for ( i = 0; i < numDevices; i++ ) { // partial match
+		info = Pa_GetDeviceInfo( i );
+		if ( ( isInput ? info->maxInputChannels : info->maxOutputChannels ) > 0 && strstr(info->name,spec) != NULL ) return i;
+	}
+    return paNoDevice;
+}
+
+/* Parse a comma separated list of channel numbers (one-based, e.g. "1,2") into a newly allocated array of zero-based channel indices.
+** If list == NULL, all channels 1...maxChannels are used. Returns the number of channels, or 0 if the list is invalid.
+*/
+unsigned int ttParseChannelList( const char *list, unsigned int maxChannels, unsigned int **map )
+{
+    unsigned int	n = 0, k;
+    const char		*u;
+    char		*end;
+    long		c;
+    
+    if ( list == NULL ) {
+		*map = (unsigned int *) malloc( maxChannels*sizeof(unsigned int) );
+		if ( *map == NULL ) return 0;
+		for ( k = 0; k < maxChannels; k++ ) (*map)[k] = k;
+		return maxChannels;
+	}
+    
+    for ( u = list; *u; u++ ) if ( *u == ',' ) n++;
+    *map = (unsigned int *) malloc( (n+1)*sizeof(unsigned int) );
+    if ( *map == NULL ) return 0;
+    
+    n = 0;
+    u = list;
+    while ( *u ) {
+		c = strtol( u, &end, 10 );
+		if ( end == u || c < 1 || c > (long) maxChannels || ( *end != ',' && *end != '\0' ) ) {
+			free( *map );
+			*map = NULL;
+			return 0;
+		}
+		(*map)[n++] = (unsigned int) c-1;
+		u = ( *end == ',' ) ? end+1 : end;
+	}
+    return n;
+}
+
+/* Number of device channels that need to be opened for the channels in the map (the highest channel number in the map). */
+unsigned int ttMaxChannel( const unsigned int *map, unsigned int n )
+{
+    unsigned int k, m = 0;
+    
+    for ( k = 0; k < n; k++ ) if ( map[k]+1 > m ) m = map[k]+1;
+    return m;
+}
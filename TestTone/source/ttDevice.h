@@ -0,0 +1,45 @@
+/*
+ * Audio device and channel selection for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+Helper functions shared by TestTone and the TestToneOct module for Octave: finding the audio devices by index or name, and parsing the lists of channels to be used.
+*/
+
+#ifndef TT_DEVICE_H
+#define TT_DEVICE_H
+
+#include "portaudio.h"
+
+/* Find an audio device by its index or its name (exact match, or else the first device whose name contains the given string).
+** Only devices with input channels (isInput != 0) or output channels (isInput == 0) are considered. Returns the device index, or paNoDevice if no device was found.
+*/
+PaDeviceIndex ttFindDevice( const char *spec, int isInput );
+
+/* Parse a comma separated list of channel numbers (one-based, e.g. "1,2") into a newly allocated array of zero-based channel indices.
+** If list == NULL, all channels 1...maxChannels are used. Returns the number of channels, or 0 if the list is invalid.
+*/
+unsigned int ttParseChannelList( const char *list, unsigned int maxChannels, unsigned int **map );
+
+/* Number of device channels that need to be opened for the channels in the map (the highest channel number in the map). */
+unsigned int ttMaxChannel( const unsigned int *map, unsigned int n );
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * Playing and recording audio data held in memory (used by the TestToneOct module for Octave).
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+#include <string.h>
+#include "ttPlayRec.h"
+#include "ttRingBuffer.h"
+#include "ttDevice.h"
+
+#define TT_PLAYREC_SAMPLE_TYPE	paFloat32
+
+/* PortAudio callback: copies the test signal from pr->play to the output buffer and the recorded data from the input buffer to pr->rec. No memory is allocated, and no system calls are made. */
+static int PlayRecCallback( const void *inputBuffer, void *outputBuffer, unsigned long framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void *userData )
+{
+    ttPlayRec		*pr = (ttPlayRec *) userData;
+    const float		*in = (const float *) inputBuffer;
+    float		*out = (float *) outputBuffer;
+    unsigned int	nDevIn = pr->numInputDeviceChannels;
+    unsigned int	nDevOut = pr->numOutputDeviceChannels;
+    unsigned long	k,iFrame,iRec,end;
+    unsigned int	c,cPlay;
+    double		delay;
+    
+    memset( out, 0, framesPerBuffer*nDevOut*sizeof(float) );
+    if ( !pr->running ) return paContinue;
+    ttMemoryBarrier(); // make sure the buffers set up before pr->running are visible
+    
+    if ( statusFlags & ( paInputOverflow | paOutputUnderflow ) ) pr->xrun = 1;
+    
+    if ( pr->processedFrames == 0 ) {
+		// first buffer: the first output frame reaches the DAC at outputBufferDacTime, the first input frame was sampled by the ADC at inputBufferAdcTime
+		delay = timeInfo->outputBufferDacTime - timeInfo->inputBufferAdcTime;
+		if ( timeInfo->outputBufferDacTime <= 0 || timeInfo->inputBufferAdcTime <= 0 || delay <= 0 ) {
+			delay = pr->inputLatency + pr->outputLatency; // no time stamps from the host API
+		}
+		pr->delay = delay;
+		pr->skipFrames = pr->trimCapture ? (unsigned long) (delay*pr->samplingRate + 0.5) : 0;
+	}
+    
+    end = pr->skipFrames + pr->recordFrames;
+    for ( k = 0; k < framesPerBuffer; k++ ) {
+		iFrame = pr->processedFrames + k;
+		if ( iFrame < pr->numFrames ) { // test signal
+			for ( c = 0; c < pr->numOutputChannels; c++ ) {
+				cPlay = ( c < pr->numPlayChannels ) ? c : pr->numPlayChannels-1;
+				out[k*nDevOut + pr->outputChannelMap[c]] = pr->play[cPlay*pr->numFrames + iFrame];
+			}
+		}
+		if ( in && iFrame >= pr->skipFrames && iFrame < end ) { // recorded data
+			iRec = iFrame - pr->skipFrames;
+			for ( c = 0; c < pr->numInputChannels; c++ ) {
+				pr->rec[c*pr->recordFrames + iRec] = in[k*nDevIn + pr->inputChannelMap[c]];
+			}
+		}
+	}
+    if ( in == NULL ) pr->xrun = 1; // no input data, should not happen
+    
+    pr->processedFrames += framesPerBuffer;
+    if ( pr->processedFrames >= end ) {
+		pr->running = 0;
+		ttMemoryBarrier();
+		pr->finished = 1;
+	}
+    
+    return paContinue;
+}
+
+
+PaError ttPlayRecOpen( ttPlayRec *pr )
+{
+    PaStreamParameters	inputParameters, outputParameters;
+    const PaDeviceInfo	*inputInfo, *outputInfo;
+    const PaStreamInfo	*streamInfo;
+    PaError		err;
+    
+    pr->stream = NULL;
+    pr->running = 0;
+    pr->finished = 0;
+    inputInfo = Pa_GetDeviceInfo( pr->inputDevice );
+    outputInfo = Pa_GetDeviceInfo( pr->outputDevice );
+    if ( inputInfo == NULL || outputInfo == NULL ) return paInvalidDevice;
+    
+    // no need to transfer channels above the highest channel used:
+    pr->numInputDeviceChannels = ttMaxChannel( pr->inputChannelMap, pr->numInputChannels );
+    pr->numOutputDeviceChannels = ttMaxChannel( pr->outputChannelMap, pr->numOutputChannels );
+    
+    inputParameters.device = pr->inputDevice;
+    inputParameters.channelCount = pr->numInputDeviceChannels;
+    inputParameters.sampleFormat = TT_PLAYREC_SAMPLE_TYPE;
+    inputParameters.suggestedLatency = ( pr->suggestedLatency >= 0 ) ? pr->suggestedLatency : inputInfo->defaultLowInputLatency;
+    inputParameters.hostApiSpecificStreamInfo = NULL;
+    
+    outputParameters.device = pr->outputDevice;
+    outputParameters.channelCount = pr->numOutputDeviceChannels;
+    outputParameters.sampleFormat = TT_PLAYREC_SAMPLE_TYPE;
+    outputParameters.suggestedLatency = ( pr->suggestedLatency >= 0 ) ? pr->suggestedLatency : outputInfo->defaultLowOutputLatency;
+    outputParameters.hostApiSpecificStreamInfo = NULL;
+    
+    err = Pa_OpenStream( &pr->stream, &inputParameters, &outputParameters, pr->samplingRate, pr->framesPerBuffer, paClipOff, PlayRecCallback, pr );
+    if ( err != paNoError ) {
+		pr->stream = NULL;
+		return err;
+	}
+    
+    streamInfo = Pa_GetStreamInfo( pr->stream );
+    if ( streamInfo ) {
+		pr->inputLatency = streamInfo->inputLatency;
+		pr->outputLatency = streamInfo->outputLatency;
+	}
+    
+    // the callback plays silence until ttPlayRecStart sets pr->running:
+    err = Pa_StartStream( pr->stream );
+    if ( err != paNoError ) {
+		Pa_CloseStream( pr->stream );
+		pr->stream = NULL;
+	}
+    return err;
+}
+
+
+PaError ttPlayRecStart( ttPlayRec *pr )
+{
+    if ( pr->stream == NULL ) return paBadStreamPtr;
+    if ( pr->numPlayChannels == 0 && pr->numFrames > 0 ) return paInvalidChannelCount;
+    pr->processedFrames = 0;
+    pr->skipFrames = 0;
+    pr->delay = 0;
+    pr->xrun = 0;
+    pr->finished = 0;
+    ttMemoryBarrier(); // publish the buffers before the callback starts using them
+    pr->running = 1;
+    return paNoError;
+}
+
+
+int ttPlayRecIsDone( ttPlayRec *pr )
+{
+    if ( pr->finished ) {
+		ttMemoryBarrier(); // make sure the recorded data written by the callback are visible
+		return 1;
+	}
+    return 0;
+}
+
+
+void ttPlayRecWait( ttPlayRec *pr )
+{
+    while ( !ttPlayRecIsDone( pr ) ) Pa_Sleep(1);
+}
+
+
+PaError ttPlayRecClose( ttPlayRec *pr )
+{
+    PaError err;
+    
+    if ( pr->stream == NULL ) return paNoError;
+    pr->running = 0;
+    err = pr->finished ? Pa_StopStream( pr->stream ) : Pa_AbortStream( pr->stream );
+    if ( err == paNoError ) err = Pa_CloseStream( pr->stream );
+    else Pa_CloseStream( pr->stream );
+    pr->stream = NULL;
+    return err;
+}
@@ -0,0 +1,89 @@
+/*
+ * Playing and recording audio data held in memory (used by the TestToneOct module for Octave).
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+ttPlayRec plays a test signal from memory and records the response into memory, without the reader / writer threads, ring buffers and files used by TestTone. The PortAudio callback reads the test-signal samples directly from the caller's buffer and writes the recorded samples directly into the caller's buffer. Both buffers are stored channel by channel (column-major, as Octave and Matlab matrices), so that the data of an Octave matrix can be used without copying. The buffers must not be touched (or released) while the stream is running.
+
+The round-trip delay is determined from the time stamps of the first buffer, as in TestTone. If the capture is trimmed, the frames recorded before the test signal arrived are discarded by the callback, so that the recorded data are aligned with the test signal.
+
+Typical use: ttPlayRecOpen, ttPlayRecStart, poll ttPlayRecIsDone (or ttPlayRecWait), ttPlayRecClose. ttPlayRecClose may also be called before the recording is done (e.g. if the user interrupts the measurement), the stream is then aborted.
+*/
+
+#ifndef TT_PLAYREC_H
+#define TT_PLAYREC_H
+
+#include "portaudio.h"
+
+typedef struct
+{
+    // set by the caller before ttPlayRecOpen:
+    PaDeviceIndex	inputDevice;
+    PaDeviceIndex	outputDevice;
+    const unsigned int	*inputChannelMap;	// device channels to be recorded (zero-based)
+    unsigned int	numInputChannels;
+    const unsigned int	*outputChannelMap;	// device channels used for the test signal (zero-based)
+    unsigned int	numOutputChannels;
+    double		samplingRate;
+    unsigned long	framesPerBuffer;	// 0: let PortAudio decide
+    double		suggestedLatency;	// negative: default low latency of the devices
+    int			trimCapture;		// discard the frames recorded before the test signal arrived
+
+    // set by the caller before ttPlayRecStart:
+    const float		*play;			// test signal, numPlayChannels columns of numFrames samples (if the test signal has less channels than numOutputChannels, the last channel is also played on the remaining channels)
+    unsigned int	numPlayChannels;
+    unsigned long	numFrames;		// frames in the test signal
+    float		*rec;			// recorded data, numInputChannels columns of recordFrames samples
+    unsigned long	recordFrames;		// frames to be recorded
+
+    // results:
+    double		inputLatency;		// latencies reported by Pa_GetStreamInfo
+    double		outputLatency;
+    double		delay;			// round-trip delay (s) from the time stamps of the first buffer
+    int			xrun;			// set if PortAudio reported an input overflow or output underflow
+
+    // internal:
+    PaStream		*stream;
+    unsigned int	numInputDeviceChannels;
+    unsigned int	numOutputDeviceChannels;
+    unsigned long	processedFrames;	// frames handled by the callback
+    unsigned long	skipFrames;		// recorded frames discarded before the test signal arrived
+    volatile int	running;
+    volatile int	finished;
+}
+ttPlayRec;
+
+/* Open the audio stream. Returns paNoError on success, or the PortAudio error code. */
+PaError ttPlayRecOpen( ttPlayRec *pr );
+
+/* Start playing pr->play and recording into pr->rec. Returns paNoError on success, or the PortAudio error code. */
+PaError ttPlayRecStart( ttPlayRec *pr );
+
+/* Returns 1 once all frames were recorded, 0 otherwise. */
+int ttPlayRecIsDone( ttPlayRec *pr );
+
+/* Wait until all frames were recorded. */
+void ttPlayRecWait( ttPlayRec *pr );
+
+/* Stop and close the audio stream (immediately, if the recording is not done yet). Returns paNoError on success, or the PortAudio error code. */
+PaError ttPlayRecClose( ttPlayRec *pr );
+
+#endif
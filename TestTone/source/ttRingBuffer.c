@@ -0,0 +1,137 @@
+/*
+ * Single-producer / single-consumer lock-free ring buffer for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ttRingBuffer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/* Memory barriers: the writer publishes its data before advancing the write index, the reader consumes the data before advancing the read index. */
+#if defined(__GNUC__)
+#define LOAD_ACQUIRE(p)		__atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define STORE_RELEASE(p,v)	__atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+#define FULL_BARRIER()		__atomic_thread_fence( __ATOMIC_SEQ_CST )
+#elif defined(_MSC_VER)
+#define LOAD_ACQUIRE(p)		( *(p) ) // volatile accesses have acquire / release semantics with MSVC
+#define STORE_RELEASE(p,v)	( MemoryBarrier(), *(p) = (v) )
+#define FULL_BARRIER()		MemoryBarrier()
+#else
+#error "ttRingBuffer: no memory barriers available for this compiler."
+#endif
+
+int ttRingBufferInit( ttRingBuffer *rb, unsigned long minSize )
+{
+    unsigned long size = 1;
+    
+    while ( size < minSize ) size <<= 1;
+    
+    rb->buffer = (float *) malloc( size*sizeof(float) );
+    if ( rb->buffer == NULL ) return -1;
+    
+    // touch every page now (and keep it in RAM if the OS allows), so that the audio callback will not cause page faults:
+    memset( rb->buffer, 0, size*sizeof(float) );
+#ifdef _WIN32
+    VirtualLock( rb->buffer, size*sizeof(float) );
+#else
+    mlock( rb->buffer, size*sizeof(float) ); // failure is harmless (e.g. RLIMIT_MEMLOCK too small)
+#endif
+    
+    rb->size = size;
+    rb->mask = size-1;
+    rb->writeIndex = 0;
+    rb->readIndex = 0;
+    return 0;
+}
+
+void ttRingBufferFree( ttRingBuffer *rb )
+{
+    if ( rb->buffer ) {
+#ifdef _WIN32
+		VirtualUnlock( rb->buffer, rb->size*sizeof(float) );
+#else
+		munlock( rb->buffer, rb->size*sizeof(float) );
+#endif
+		free( rb->buffer );
+	}
+    rb->buffer = NULL;
+    rb->size = rb->mask = 0;
+}
+
+void ttRingBufferFlush( ttRingBuffer *rb )
+{
+    rb->writeIndex = 0;
+    rb->readIndex = 0;
+}
+
+unsigned long ttRingBufferGetWriteAvailable( ttRingBuffer *rb )
+{
+    return rb->size - ( rb->writeIndex - LOAD_ACQUIRE(&rb->readIndex) );
+}
+
+unsigned long ttRingBufferGetReadAvailable( ttRingBuffer *rb )
+{
+    return LOAD_ACQUIRE(&rb->writeIndex) - rb->readIndex;
+}
+
+unsigned long ttRingBufferWrite( ttRingBuffer *rb, const float *data, unsigned long n )
+{
+    unsigned long avail, start, n1;
+    
+    avail = ttRingBufferGetWriteAvailable( rb );
+    if ( n > avail ) n = avail;
+    
+    start = rb->writeIndex & rb->mask;
+    n1 = rb->size - start; // samples until the end of the buffer
+    if ( n1 > n ) n1 = n;
+    memcpy( rb->buffer+start, data, n1*sizeof(float) );
+    memcpy( rb->buffer, data+n1, (n-n1)*sizeof(float) ); // wrap around
+    
+    STORE_RELEASE( &rb->writeIndex, rb->writeIndex+n );
+    return n;
+}
+
+unsigned long ttRingBufferRead( ttRingBuffer *rb, float *data, unsigned long n )
+{
+    unsigned long avail, start, n1;
+    
+    avail = ttRingBufferGetReadAvailable( rb );
+    if ( n > avail ) n = avail;
+    
+    start = rb->readIndex & rb->mask;
+    n1 = rb->size - start;
+    if ( n1 > n ) n1 = n;
+    memcpy( data, rb->buffer+start, n1*sizeof(float) );
+    memcpy( data+n1, rb->buffer, (n-n1)*sizeof(float) );
+    
+    STORE_RELEASE( &rb->readIndex, rb->readIndex+n );
+    return n;
+}
+
+void ttMemoryBarrier( void )
+{
+    FULL_BARRIER();
+}
@@ -0,0 +1,60 @@
+/*
+ * Single-producer / single-consumer lock-free ring buffer for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+The ring buffer moves float samples between exactly one writer and exactly one reader thread (e.g. a file reader thread and the PortAudio callback) without locks. The read and write indices run freely and are wrapped with a bit mask, so the size of the buffer is always a power of two. The memory of the buffer is allocated, touched and (where possible) locked when the buffer is created, so that the PortAudio callback never touches a page that has not been faulted in.
+*/
+
+#ifndef TT_RINGBUFFER_H
+#define TT_RINGBUFFER_H
+
+typedef struct
+{
+    unsigned long	size;		// number of samples in the buffer (power of two)
+    unsigned long	mask;		// size-1
+    volatile unsigned long	writeIndex;	// only modified by the writer
+    volatile unsigned long	readIndex;	// only modified by the reader
+    float		*buffer;
+}
+ttRingBuffer;
+
+/* Allocate a ring buffer holding at least minSize samples. Returns 0 on success, -1 if the memory could not be allocated. */
+int ttRingBufferInit( ttRingBuffer *rb, unsigned long minSize );
+
+/* Release the memory of the ring buffer. */
+void ttRingBufferFree( ttRingBuffer *rb );
+
+/* Discard all data in the ring buffer. Must not be called while the reader or the writer are active. */
+void ttRingBufferFlush( ttRingBuffer *rb );
+
+/* Number of samples that can be written / read without blocking. */
+unsigned long ttRingBufferGetWriteAvailable( ttRingBuffer *rb );
+unsigned long ttRingBufferGetReadAvailable( ttRingBuffer *rb );
+
+/* Write / read up to n samples. Return the number of samples actually written / read. */
+unsigned long ttRingBufferWrite( ttRingBuffer *rb, const float *data, unsigned long n );
+unsigned long ttRingBufferRead( ttRingBuffer *rb, float *data, unsigned long n );
+
+/* Full memory barrier, for publishing other data shared between the threads (e.g. flags telling the callback to start). */
+void ttMemoryBarrier( void );
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * Stepped-sine distortion sweep for TestTone (see ttSineSweep.h).
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ttSineSweep.h"
+
+#define PI		(3.141592653589793)
+#define TT_SWEEP_RAMP_SECONDS	0.005	// length of the fade-in and fade-out of each tone
+
+int ttSineSweepInit( ttSineSweep *sw, double samplingRate, double f1, double f2, unsigned int numSteps, double amplitude, unsigned long blockSize, unsigned long numBlocks, double settleTime, unsigned long marginFrames, unsigned int numHarmonics )
+{
+    unsigned long	k, b, settleFrames, n;
+    unsigned int	i;
+    double		f;
+
+    memset( sw, 0, sizeof(ttSineSweep) );
+    if ( samplingRate <= 0 || f1 <= 0 || f2 < f1 || numSteps < 1 || blockSize < 16 || numBlocks < 1 || settleTime < 0 || numHarmonics < 1 ) return -1;
+    if ( numHarmonics > TT_SWEEP_MAX_HARMONICS ) numHarmonics = TT_SWEEP_MAX_HARMONICS;
+    if ( ttFFTPlanInit( &sw->plan, blockSize ) != 0 ) return -1;
+
+    sw->samplingRate = samplingRate;
+    sw->amplitude = amplitude;
+    sw->blockSize = blockSize;
+    sw->numBlocks = numBlocks;
+    sw->numHarmonics = numHarmonics;
+    sw->tolerance = TT_SWEEP_TOLERANCE;
+    sw->hop = blockSize/4;
+    sw->rampFrames = (unsigned long) ( TT_SWEEP_RAMP_SECONDS*samplingRate ) + 1;
+    settleFrames = (unsigned long) ceil( settleTime*samplingRate / sw->hop ) * sw->hop;
+    sw->lastStart = sw->rampFrames + settleFrames;
+    sw->stepFrames = sw->lastStart + numBlocks*blockSize + marginFrames + sw->rampFrames;
+    n = sw->lastStart + numBlocks*blockSize; // frames kept of each tone
+
+    sw->bin = (unsigned long *) malloc( numSteps*sizeof(unsigned long) );
+    sw->cosTable = (double *) malloc( blockSize*sizeof(double) );
+    sw->sinTable = (double *) malloc( blockSize*sizeof(double) );
+    sw->buffer[0] = (float *) malloc( n*sizeof(float) );
+    sw->buffer[1] = (float *) malloc( n*sizeof(float) );
+    sw->x = (double *) malloc( blockSize*sizeof(double) );
+    sw->power = (double *) malloc( (blockSize/2+1)*sizeof(double) );
+    sw->avgPower = (double *) malloc( (blockSize/2+1)*sizeof(double) );
+    if ( !sw->bin || !sw->cosTable || !sw->sinTable || !sw->buffer[0] || !sw->buffer[1] || !sw->x || !sw->power || !sw->avgPower ) {
+		ttSineSweepFree( sw );
+		return -1;
+	}
+
+    for ( k = 0; k < blockSize; k++ ) {
+		sw->cosTable[k] = cos( 2.0*PI*k/blockSize );
+		sw->sinTable[k] = sin( 2.0*PI*k/blockSize );
+	}
+
+    // tone frequencies, adjusted to the FFT bins (no DC and Nyquist tones, no duplicates):
+    for ( i = 0; i < numSteps; i++ ) {
+		f = ( numSteps > 1 ) ? f1 * pow( f2/f1, (double)i/(numSteps-1) ) : f1;
+		b = (unsigned long) ( f*blockSize/samplingRate + 0.5 );
+		if ( b < 1 ) b = 1;
+		if ( b > blockSize/2-1 ) b = blockSize/2-1;
+		if ( sw->numSteps == 0 || b != sw->bin[sw->numSteps-1] ) sw->bin[sw->numSteps++] = b;
+	}
+
+    sw->captureStep = 0;
+    sw->capturePos = 0;
+    sw->captureBuffer = 0;
+    sw->checkStart = sw->rampFrames;
+    sw->windowStart = -1;
+    return 0;
+}
+
+void ttSineSweepFree( ttSineSweep *sw )
+{
+    ttFFTPlanFree( &sw->plan );
+    free( sw->bin );
+    free( sw->cosTable );
+    free( sw->sinTable );
+    free( sw->buffer[0] );
+    free( sw->buffer[1] );
+    free( sw->x );
+    free( sw->power );
+    free( sw->avgPower );
+    memset( sw, 0, sizeof(ttSineSweep) );
+}
+
+unsigned long ttSineSweepFrames( const ttSineSweep *sw )
+{
+    return sw->numSteps * sw->stepFrames;
+}
+
+double ttSineSweepFrequency( const ttSineSweep *sw, unsigned int step )
+{
+    return sw->bin[step] * sw->samplingRate / sw->blockSize;
+}
+
+void ttSineSweepGenerate( const ttSineSweep *sw, float *buf, unsigned long startFrame, unsigned long n )
+{
+    unsigned long	k, j, p, step;
+    double		w, env;
+
+    for ( k = 0; k < n; k++ ) {
+		j = startFrame + k;
+		step = j / sw->stepFrames;
+		if ( step >= sw->numSteps ) {
+			buf[k] = 0;
+			continue;
+		}
+		p = j - step*sw->stepFrames; // frame within the tone
+		w = 2.0*PI*sw->bin[step]/sw->blockSize;
+		env = 1.0;
+		if ( p < sw->rampFrames ) {
+			env = 0.5 - 0.5*cos( PI*p/sw->rampFrames );
+		}
+		else if ( p >= sw->stepFrames - sw->rampFrames ) {
+			env = 0.5 - 0.5*cos( PI*(sw->stepFrames-1-p)/sw->rampFrames );
+		}
+		buf[k] = (float) ( sw->amplitude * env * sin( w*p ) );
+	}
+}
+
+/* Fundamental of the tone in the block of the current tone starting at frame 'start' (DFT at the bin of the tone, relative to the start of the tone, so that the result does not depend on the start of the block if the response has settled). */
+static void Phasor( const ttSineSweep *sw, unsigned long start, double *re, double *im )
+{
+    const float		*x = sw->buffer[sw->captureBuffer] + start;
+    unsigned long	b = sw->bin[sw->captureStep];
+    unsigned long	k, m;
+
+    *re = *im = 0;
+    m = (unsigned long) ( ( (unsigned long long) b * start ) % sw->blockSize );
+    for ( k = 0; k < sw->blockSize; k++ ) {
+		*re += x[k] * sw->cosTable[m];
+		*im -= x[k] * sw->sinTable[m];
+		m += b;
+		if ( m >= sw->blockSize ) m -= sw->blockSize;
+	}
+}
+
+unsigned long ttSineSweepAddFrames( ttSineSweep *sw, const float *frames, unsigned long n, unsigned int stride )
+{
+    unsigned long	done;
+    double		re, im, d;
+
+    for ( done = 0; done < n; done++ ) {
+		if ( sw->ready || sw->captureStep >= sw->numSteps ) break;
+
+		if ( !sw->windowDone ) sw->buffer[sw->captureBuffer][sw->capturePos] = frames[done*stride];
+		sw->capturePos++;
+
+		// check the next block for settling:
+		if ( sw->windowStart < 0 && sw->capturePos == sw->checkStart + sw->blockSize ) {
+			Phasor( sw, sw->checkStart, &re, &im );
+			d = sqrt( (re-sw->lastRe)*(re-sw->lastRe) + (im-sw->lastIm)*(im-sw->lastIm) );
+			if ( sw->havePhasor && d <= sw->tolerance*sqrt(re*re+im*im) && ( re != 0 || im != 0 ) ) {
+				sw->windowStart = sw->checkStart;
+				sw->windowSettled = 1;
+			}
+			else {
+				sw->lastRe = re;
+				sw->lastIm = im;
+				sw->havePhasor = 1;
+				sw->checkStart += sw->hop;
+				if ( sw->checkStart > sw->lastStart ) { // not settled in time, use the last possible window
+					sw->windowStart = sw->lastStart;
+					sw->windowSettled = 0;
+				}
+			}
+		}
+
+		// analysis window complete:
+		if ( sw->windowStart >= 0 && !sw->windowDone && sw->capturePos == (unsigned long) sw->windowStart + sw->numBlocks*sw->blockSize ) {
+			sw->readyStep = sw->captureStep;
+			sw->readyBuffer = sw->captureBuffer;
+			sw->readyStart = sw->windowStart;
+			sw->readySettled = sw->windowSettled;
+			sw->windowDone = 1;
+			sw->ready = 1;
+		}
+
+		// end of the tone:
+		if ( sw->capturePos == sw->stepFrames ) {
+			sw->captureStep++;
+			sw->capturePos = 0;
+			sw->captureBuffer = 1 - sw->captureBuffer;
+			sw->checkStart = sw->rampFrames;
+			sw->havePhasor = 0;
+			sw->windowStart = -1;
+			sw->windowDone = 0;
+		}
+	}
+    return done;
+}
+
+/* Sum of the power of the bins k-1...k+1. */
+static double PeakPower( const ttSineSweep *sw, unsigned long k )
+{
+    unsigned long	nb = sw->blockSize/2;
+    double		p = sw->avgPower[k];
+
+    if ( k > 1 ) p += sw->avgPower[k-1];
+    if ( k+1 < nb ) p += sw->avgPower[k+1];
+    return p;
+}
+
+void ttSineSweepAnalyse( ttSineSweep *sw, unsigned int step, unsigned int buffer, unsigned long start, int settled, ttSineSweepResult *r )
+{
+    unsigned long	nb = sw->blockSize/2;
+    unsigned long	k, b, k0 = sw->bin[step];
+    unsigned int	h;
+    const float		*x;
+    double		scale = 2.0 / sw->blockSize; // amplitude of a sine at a bin (rectangular window)
+    double		p0, ph, pHarm = 0, pAll = 0;
+
+    // average the power spectra of the blocks:
+    memset( sw->avgPower, 0, (nb+1)*sizeof(double) );
+    for ( b = 0; b < sw->numBlocks; b++ ) {
+		x = sw->buffer[buffer] + start + b*sw->blockSize;
+		for ( k = 0; k < sw->blockSize; k++ ) sw->x[k] = x[k];
+		ttFFTPower( &sw->plan, sw->x, sw->power );
+		for ( k = 0; k <= nb; k++ ) sw->avgPower[k] += sw->power[k] / sw->numBlocks;
+	}
+
+    p0 = PeakPower( sw, k0 );
+    r->frequency = ttSineSweepFrequency( sw, step );
+    r->amplitude = sqrt(p0) * scale;
+    r->settleTime = start / sw->samplingRate;
+    r->settled = settled;
+    r->numHarmonics = sw->numHarmonics;
+    r->harmonic[0] = r->amplitude;
+    for ( h = 2; h <= sw->numHarmonics; h++ ) {
+		if ( h*k0+1 < nb ) {
+			ph = PeakPower( sw, h*k0 );
+			pHarm += ph;
+			r->harmonic[h-1] = sqrt(ph) * scale;
+		}
+		else {
+			r->harmonic[h-1] = 0;
+		}
+	}
+
+    // everything except DC, Nyquist and the fundamental:
+    for ( k = 1; k < nb; k++ ) {
+		if ( k+1 < k0 || k > k0+1 ) pAll += sw->avgPower[k];
+	}
+
+    r->thd = ( p0 > 0 ) ? sqrt( pHarm/p0 ) : 0;
+    r->thdn = ( p0 > 0 ) ? sqrt( pAll/p0 ) : 0;
+}
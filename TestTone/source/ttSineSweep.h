@@ -0,0 +1,119 @@
+/*
+ * Stepped-sine distortion sweep for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+The stepped-sine sweep plays a series of sine tones with logarithmically spaced frequencies back to back in one sound stream, and determines the harmonic distortion (THD), the distortion plus noise (THD+N) and the levels of the harmonics for each tone. The tone frequencies are adjusted to the bins of an FFT of blockSize frames, so that the analysis needs no window function (no leakage).
+
+Each tone (one 'step' of stepFrames frames) consists of a raised-cosine fade-in of rampFrames frames, the steady part, and a fade-out of rampFrames frames. The tones are generated on the fly (ttSineSweepGenerate), so the memory needed does not depend on the number of tones.
+
+The recorded frames (aligned with the played tones) are passed to ttSineSweepAddFrames as they arrive. For each tone, the fundamental is tracked in blocks of blockSize frames starting every 'hop' frames after the fade-in. The response has settled as soon as the fundamental (amplitude and phase) of two consecutive blocks differs by less than the tolerance, and the analysis window of numBlocks blocks starts there. The transient response of the DUT to the start of the tone is therefore skipped automatically, and the settling time is reported. If the response does not settle within the settling time given to ttSineSweepInit, the last possible analysis window of the step is used and the tone is flagged as not settled.
+
+The frames of the analysis window are kept in one of two buffers. Once the window of a tone is complete, ttSineSweepAddFrames sets the 'ready' flag and stops taking frames until the caller has passed the tone to ttSineSweepAnalyse (which may run in a separate thread while the frames of the next tone are collected in the other buffer) and cleared the flag. ttSineSweepAnalyse averages the power spectra of the numBlocks blocks and computes the results of the tone. The fundamental and the harmonics are summed over their FFT bin and the two neighbouring bins, which allows for a small clock mismatch of the DAC and the ADC.
+*/
+
+#ifndef TT_SINESWEEP_H
+#define TT_SINESWEEP_H
+
+#include "ttSpectrum.h"
+
+#define TT_SWEEP_MAX_HARMONICS	20
+#define TT_SWEEP_TOLERANCE	1E-3	// default settling tolerance (relative change of the fundamental between consecutive blocks)
+
+typedef struct
+{
+    double		frequency;	// frequency of the tone (Hz)
+    double		amplitude;	// amplitude (zero-to-peak) of the fundamental
+    double		thd;		// total harmonic distortion (relative to the fundamental)
+    double		thdn;		// total harmonic distortion plus noise (all bins except DC and the fundamental, relative to the fundamental)
+    double		settleTime;	// start of the analysis window (s, from the start of the tone)
+    int			settled;	// the response settled within the settling time
+    unsigned int	numHarmonics;	// number of values in harmonic
+    double		harmonic[TT_SWEEP_MAX_HARMONICS];	// amplitudes (zero-to-peak) of the fundamental (harmonic[0]) and the harmonics (harmonic[h-1], 0 above the Nyquist frequency)
+}
+ttSineSweepResult;
+
+typedef struct
+{
+    double		samplingRate;
+    unsigned int	numSteps;	// number of tones
+    unsigned long	*bin;		// FFT bins of the tones
+    double		amplitude;	// amplitude of the tones (zero-to-peak)
+    unsigned long	blockSize;	// FFT size (power of two)
+    unsigned long	numBlocks;	// number of blocks analysed per tone
+    unsigned long	hop;		// frames between the starts of the blocks checked for settling
+    unsigned long	rampFrames;	// length of the fade-in and fade-out
+    unsigned long	lastStart;	// latest start of the analysis window (frames from the start of the step)
+    unsigned long	stepFrames;	// frames per tone
+    unsigned int	numHarmonics;	// highest harmonic analysed
+    double		tolerance;	// settling tolerance
+    double		*cosTable;	// cos(2*pi*k/blockSize), k = 0...blockSize-1
+    double		*sinTable;
+    float		*buffer[2];	// recorded frames of the current and the previous tone (lastStart+numBlocks*blockSize each)
+
+    // capture state (ttSineSweepAddFrames):
+    unsigned int	captureStep;	// tone currently being recorded (numSteps when done)
+    unsigned long	capturePos;	// frames of the current tone recorded
+    unsigned int	captureBuffer;	// buffer used for the current tone
+    unsigned long	checkStart;	// start of the next block checked for settling
+    double		lastRe, lastIm;	// fundamental of the last block checked
+    int			havePhasor;
+    long		windowStart;	// start of the analysis window (-1: not settled yet)
+    int			windowSettled;
+    int			windowDone;
+
+    // tone ready for the analysis (set by ttSineSweepAddFrames, cleared by the caller):
+    volatile int	ready;
+    unsigned int	readyStep;
+    unsigned int	readyBuffer;
+    unsigned long	readyStart;
+    int			readySettled;
+
+    // analysis (ttSineSweepAnalyse):
+    ttFFTPlan		plan;
+    double		*x;
+    double		*power;
+    double		*avgPower;
+}
+ttSineSweep;
+
+/* Set up a sweep of numSteps tones from f1 to f2 (Hz, logarithmic spacing, adjusted to the FFT bins; tones adjusted to the same bin are merged). blockSize must be a power of two (at least 16). settleTime is the maximum settling time per tone (s), marginFrames is the number of extra frames at the end of each tone that are not analysed (allows for an error in the round-trip delay). Returns 0 on success, -1 on failure. */
+int ttSineSweepInit( ttSineSweep *sw, double samplingRate, double f1, double f2, unsigned int numSteps, double amplitude, unsigned long blockSize, unsigned long numBlocks, double settleTime, unsigned long marginFrames, unsigned int numHarmonics );
+
+/* Release the memory of the sweep. */
+void ttSineSweepFree( ttSineSweep *sw );
+
+/* Total number of frames of the sweep. */
+unsigned long ttSineSweepFrames( const ttSineSweep *sw );
+
+/* Frequency of tone 'step' (Hz). */
+double ttSineSweepFrequency( const ttSineSweep *sw, unsigned int step );
+
+/* Generate the frames startFrame...startFrame+n-1 of the sweep (one channel). */
+void ttSineSweepGenerate( const ttSineSweep *sw, float *buf, unsigned long startFrame, unsigned long n );
+
+/* Take n recorded frames (stride samples per frame, the first sample of each frame is analysed), aligned with the sweep. Returns the number of frames used, which is less than n if a tone is ready for the analysis (sw->ready) or all tones were recorded. */
+unsigned long ttSineSweepAddFrames( ttSineSweep *sw, const float *frames, unsigned long n, unsigned int stride );
+
+/* Analyse the tone that is ready (call before clearing sw->ready, or with a copy of the ready* fields). */
+void ttSineSweepAnalyse( ttSineSweep *sw, unsigned int step, unsigned int buffer, unsigned long start, int settled, ttSineSweepResult *r );
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ * Real-time FFT spectrum analysis for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ttSpectrum.h"
+
+#define PI		(3.141592653589793)
+
+int ttFFTPlanInit( ttFFTPlan *plan, unsigned long n )
+{
+    unsigned long m = n/2, k, j, bits = 0;
+
+    memset( plan, 0, sizeof(ttFFTPlan) );
+    if ( n < 4 || ( n & (n-1) ) != 0 ) return -1;
+    while ( (1UL << bits) < m ) bits++;
+
+    plan->bitReverse = (unsigned long *) malloc( m*sizeof(unsigned long) );
+    plan->cosTable = (double *) malloc( m*sizeof(double) );
+    plan->sinTable = (double *) malloc( m*sizeof(double) );
+    plan->re = (double *) malloc( m*sizeof(double) );
+    plan->im = (double *) malloc( m*sizeof(double) );
+    if ( !plan->bitReverse || !plan->cosTable || !plan->sinTable || !plan->re || !plan->im ) {
+		ttFFTPlanFree( plan );
+		return -1;
+	}
+
+    for ( k = 0; k < m; k++ ) {
+		plan->cosTable[k] = cos( 2.0*PI*k/n );
+		plan->sinTable[k] = sin( 2.0*PI*k/n );
+		plan->bitReverse[k] = 0;
+		for ( j = 0; j < bits; j++ ) {
+			if ( k & (1UL << j) ) plan->bitReverse[k] |= 1UL << (bits-1-j);
+		}
+	}
+    plan->size = n;
+    return 0;
+}
+
+void ttFFTPlanFree( ttFFTPlan *plan )
+{
+    free( plan->bitReverse );
+    free( plan->cosTable );
+    free( plan->sinTable );
+    free( plan->re );
+    free( plan->im );
+    memset( plan, 0, sizeof(ttFFTPlan) );
+}
+
+/* Complex FFT of length size/2 of the even (real part) and odd (imaginary part) samples of x, in plan->re and plan->im. */
+static void HalfFFT( ttFFTPlan *plan, const double *x )
+{
+    unsigned long	n = plan->size, m = n/2;
+    unsigned long	len, half, step, i, j, a, b, k;
+    double		*re = plan->re, *im = plan->im;
+    double		wr, wi, tr, ti;
+
+    // pack the even and odd samples into the real and imaginary parts of a complex sequence of length m (in bit-reversed order):
+    for ( k = 0; k < m; k++ ) {
+		re[plan->bitReverse[k]] = x[2*k];
+		im[plan->bitReverse[k]] = x[2*k+1];
+	}
+
+    // complex radix-2 FFT of length m (decimation in time), twiddle factors exp(-2*pi*i*j/len) = W_n^(j*n/len):
+    for ( len = 2; len <= m; len <<= 1 ) {
+		half = len/2;
+		step = n/len;
+		for ( i = 0; i < m; i += len ) {
+			for ( j = 0; j < half; j++ ) {
+				wr = plan->cosTable[j*step];
+				wi = -plan->sinTable[j*step];
+				a = i+j;
+				b = a+half;
+				tr = re[b]*wr - im[b]*wi;
+				ti = re[b]*wi + im[b]*wr;
+				re[b] = re[a]-tr;
+				im[b] = im[a]-ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+/* Bin k (0 < k < size/2) of the spectrum of x from the result of HalfFFT (separate the spectra of the even and odd samples, and combine them). */
+static void SpectrumBin( const ttFFTPlan *plan, unsigned long k, double *xr, double *xi )
+{
+    unsigned long	m = plan->size/2;
+    const double	*re = plan->re, *im = plan->im;
+    double		er, ei, odr, odi, wr, wi;
+
+    er = ( re[k] + re[m-k] ) / 2;
+    ei = ( im[k] - im[m-k] ) / 2;
+    odr = ( im[k] + im[m-k] ) / 2;
+    odi = ( re[m-k] - re[k] ) / 2;
+    wr = plan->cosTable[k];
+    wi = -plan->sinTable[k];
+    *xr = er + wr*odr - wi*odi;
+    *xi = ei + wr*odi + wi*odr;
+}
+
+void ttFFTPower( ttFFTPlan *plan, const double *x, double *power )
+{
+    unsigned long	m = plan->size/2, k;
+    double		*re = plan->re, *im = plan->im;
+    double		xr, xi;
+
+    HalfFFT( plan, x );
+    power[0] = (re[0]+im[0]) * (re[0]+im[0]);
+    power[m] = (re[0]-im[0]) * (re[0]-im[0]);
+    for ( k = 1; k < m; k++ ) {
+		SpectrumBin( plan, k, &xr, &xi );
+		power[k] = xr*xr + xi*xi;
+	}
+}
+
+void ttFFT( ttFFTPlan *plan, const double *x, double *xRe, double *xIm )
+{
+    unsigned long	m = plan->size/2, k;
+    double		*re = plan->re, *im = plan->im;
+
+    HalfFFT( plan, x );
+    xRe[0] = re[0]+im[0];
+    xIm[0] = 0;
+    xRe[m] = re[0]-im[0];
+    xIm[m] = 0;
+    for ( k = 1; k < m; k++ ) SpectrumBin( plan, k, xRe+k, xIm+k );
+}
+
+int ttSpectrumInit( ttSpectrum *sa, unsigned long fftSize, unsigned long hop, unsigned int numChannels, unsigned long numAverages, int exponential )
+{
+    unsigned long	k;
+    double		sum = 0;
+
+    memset( sa, 0, sizeof(ttSpectrum) );
+    if ( fftSize < 16 || hop < 1 || hop > fftSize || numChannels < 1 ) return -1;
+    if ( ttFFTPlanInit( &sa->plan, fftSize ) != 0 ) return -1;
+
+    sa->fftSize = fftSize;
+    sa->numBins = fftSize/2+1;
+    sa->hop = hop;
+    sa->numChannels = numChannels;
+    sa->numAverages = ( numAverages < 1 ) ? 1 : numAverages;
+    sa->exponential = exponential;
+
+    sa->history = (float *) calloc( fftSize*numChannels, sizeof(float) );
+    sa->window = (double *) malloc( fftSize*sizeof(double) );
+    sa->x = (double *) malloc( fftSize*sizeof(double) );
+    sa->power = (double *) malloc( sa->numBins*sizeof(double) );
+    sa->avgPower = (double *) calloc( sa->numBins*numChannels, sizeof(double) );
+    sa->amplitude = (float *) calloc( sa->numBins*numChannels, sizeof(float) );
+    sa->peak = (float *) calloc( sa->numBins*numChannels, sizeof(float) );
+    if ( !sa->history || !sa->window || !sa->x || !sa->power || !sa->avgPower || !sa->amplitude || !sa->peak ) {
+		ttSpectrumFree( sa );
+		return -1;
+	}
+
+    // periodic Hann window:
+    for ( k = 0; k < fftSize; k++ ) {
+		sa->window[k] = 0.5 - 0.5*cos( 2.0*PI*k/fftSize );
+		sum += sa->window[k];
+	}
+    sa->ampScale = 2.0 / sum;
+    return 0;
+}
+
+void ttSpectrumFree( ttSpectrum *sa )
+{
+    ttFFTPlanFree( &sa->plan );
+    free( sa->history );
+    free( sa->window );
+    free( sa->x );
+    free( sa->power );
+    free( sa->avgPower );
+    free( sa->amplitude );
+    free( sa->peak );
+    memset( sa, 0, sizeof(ttSpectrum) );
+}
+
+/* Amplitude of a sine at bin k corresponding to the power p (DC and Nyquist bins are not split between positive and negative frequencies). */
+static double BinAmplitude( const ttSpectrum *sa, unsigned long k, double p )
+{
+    double a = sqrt(p) * sa->ampScale;
+    return ( k == 0 || k == sa->numBins-1 ) ? a/2 : a;
+}
+
+/* Compute the spectra of the fftSize frames in the history buffer, and update the averages and the peak hold. */
+static void ComputeSpectra( ttSpectrum *sa )
+{
+    unsigned long	k, i;
+    unsigned int	c;
+    unsigned int	nc = sa->numChannels;
+    double		a;
+    const float		*h;
+
+    if ( sa->exponential && sa->count < sa->numAverages ) sa->count++; // running mean until numAverages spectra are available, then exponential
+
+    for ( c = 0; c < nc; c++ ) {
+		h = sa->history + c*sa->fftSize;
+		for ( k = 0; k < sa->fftSize; k++ ) sa->x[k] = h[k] * sa->window[k];
+		ttFFTPower( &sa->plan, sa->x, sa->power );
+
+		for ( k = 0; k < sa->numBins; k++ ) {
+			i = k*nc + c;
+			a = BinAmplitude( sa, k, sa->power[k] );
+			if ( a > sa->peak[i] ) sa->peak[i] = a;
+			if ( sa->exponential ) {
+				sa->avgPower[i] += ( sa->power[k] - sa->avgPower[i] ) / sa->count;
+			}
+			else {
+				sa->avgPower[i] += sa->power[k];
+			}
+		}
+	}
+    sa->numSpectra++;
+
+    if ( !sa->exponential ) {
+		sa->count++;
+		if ( sa->count < sa->numAverages ) return; // average not complete yet
+	}
+
+    for ( k = 0; k < sa->numBins; k++ ) {
+		for ( c = 0; c < nc; c++ ) {
+			i = k*nc + c;
+			sa->amplitude[i] = BinAmplitude( sa, k, sa->exponential ? sa->avgPower[i] : sa->avgPower[i]/sa->count );
+		}
+	}
+    sa->amplitudeCount = sa->count;
+    sa->ready = 1;
+
+    if ( !sa->exponential ) { // start the next block
+		memset( sa->avgPower, 0, sa->numBins*nc*sizeof(double) );
+		sa->count = 0;
+	}
+}
+
+unsigned long ttSpectrumAddFrames( ttSpectrum *sa, const float *frames, unsigned long n )
+{
+    unsigned long	done = 0, m, k, numSpectra = 0;
+    unsigned int	c;
+    unsigned int	nc = sa->numChannels;
+
+    while ( done < n ) {
+		// copy as many frames as needed to fill the history buffer:
+		m = sa->fftSize - sa->fill;
+		if ( m > n-done ) m = n-done;
+		for ( c = 0; c < nc; c++ ) {
+			for ( k = 0; k < m; k++ ) sa->history[c*sa->fftSize+sa->fill+k] = frames[(done+k)*nc+c];
+		}
+		sa->fill += m;
+		done += m;
+
+		if ( sa->fill == sa->fftSize ) {
+			ComputeSpectra( sa );
+			numSpectra++;
+			// keep the last fftSize-hop frames for the next (overlapping) FFT:
+			for ( c = 0; c < nc; c++ ) {
+				memmove( sa->history+c*sa->fftSize, sa->history+c*sa->fftSize+sa->hop, (sa->fftSize-sa->hop)*sizeof(float) );
+			}
+			sa->fill = sa->fftSize - sa->hop;
+		}
+	}
+    sa->numFrames += n;
+    return numSpectra;
+}
+
+int ttSpectrumWrite( ttSpectrum *sa, const char *path, const char *tmpPath, double samplingRate, int dropped )
+{
+    FILE		*f;
+    unsigned int	u32;
+    unsigned long long	u64;
+    double		f64;
+    unsigned long	n = sa->numBins*sa->numChannels;
+    int			err = 0;
+
+    f = fopen( tmpPath, "wb" );
+    if ( f == NULL ) return -1;
+
+    if ( fwrite(TT_SPECTRUM_MAGIC,1,8,f) != 8 ) err = 1;
+    u32 = TT_SPECTRUM_HEADERSIZE;	if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u32 = sa->numChannels;		if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u64 = sa->numBins;			if ( fwrite(&u64,8,1,f) != 1 ) err = 1;
+    f64 = samplingRate;			if ( fwrite(&f64,8,1,f) != 1 ) err = 1;
+    u32 = sa->fftSize;			if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u32 = sa->hop;			if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u64 = sa->numSpectra;		if ( fwrite(&u64,8,1,f) != 1 ) err = 1;
+    u32 = sa->amplitudeCount;		if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u32 = dropped ? 1 : 0;		if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    f64 = sa->numFrames/samplingRate;	if ( fwrite(&f64,8,1,f) != 1 ) err = 1;
+    if ( fwrite(sa->amplitude,sizeof(float),n,f) != n ) err = 1;
+    if ( fwrite(sa->peak,sizeof(float),n,f) != n ) err = 1;
+    if ( fclose(f) != 0 ) err = 1;
+
+    if ( err || rename( tmpPath, path ) != 0 ) {
+		remove( tmpPath );
+		return -1;
+	}
+    sa->ready = 0;
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Real-time FFT spectrum analysis for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+The spectrum analyser takes the recorded frames as they arrive, and computes a Hann-windowed FFT of the last fftSize frames of each channel every 'hop' frames (overlapped FFTs). The power spectra are averaged (linear averaging of blocks of numAverages spectra, or exponential averaging with a time constant of numAverages spectra), and the maximum of the individual spectra is kept (peak hold). The FFT is a radix-2 FFT of the real-valued data (computed as a complex FFT of half the length). The twiddle factors, the bit-reversal table, the window and all work buffers are set up by ttSpectrumInit, so that no memory is allocated while the data are analysed.
+
+The spectra are published to a file in the format described below. The file is written to a temporary file first and then renamed, so that a reader never sees a partially written file.
+
+Spectrum file format (native byte order):
+   offset  0: 8 bytes   magic string "MATAASPC"
+   offset  8: uint32    size of the header in bytes (data start at this offset)
+   offset 12: uint32    number of channels
+   offset 16: uint64    number of frequency bins (fftSize/2+1, bin k is at frequency k*samplingRate/fftSize)
+   offset 24: float64   sampling rate (Hz)
+   offset 32: uint32    FFT size
+   offset 36: uint32    hop size (frames between the starts of consecutive FFTs)
+   offset 40: uint64    number of spectra computed since the start of the analyser
+   offset 48: uint32    number of spectra in the average
+   offset 52: uint32    flag indicating that recorded samples were lost (1) or not (0)
+   offset 56: float64   time of the last analysed frame (s, since the start of the analyser)
+   offset 64: float32   averaged amplitude spectrum (zero-to-peak amplitude of a sine at the bin frequency), interleaved (bin by bin, one value per channel)
+   then:      float32   peak-hold amplitude spectrum (same layout)
+*/
+
+#ifndef TT_SPECTRUM_H
+#define TT_SPECTRUM_H
+
+#define TT_SPECTRUM_MAGIC	"MATAASPC"
+#define TT_SPECTRUM_HEADERSIZE	64
+
+typedef struct
+{
+    unsigned long	size;		// FFT size (power of two, real-valued data)
+    unsigned long	*bitReverse;	// bit-reversal permutation of the complex FFT of size/2
+    double		*cosTable;	// cos(2*pi*k/size), k = 0...size/2-1
+    double		*sinTable;	// sin(2*pi*k/size)
+    double		*re, *im;	// work buffers (size/2)
+}
+ttFFTPlan;
+
+typedef struct
+{
+    ttFFTPlan		plan;
+    unsigned long	fftSize;
+    unsigned long	numBins;	// fftSize/2+1
+    unsigned long	hop;		// frames between the starts of consecutive FFTs
+    unsigned int	numChannels;
+    unsigned long	numAverages;	// number of spectra in a linear average, or time constant of the exponential average (in spectra)
+    int			exponential;	// exponential instead of linear averaging
+    unsigned long	fill;		// number of frames in the history buffer
+    float		*history;	// last fftSize frames of each channel (channel by channel)
+    double		*window;	// Hann window
+    double		ampScale;	// converts the FFT magnitude to the amplitude of a sine (2 / sum of the window)
+    double		*x;		// windowed data (fftSize)
+    double		*power;		// power spectrum of one channel (numBins)
+    double		*avgPower;	// averaged power spectra (numBins*numChannels, interleaved)
+    unsigned long	count;		// number of spectra in the current average
+    float		*amplitude;	// last complete averaged amplitude spectra (numBins*numChannels, interleaved)
+    float		*peak;		// peak-hold amplitude spectra (numBins*numChannels, interleaved)
+    unsigned long	amplitudeCount;	// number of spectra averaged in amplitude
+    unsigned long long	numSpectra;	// number of spectra computed
+    unsigned long long	numFrames;	// number of frames analysed
+    int			ready;		// set when amplitude was updated, cleared by ttSpectrumWrite
+}
+ttSpectrum;
+
+/* Set up an FFT of size n (power of two, at least 4). Returns 0 on success, -1 on failure. */
+int ttFFTPlanInit( ttFFTPlan *plan, unsigned long n );
+
+/* Release the memory of the FFT plan. */
+void ttFFTPlanFree( ttFFTPlan *plan );
+
+/* Power spectrum |X(k)|^2 of the real-valued data x (plan->size values) for k = 0...size/2. */
+void ttFFTPower( ttFFTPlan *plan, const double *x, double *power );
+
+/* Complex spectrum X(k) = xRe[k] + i*xIm[k] of the real-valued data x (plan->size values) for k = 0...size/2 (same sign convention as the FFT in Octave). */
+void ttFFT( ttFFTPlan *plan, const double *x, double *xRe, double *xIm );
+
+/* Set up the spectrum analyser. fftSize must be a power of two (at least 16), 1 <= hop <= fftSize. Returns 0 on success, -1 on failure. */
+int ttSpectrumInit( ttSpectrum *sa, unsigned long fftSize, unsigned long hop, unsigned int numChannels, unsigned long numAverages, int exponential );
+
+/* Release the memory of the spectrum analyser. */
+void ttSpectrumFree( ttSpectrum *sa );
+
+/* Analyse n frames of data (numChannels samples per frame, interleaved). Returns the number of spectra computed. */
+unsigned long ttSpectrumAddFrames( ttSpectrum *sa, const float *frames, unsigned long n );
+
+/* Publish the spectra to path (through the temporary file tmpPath, which is renamed to path). Returns 0 on success, -1 on failure. */
+int ttSpectrumWrite( ttSpectrum *sa, const char *path, const char *tmpPath, double samplingRate, int dropped );
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * Real-time dual-channel transfer-function analysis for TestTone (see ttTransfer.h).
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ttTransfer.h"
+
+#define PI		(3.141592653589793)
+
+int ttTransferInit( ttTransfer *tf, unsigned long fftSize, unsigned long hop )
+{
+    unsigned long	k, nb;
+
+    memset( tf, 0, sizeof(ttTransfer) );
+    if ( fftSize < 16 || hop < 1 || hop > fftSize ) return -1;
+    if ( ttFFTPlanInit( &tf->plan, fftSize ) != 0 ) return -1;
+
+    nb = fftSize/2+1;
+    tf->fftSize = fftSize;
+    tf->numBins = nb;
+    tf->hop = hop;
+
+    tf->history = (float *) calloc( 2*fftSize, sizeof(float) );
+    tf->window = (double *) malloc( fftSize*sizeof(double) );
+    tf->x = (double *) malloc( fftSize*sizeof(double) );
+    tf->xRe = (double *) malloc( nb*sizeof(double) );
+    tf->xIm = (double *) malloc( nb*sizeof(double) );
+    tf->yRe = (double *) malloc( nb*sizeof(double) );
+    tf->yIm = (double *) malloc( nb*sizeof(double) );
+    tf->Gxx = (double *) calloc( nb, sizeof(double) );
+    tf->Gyy = (double *) calloc( nb, sizeof(double) );
+    tf->GxyRe = (double *) calloc( nb, sizeof(double) );
+    tf->GxyIm = (double *) calloc( nb, sizeof(double) );
+    tf->out = (float *) calloc( TT_TRANSFER_VALUES*nb, sizeof(float) );
+    if ( !tf->history || !tf->window || !tf->x || !tf->xRe || !tf->xIm || !tf->yRe || !tf->yIm || !tf->Gxx || !tf->Gyy || !tf->GxyRe || !tf->GxyIm || !tf->out ) {
+		ttTransferFree( tf );
+		return -1;
+	}
+
+    // periodic Hann window (the scaling cancels in H1, H2 and the coherence):
+    for ( k = 0; k < fftSize; k++ ) tf->window[k] = 0.5 - 0.5*cos( 2.0*PI*k/fftSize );
+    return 0;
+}
+
+void ttTransferFree( ttTransfer *tf )
+{
+    ttFFTPlanFree( &tf->plan );
+    free( tf->history );
+    free( tf->window );
+    free( tf->x );
+    free( tf->xRe );
+    free( tf->xIm );
+    free( tf->yRe );
+    free( tf->yIm );
+    free( tf->Gxx );
+    free( tf->Gyy );
+    free( tf->GxyRe );
+    free( tf->GxyIm );
+    free( tf->out );
+    memset( tf, 0, sizeof(ttTransfer) );
+}
+
+/* Compute the spectra of the fftSize frames in the history buffers, and add the auto and cross spectra to the sums. */
+static void ComputeSpectra( ttTransfer *tf )
+{
+    unsigned long	k;
+    const float		*h;
+
+    h = tf->history;
+    for ( k = 0; k < tf->fftSize; k++ ) tf->x[k] = h[k] * tf->window[k];
+    ttFFT( &tf->plan, tf->x, tf->xRe, tf->xIm );
+    h = tf->history + tf->fftSize;
+    for ( k = 0; k < tf->fftSize; k++ ) tf->x[k] = h[k] * tf->window[k];
+    ttFFT( &tf->plan, tf->x, tf->yRe, tf->yIm );
+
+    for ( k = 0; k < tf->numBins; k++ ) {
+		tf->Gxx[k] += tf->xRe[k]*tf->xRe[k] + tf->xIm[k]*tf->xIm[k];
+		tf->Gyy[k] += tf->yRe[k]*tf->yRe[k] + tf->yIm[k]*tf->yIm[k];
+		tf->GxyRe[k] += tf->xRe[k]*tf->yRe[k] + tf->xIm[k]*tf->yIm[k]; // conj(X)*Y
+		tf->GxyIm[k] += tf->xRe[k]*tf->yIm[k] - tf->xIm[k]*tf->yRe[k];
+	}
+    tf->numSpectra++;
+}
+
+unsigned long ttTransferAddFrames( ttTransfer *tf, const float *frames, unsigned long n, unsigned int stride )
+{
+    unsigned long	done = 0, m, k, numSpectra = 0;
+    float		*hx = tf->history, *hy = tf->history + tf->fftSize;
+
+    while ( done < n ) {
+		// copy as many frames as needed to fill the history buffers:
+		m = tf->fftSize - tf->fill;
+		if ( m > n-done ) m = n-done;
+		for ( k = 0; k < m; k++ ) {
+			hx[tf->fill+k] = frames[(done+k)*stride];
+			hy[tf->fill+k] = frames[(done+k)*stride+1];
+		}
+		tf->fill += m;
+		done += m;
+
+		if ( tf->fill == tf->fftSize ) {
+			ComputeSpectra( tf );
+			numSpectra++;
+			// keep the last fftSize-hop frames for the next (overlapping) FFT:
+			memmove( hx, hx+tf->hop, (tf->fftSize-tf->hop)*sizeof(float) );
+			memmove( hy, hy+tf->hop, (tf->fftSize-tf->hop)*sizeof(float) );
+			tf->fill = tf->fftSize - tf->hop;
+		}
+	}
+    tf->numFrames += n;
+    return numSpectra;
+}
+
+void ttTransferRestart( ttTransfer *tf )
+{
+    tf->fill = 0;
+}
+
+void ttTransferEstimate( const ttTransfer *tf, unsigned long k, double *h1Re, double *h1Im, double *h2Re, double *h2Im, double *coherence )
+{
+    double	gxx = tf->Gxx[k], gyy = tf->Gyy[k], re = tf->GxyRe[k], im = tf->GxyIm[k];
+    double	c = re*re + im*im; // |Gxy|^2
+
+    *h1Re = *h1Im = *h2Re = *h2Im = *coherence = 0;
+    if ( gxx > 0 ) {
+		*h1Re = re / gxx;
+		*h1Im = im / gxx;
+	}
+    if ( c > 0 ) { // Gyy / conj(Gxy) = Gyy * Gxy / |Gxy|^2
+		*h2Re = gyy * re / c;
+		*h2Im = gyy * im / c;
+	}
+    if ( gxx > 0 && gyy > 0 ) *coherence = c / ( gxx*gyy );
+}
+
+int ttTransferWrite( ttTransfer *tf, const char *path, const char *tmpPath, double samplingRate, int dropped )
+{
+    FILE		*f;
+    unsigned int	u32;
+    unsigned long long	u64;
+    double		f64, h1Re, h1Im, h2Re, h2Im, coherence;
+    unsigned long	k, n = TT_TRANSFER_VALUES*tf->numBins;
+    float		*o;
+    int			err = 0;
+
+    for ( k = 0; k < tf->numBins; k++ ) {
+		ttTransferEstimate( tf, k, &h1Re, &h1Im, &h2Re, &h2Im, &coherence );
+		o = tf->out + TT_TRANSFER_VALUES*k;
+		o[0] = h1Re;
+		o[1] = h1Im;
+		o[2] = h2Re;
+		o[3] = h2Im;
+		o[4] = coherence;
+	}
+
+    f = fopen( tmpPath, "wb" );
+    if ( f == NULL ) return -1;
+
+    if ( fwrite(TT_TRANSFER_MAGIC,1,8,f) != 8 ) err = 1;
+    u32 = TT_TRANSFER_HEADERSIZE;	if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u32 = TT_TRANSFER_VALUES;		if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u64 = tf->numBins;			if ( fwrite(&u64,8,1,f) != 1 ) err = 1;
+    f64 = samplingRate;			if ( fwrite(&f64,8,1,f) != 1 ) err = 1;
+    u32 = tf->fftSize;			if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u32 = tf->hop;			if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u64 = tf->numSpectra;		if ( fwrite(&u64,8,1,f) != 1 ) err = 1;
+    u32 = dropped ? 1 : 0;		if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    u32 = 0;				if ( fwrite(&u32,4,1,f) != 1 ) err = 1;
+    f64 = tf->numFrames/samplingRate;	if ( fwrite(&f64,8,1,f) != 1 ) err = 1;
+    if ( fwrite(tf->out,sizeof(float),n,f) != n ) err = 1;
+    if ( fclose(f) != 0 ) err = 1;
+
+    if ( err || rename( tmpPath, path ) != 0 ) {
+		remove( tmpPath );
+		return -1;
+	}
+    return 0;
+}
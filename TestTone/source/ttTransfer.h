@@ -0,0 +1,96 @@
+/*
+ * Real-time dual-channel transfer-function analysis for TestTone.
+ *
+ * TestTone is part of MATAA. MATAA is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MATAA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MATAA; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+ * Contact: info@audioroot.net
+ * Further information: http://www.audioroot.net/MATAA.html
+ */
+
+/*
+The transfer-function analyser estimates the transfer function H(f) = Y(f)/X(f) from a reference channel x to a response channel y with broadband excitation (noise or a chirp played in a loop). Like the spectrum analyser (ttSpectrum.h), it takes the recorded frames as they arrive and computes Hann-windowed FFTs of the last fftSize frames of both channels every 'hop' frames. The auto spectra Gxx = |X|^2 and Gyy = |Y|^2 and the cross spectrum Gxy = conj(X)*Y are summed over all FFTs since the start (Welch averaging), so each new block only adds fftSize/2+1 products to the sums, and the estimates improve continuously while the excitation is running.
+
+From the averaged spectra, the H1 and H2 estimates of the transfer function and the (magnitude-squared) coherence are computed:
+   H1 = Gxy / Gxx         (unbiased by noise in y)
+   H2 = Gyy / conj(Gxy)   (unbiased by noise in x)
+   coherence = |Gxy|^2 / (Gxx * Gyy) = H1 / H2   (0...1)
+A coherence close to 1 indicates that y is linearly related to x at that frequency, i.e. that the estimate is not disturbed by noise, distortion or time variance. Note that the coherence of a single FFT is always 1, so a few averages are needed before it becomes meaningful.
+
+The estimates are published to a file in the format described below (written to a temporary file first and then renamed, see ttSpectrum.h).
+
+Transfer-function file format (native byte order):
+   offset  0: 8 bytes   magic string "MATAATFE"
+   offset  8: uint32    size of the header in bytes (data start at this offset)
+   offset 12: uint32    number of values per bin (5)
+   offset 16: uint64    number of frequency bins (fftSize/2+1, bin k is at frequency k*samplingRate/fftSize)
+   offset 24: float64   sampling rate (Hz)
+   offset 32: uint32    FFT size
+   offset 36: uint32    hop size (frames between the starts of consecutive FFTs)
+   offset 40: uint64    number of FFTs averaged
+   offset 48: uint32    flag indicating that recorded samples were lost (1) or not (0)
+   offset 52: uint32    reserved (0)
+   offset 56: float64   time of the last analysed frame (s, since the start of the analyser)
+   offset 64: float32   real part of H1, imaginary part of H1, real part of H2, imaginary part of H2, coherence (interleaved, bin by bin)
+*/
+
+#ifndef TT_TRANSFER_H
+#define TT_TRANSFER_H
+
+#include "ttSpectrum.h"
+
+#define TT_TRANSFER_MAGIC	"MATAATFE"
+#define TT_TRANSFER_HEADERSIZE	64
+#define TT_TRANSFER_VALUES	5	// values per bin in the transfer-function file
+
+typedef struct
+{
+    ttFFTPlan		plan;
+    unsigned long	fftSize;
+    unsigned long	numBins;	// fftSize/2+1
+    unsigned long	hop;		// frames between the starts of consecutive FFTs
+    unsigned long	fill;		// number of frames in the history buffers
+    float		*history;	// last fftSize frames of x and y (x first)
+    double		*window;	// Hann window
+    double		*x;		// windowed data (fftSize)
+    double		*xRe, *xIm;	// spectrum of x (numBins)
+    double		*yRe, *yIm;	// spectrum of y (numBins)
+    double		*Gxx, *Gyy;	// sums of the auto spectra (numBins)
+    double		*GxyRe, *GxyIm;	// sum of the cross spectrum (numBins)
+    float		*out;		// estimates written to the file (TT_TRANSFER_VALUES*numBins)
+    unsigned long long	numSpectra;	// number of FFTs averaged
+    unsigned long long	numFrames;	// number of frames analysed
+}
+ttTransfer;
+
+/* Set up the transfer-function analyser. fftSize must be a power of two (at least 16), 1 <= hop <= fftSize. Returns 0 on success, -1 on failure. */
+int ttTransferInit( ttTransfer *tf, unsigned long fftSize, unsigned long hop );
+
+/* Release the memory of the transfer-function analyser. */
+void ttTransferFree( ttTransfer *tf );
+
+/* Analyse n frames of data (stride samples per frame, interleaved; the first sample of each frame is x, the second is y). Returns the number of FFTs computed. */
+unsigned long ttTransferAddFrames( ttTransfer *tf, const float *frames, unsigned long n, unsigned int stride );
+
+/* Discard the frames in the history buffers (e.g. after recorded samples were lost), so that the next FFT does not span the gap in the data. The averaged spectra are kept. */
+void ttTransferRestart( ttTransfer *tf );
+
+/* H1, H2 and coherence of bin k from the spectra averaged so far. */
+void ttTransferEstimate( const ttTransfer *tf, unsigned long k, double *h1Re, double *h1Im, double *h2Re, double *h2Im, double *coherence );
+
+/* Publish the estimates to path (through the temporary file tmpPath, which is renamed to path). Returns 0 on success, -1 on failure. */
+int ttTransferWrite( ttTransfer *tf, const char *path, const char *tmpPath, double samplingRate, int dropped );
+
+#endif
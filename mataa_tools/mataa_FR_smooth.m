@@ -1,19 +1,24 @@
-function [mag,phase,f] = mataa_FR_smooth (mag,phase,f,smooth_interval, Ndownsample);
+function [mag,phase,f] = mataa_FR_smooth (mag,phase,f,smooth_interval,Ndownsample,method);
 
-% function [mag,phase,f] = mataa_FR_smooth (mag,phase,f,smooth_interval, downsample);
+% function [mag,phase,f] = mataa_FR_smooth (mag,phase,f,smooth_interval,Ndownsample,method);
 %
 % DESCRIPTION:
-% Smooth frequency response in octave bands.
+% Smooth frequency response in octave bands. Many frequency responses with the same frequency values (e.g. the slices of a cumulative spectral decay or the lines of a spectrogram) can be smoothed in one pass by passing them as the columns of a matrix.
+%
+% Two smoothing methods are available:
+% 'log' (default): the data are interpolated to logarithmically spaced frequency values, and then smoothed with a sliding window (trapezoid) of constant width (smooth_interval) on the log-frequency axis. The interpolation weights (a sparse matrix) and the spectrum of the sliding window depend only on f and smooth_interval. They are kept in memory, so that repeated smoothing of data with the same frequency values only requires the matrix product and the convolution.
+% 'octave': variable-width smoothing at the original frequency values. Each value is replaced by the mean of the data in the band of width smooth_interval (octaves) centred on its frequency (the data are weighted by the frequency spacing, so that non-uniformly spaced data are averaged correctly). The band means are computed from prefix sums (cumulative sums), so the computational effort does not depend on the band width.
 %
 % INPUT:
-% mag: magnitude data
-% phase: phase data
+% mag: magnitude data (vector, or matrix with one column per frequency response)
+% phase: phase data (same size as mag)
 % f: frequency
 % smooth_interval: width of octave band used for smoothing
 % Ndownsample (optional): sample interval to use (default: downsample = 1 --> use every sample)
+% method (optional): smoothing method, 'log' (default) or 'octave' (see DESCRIPTION)
 %
 % OUTPUT:
-% mag: smoothed frequency response (magnitude)
+% mag: smoothed frequency response (magnitude), one column per frequency response (vectors smoothed with the 'log' method are returned as row vectors)
 % phase: smoothed frequency response (phase)
 % f: frequency values of smoothed frequency response data
 %
@@ -21,7 +26,8 @@ function [mag,phase,f] = mataa_FR_smooth (mag,phase,f,smooth_interval, Ndownsamp
 % > [h,t] = mataa_IR_demo; 
 % > [mag,phase,f] = mataa_IR_to_FR(h,t); % calculates magnitude(f) and phase(f)
 % > [magS,phaseS,fS] = mataa_FR_smooth(mag,phase,f,1/4); % smooth to 1/4 octave resolution
-% > semilogx ( f,mag , fS,magS ); % plot raw and smoothed data
+% > [magV,phaseV,fV] = mataa_FR_smooth(mag,phase,f,1/4,1,'octave'); % variable-width 1/4 octave smoothing
+% > semilogx ( f,mag , fS,magS , fV,magV ); % plot raw and smoothed data
 %
 % DISCLAIMER:
 % This file is part of MATAA.
@@ -44,47 +50,121 @@ function [mag,phase,f] = mataa_FR_smooth (mag,phase,f,smooth_interval, Ndownsamp
 % Contact: info@audioroot.net
 % Further information: http://www.audioroot.net/MATAA
 
-% fractional octave between last and second-last data point:
-Nf  = log2 (f(end)/f(end-1));
-
-% number of points corresponding to smooth_interval:
-Ns = round (smooth_interval / Nf);
-
-% smooth the log-f data:
-if Ns > 1 % otherwise no smoothing is required
-	
-	No = log2 (f(end)/f(1)); % number of octaves covered by full data set
-	NL = round (No/Nf); % number of data points required for log-interpolation to capture the original data at full resolution
-	
-	% interpolate to log-distributed frequency values:
-	f0    = f;
-	f     = logspace(log10(f0(1)),log10(f0(end)),NL);
-	mag   = interp1 (f0,mag,f,'extrap');
-	phase = interp1 (f0,phase,f,'extrap');
-        
-    % construct sliding window W with effective width Ns:
-    W  = linspace (1/Ns,1,round(0.2*Ns));
-    W  = [ W repmat(1,1,round(0.8*Ns)) fliplr(W) ];
-    W = W / sum(W); % normalize
-    NW = length(W);
-    % convolve mag and phase with W:
-    % mag   = conv ([ repmat(mag(1),1,NW) mag repmat(mag(end),1,NW) ],W,'same')(NW+1:end-NW);
-    % phase = conv ([ repmat(phase(1),1,NW) phase repmat(phase(end),1,NW) ],W,'same')(NW+1:end-NW);
-    M0 = mag;
-    P0 = phase;
-    mag   = fftconv ([ repmat(mag(1),1,NW) mag repmat(mag(end),1,NW) ],W);
-    phase = fftconv ([ repmat(phase(1),1,NW) phase repmat(phase(end),1,NW) ],W);
-    a = round(1.5*NW);
-    b = 3*NW-a;
-    mag = mag(a:end-b);
-    phase = phase(a:end-b);
+persistent cache = struct ('f',[],'smooth_interval',[],'I',[],'fL',[],'WF',[],'NW',0,'nfft',0); % interpolation weights and window spectrum of the last f / smooth_interval
+
+if ~exist ('method','var') || isempty (method)
+	method = 'log';
+end
+
+is_vector = isvector (mag);
+is_row = is_vector && size (mag,1) == 1;
+if is_vector % make sure we've got column vectors
+	mag = mag(:);
+	phase = phase(:);
+end
+if size (mag,1) ~= length (f) || ~isequal (size(mag),size(phase))
+	error ('mataa_FR_smooth: mag and phase must have the same size, with one value per frequency in each column.')
+end
+
+switch lower (method)
+
+	case 'log'
+		% fractional octave between last and second-last data point:
+		Nf  = log2 (f(end)/f(end-1));
+
+		% number of points corresponding to smooth_interval:
+		Ns = round (smooth_interval / Nf);
+
+		% smooth the log-f data:
+		if Ns > 1 % otherwise no smoothing is required
+
+			if ~( isequal (cache.f,f) && isequal (cache.smooth_interval,smooth_interval) )
+				No = log2 (f(end)/f(1)); % number of octaves covered by full data set
+				NL = round (No/Nf); % number of data points required for log-interpolation to capture the original data at full resolution
+
+				% linear interpolation (and extrapolation) to log-distributed frequency values, as sparse matrix:
+				f0 = f(:);
+				fL = logspace(log10(f0(1)),log10(f0(end)),NL);
+				j  = min (max (lookup (f0,fL(:)),1),length(f0)-1);
+				w  = ( fL(:) - f0(j) ) ./ ( f0(j+1) - f0(j) );
+				cache.I = sparse ([1:NL 1:NL]',[j ; j+1],[1-w ; w],NL,length(f0));
+				cache.fL = fL;
+
+				% construct sliding window W with effective width Ns:
+				W  = linspace (1/Ns,1,round(0.2*Ns));
+				W  = [ W repmat(1,1,round(0.8*Ns)) fliplr(W) ];
+				W = W / sum(W); % normalize
+				cache.NW = length(W);
+				cache.nfft = mataa_fft_length (NL+3*cache.NW-1); % linear (not circular) convolution of the padded data with W
+				cache.WF = fft (W(:),cache.nfft);
+
+				cache.f = f;
+				cache.smooth_interval = smooth_interval;
+			end
+
+			f     = cache.fL;
+			mag   = __smooth_log (cache.I*mag,cache);
+			phase = __smooth_log (cache.I*phase,cache);
+			is_row = is_vector; % vectors are returned as row vectors (same as f)
+		end
+
+	case 'octave'
+		fc = f(:);
+		df = diff (fc);
+		df = ( [ df(1) ; df ] + [ df ; df(end) ] ) / 2; % frequency spacing of each data point
+		% first and last data point in the band of each frequency value:
+		j1 = lookup (fc,fc*2^(-smooth_interval/2)) + 1;
+		j2 = lookup (fc,fc*2^(smooth_interval/2));
+		% band means from prefix sums:
+		C  = cumsum ([ 0 ; df ]);
+		wb = C(j2+1) - C(j1);
+		mag   = __band_mean (mag,df,j1,j2,wb);
+		phase = __band_mean (phase,df,j1,j2,wb);
+
+	otherwise
+		error (sprintf('mataa_FR_smooth: unknown method ''%s''.',method));
+end
+
+if is_row
+	mag = mag';
+	phase = phase';
 end
 
 if exist('Ndownsample', 'var')
 	if Ndownsample > 1
 		idx = 1:Ndownsample:numel(f);
 		f = f(idx); 
-		mag = mag(idx);
-		phase = phase(idx);
+		if is_vector
+			mag = mag(idx);
+			phase = phase(idx);
+		else
+			mag = mag(idx,:);
+			phase = phase(idx,:);
+		end
 	end
 end
+
+endfunction
+
+
+function y = __smooth_log (x,cache)
+	% convolve the columns of x with the sliding window (padded with the first / last value at the ends to avoid edge effects)
+	NL = size (x,1);
+	NW = cache.NW;
+	a  = round(1.5*NW);
+	y  = repmat (NaN,size(x));
+	nB = max (1,floor (2^22/cache.nfft)); % number of columns per FFT block (limits memory use)
+	for k = 1:nB:size(x,2)
+		j = k:min(k+nB-1,size(x,2));
+		X = [ repmat(x(1,j),NW,1) ; x(:,j) ; repmat(x(end,j),NW,1) ];
+		X = real (ifft (fft (X,cache.nfft) .* repmat (cache.WF,1,length(j))));
+		y(:,j) = X(a:a+NL-1,:);
+	end
+endfunction
+
+
+function y = __band_mean (x,df,j1,j2,wb)
+	% weighted mean of the rows j1...j2 of x (weights df), computed from prefix sums
+	C = cumsum ([ zeros(1,size(x,2)) ; x .* repmat(df,1,size(x,2)) ]);
+	y = ( C(j2+1,:) - C(j1,:) ) ./ repmat (wb,1,size(x,2));
+endfunction
@@ -1,20 +1,23 @@
-function [spl,f,d] = mataa_IR_to_CSD (h,t,T,smooth_interval);
+function [spl,f,d] = mataa_IR_to_CSD (h,t,T,smooth_interval,f_grid);
 
-% function [spl,f,d] = mataa_IR_to_CSD (h,t,T,smooth_interval);
+% function [spl,f,d] = mataa_IR_to_CSD (h,t,T,smooth_interval,f_grid);
 %
 % DESCRIPTION:
 % This function calculates cumulative spectral decay (CSD) data (SPL-responses spl at frequencies f and delay times d).
+% For each delay time T(n), the beginning of the impulse response is cut off with a smooth (half-cosine) window of width T(2)-T(1) centred at T(n). The windowed impulse responses of all delay times are transformed with a single multi-column FFT (in blocks of columns to limit the memory used for long impulse responses), and the outputs are preallocated.
 %
 % INPUT:
 % h: values impulse response (vector)
 % t: time values of samples in h (vector, in seconds) or sampling rate of h (scalar, in Hz)
 % T: desired delay times (should be evenly spaced)
-% smooth_interval (optional): if supplied, the SPL curves are smoothed using mataa_IR_to_FR_smooth
+% smooth_interval (optional): if supplied and not empty, the SPL curves are smoothed using mataa_FR_smooth
+% f_grid (optional): if supplied, the SPL curves are interpolated to a logarithmic frequency grid, which reduces the amount of data to be plotted (e.g. for interactive waterfall plots). If f_grid is a scalar, it is the number of frequency values per octave (from the lowest to the highest frequency of the spectrum), otherwise f_grid is a vector with the frequency values (Hz). Note that the spectra are interpolated, not averaged, so f_grid should be used together with smoothing to the same (or a coarser) resolution.
 %
 % OUTPUT:
 % spl: CSD data (dB)
 % f: frequency (Hz)
 % d: delay of CSD data (seconds)
+% spl, f and d are column vectors containing the spectra of all delay times, one after the other (use reshape(spl,[],length(unique(d))) to get one column per delay time).
 %  
 % EXAMPLE:
 % [h,t] = mataa_IR_demo ('FE108');
@@ -22,6 +25,8 @@ function [spl,f,d] = mataa_IR_to_CSD (h,t,T,smooth_interval);
 % [spl,f,t] = mataa_IR_to_CSD (h,t,T,1/24);
 % mataa_plot_CSDt (spl,f,t,50);
 %
+% [spl,f,t] = mataa_IR_to_CSD (h,t,[0:2E-5:4E-3],1/24,48); % 200 slices, 48 frequency values per octave
+%
 % DISCLAIMER:
 % This file is part of MATAA.
 % 
@@ -56,42 +61,55 @@ fs=(length(t)-1)/(max(t)-min(t));
 
 t = t-t(1); % shift impulse response to zero-based time
 
-spl=[]; f=[]; d=[];
-dT=T(2)-T(1);
+if length(T) > 1
+	dT=T(2)-T(1);
+else
+	dT = 1/fs;
+end
+T = T(T <= max(t)); % no data after the end of the impulse response
 
-for n=1:length(T)
-	% construct a time window to (smoothly) cut off the beginning of the impulse response:	
-	window = repmat(NaN,length(h),1);
-	window(t<T(n)-dT/2) = 0;
-	window(t>T(n)+dT/2) = 1;
-	i = find(isnan(window)); 
-	window(i)=0.5+0.5*sin(pi*(t(i)-T(n))/dT); % smooth transition from 0 to 1
-	h = window.*h;
+N  = length(h);
+nT = length(T);
+if mod(N,2) % number of frequency values without DC (see mataa_realFT)
+	Nf = (N-1)/2;
+else
+	Nf = N/2;
+end
+fI = [1:Nf]' * fs / N;
 
-	if T(n) <= max(t)
-		if exist('smooth_interval','var')
-			[splI,phase,fI] = mataa_IR_to_FR(h,t,smooth_interval,'FS');
-		else
-			[splI,phase,fI] = mataa_IR_to_FR(h,t,[],'FS');
-		end
-		
-		clear phase;
+% magnitude spectra of the windowed impulse responses (one column per delay time), in blocks of columns:
+spl = repmat (NaN,Nf,nT);
+nB = max (1,floor(2^22/N)); % number of columns per block
+for k = 1:nB:nT
+	j = k:min(k+nB-1,nT);
+	% time windows to (smoothly) cut off the beginning of the impulse response:
+	u = repmat (t,1,length(j)) - repmat (T(j)',N,1); % time relative to the delay time of each column
+	W = double (u > dT/2);
+	i = find (abs(u) <= dT/2);
+	W(i) = 0.5+0.5*sin(pi*u(i)/dT); % smooth transition from 0 to 1
+	P = fft (W .* repmat(h,1,length(j)));
+	spl(:,j) = 20*log10 (abs(P(2:Nf+1,:))/sqrt(0.5)); % dB-FS(rms), see mataa_IR_to_FR
+end
+clear u W P
 
-		% throw away data with f < fMin THIS IS TOO RESTRICTIVE!!!
-		% fMin = 1/(max(t)-(T(n)))
-		% i = find( fI >= fMin );
-		% fI = fI(i); splI = splI(i);
+if exist('smooth_interval','var') && ~isempty(smooth_interval)
+	[spl,phase,fI] = mataa_FR_smooth (spl,zeros(size(spl)),fI,smooth_interval); % all slices in one pass
+	if nT == 1
+		spl = spl(:);
+	end
+	fI = fI(:);
+end
 
-		% make sure we've got column vectors:
-		splI = splI(:);
-		fI = fI(:);
-	
-		% add the data to the output:
-		f   = [ f   ; fI ];
-		spl = [ spl ; splI ];
-		d   = [ d   ; repmat(T(n),size(fI)) ];
-    end
-%	else
-%		T(n) = NaN;
-%	end
+if exist('f_grid','var') && ~isempty(f_grid)
+	if isscalar (f_grid) % number of values per octave
+		f_grid = min (fI(1) * 2.^([0:floor(f_grid*log2(fI(end)/fI(1)))]/f_grid),fI(end));
+	end
+	f_grid = f_grid(:);
+	spl = interp1 (fI,spl,f_grid);
+	fI = f_grid;
 end
+
+% output data (one spectrum after the other):
+f   = repmat (fI,nT,1);
+d   = reshape (repmat(T',length(fI),1),[],1);
+spl = spl(:);
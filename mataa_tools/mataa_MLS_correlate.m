@@ -0,0 +1,138 @@
+function [c,is_mls] = mataa_MLS_correlate (d,m);
+
+% function [c,is_mls] = mataa_MLS_correlate (d,m);
+%
+% DESCRIPTION:
+% Calculates the periodic cross correlation of the data in d with a maximum length sequence (MLS) m using the fast Hadamard transform (FHT):
+%
+%	c(k) = sum_j d(j) * m(j-k)	(indices modulo the MLS period P)
+%
+% The MLS matrix is factorized into the Hadamard matrix and two permutations of the sample indices (Lempel / Cohn and Borish / Angell). The permutation tables depend only on the MLS, and are kept in memory for each MLS order, so that only the FHT (n*2^n additions and subtractions, no multiplications) is needed for subsequent correlations with the same MLS. Circularly shifted versions of the same MLS (e.g. with a different initial state of the shift register) use the same tables.
+%
+% If the periodic response of a system to the MLS was recorded in d (one period), then c/(a^2*(P+1)) is the impulse response of the system (apart from a small constant offset, see mataa_deconvolve_IR), where a is the amplitude of the MLS.
+%
+% INPUT:
+% d: data vector (length P = 2^n-1), or matrix with each column corresponding to one data set
+% m: one period of the MLS (length P, values +a and -a only, see mataa_signal_generator)
+%
+% OUTPUT:
+% c: periodic cross correlation (same size as d)
+% is_mls (optional): 1 if m is an MLS, 0 otherwise. If m is not an MLS (i.e. the sample indices cannot be permuted into the Hadamard domain), an error is raised unless is_mls is requested, in which case c = [] and is_mls = 0 are returned (e.g. to fall back to a correlation using the FFT, see mataa_deconvolve_IR).
+%
+% EXAMPLE:
+% > m = mataa_signal_generator ('MLS',44100,[],16); m = m(:);
+% > d = filter ([0 0.5 0.3 -0.2],1,[m;m]); d = d(end-length(m)+1:end); % periodic response of some 'DUT'
+% > h = mataa_MLS_correlate (d,m) / (length(m)+1); % impulse response (plus small offset)
+% > plot (h(1:10))
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+persistent tables = cell (1,32); % permutation tables for each MLS order
+
+m = m(:);
+if isvector (d)
+	d = d(:);
+end
+P = length (m);
+n = round (log2 (P+1));
+if P ~= 2^n-1 || n < 2 || n > 32
+	error (sprintf('mataa_MLS_correlate: length of MLS (%i) is not 2^n-1.',P));
+end
+if size (d,1) ~= P
+	error (sprintf('mataa_MLS_correlate: length of data (%i) must be equal to the length of the MLS (%i).',size(d,1),P));
+end
+a = abs (m(1));
+if any (abs(m) ~= a)
+	error ('mataa_MLS_correlate: MLS must only contain values +a and -a.');
+end
+
+m01 = ( m < 0 ); % binary MLS (+a -> 0, -a -> 1)
+
+% find the shift of m relative to the MLS used for the cached tables:
+T = tables{n};
+shift = [];
+if ~isempty (T)
+	shift = T.pos(__window (m01,0,n)+1); % position of the first n bits of m in the cached MLS
+	if isnan (shift) || ~isequal (m01,T.m01(mod([0:P-1]'+shift,P)+1))
+		shift = []; % m is not a shifted version of the cached MLS
+	end
+end
+if isempty (shift) % (re)build the tables for m
+	T.m01 = m01;
+	T.in = __window (m01,[0:P-1]',n); % FHT index of each sample of d: integer formed by the n bits m(j)...m(j+n-1)
+	T.pos = repmat (NaN,2^n,1); % sample index for each FHT index (inverse of T.in)
+	T.pos(T.in+1) = [0:P-1]';
+	jb = T.pos(2.^[0:n-1]+1); % positions of the unit vectors in the MLS
+	is_mls = ( numel (unique (T.in)) == P && ~any (T.in == 0) ); % the FHT indices of an MLS are a permutation of 1...P
+	if is_mls % an MLS also obeys the linear recurrence of its shift register (the taps follow from the positions of the unit vectors)
+		taps = m01(mod(jb+n,P)+1);
+		u = zeros (P,1);
+		for b = find (taps(:)')
+			u = u + m01(mod([0:P-1]'+b-1,P)+1);
+		end
+		is_mls = all (mod(u,2) == m01(mod([0:P-1]'+n,P)+1));
+	end
+	if ~is_mls
+		c = [];
+		if nargout > 1
+			return
+		end
+		error ('mataa_MLS_correlate: m is not a maximum length sequence.');
+	end
+	u = zeros (P,1);
+	for b = 1:n
+		u = u + 2^(b-1) * m01(mod([0:P-1]'+jb(b),P)+1);
+	end
+	T.out = u(mod(-[0:P-1]',P)+1); % FHT index of each sample of c
+	tables{n} = T;
+	shift = 0;
+end
+
+% permute the data into the Hadamard domain:
+X = zeros (2^n,size(d,2));
+X(T.in+1,:) = circshift (d,shift);
+
+% fast Hadamard transform (natural order):
+N = 2^n;
+nc = size (X,2);
+for s = 0:n-1
+	h = 2^s;
+	X = reshape (X,h,2,N/(2*h),nc);
+	X = cat (2, X(:,1,:,:)+X(:,2,:,:) , X(:,1,:,:)-X(:,2,:,:) );
+end
+X = reshape (X,N,nc);
+
+% permute back to the time domain:
+c = a * X(T.out+1,:);
+is_mls = 1;
+
+endfunction
+
+
+function v = __window (m01,j,n)
+	% integer formed by the bits m01(j)...m01(j+n-1) (zero-based, modulo length(m01)) for each index in j
+	P = length (m01);
+	v = zeros (size(j));
+	for b = 1:n
+		v = v + 2^(b-1) * m01(mod(j+b-1,P)+1);
+	end
+endfunction
@@ -0,0 +1,196 @@
+function [s,t,fs,info] = mataa_TestToneFile_to_signal (pathToFile);
+
+% function [s,t,fs,info] = mataa_TestToneFile_to_signal (pathToFile);
+%
+% DESCRIPTION:
+% Reads the data recorded by TestTone from a file on disk. The file may be in text format (the default output of TestTone) or in binary format (output of 'TestTone -b', or a binary file written by mataa_signal_to_TestToneFile). The format is detected automatically.
+%
+% INPUT:
+% pathToFile: the path (including the file name) of the file written by TestTone.
+%
+% OUTPUT:
+% s: the signal samples. Each column corresponds to one data channel, each row corresponds to a signal frame.
+% t: vector containing the times corresponding the samples in s (in seconds). If the sample rate is unknown (fs = 0), t is the frame number (starting at 0).
+% fs: sample rate (Hz), or 0 if the file does not specify the sample rate.
+% info: struct with the header information found in the file (format, numChannels, numFrames, headerSize, inputLatency, outputLatency, delay, numAverages, noise, peak, RMS, DC, clipped, aborted). The latencies are the input and output latencies of the audio stream reported by TestTone, delay is the round-trip delay of the sound I/O determined by TestTone (all in seconds, 0 if unknown). numAverages is the number of test-signal periods averaged by TestTone (1 if the data were not averaged), and noise is a row vector with the RMS noise of a single period in each channel, estimated from the variance of the periods (empty if unknown). The level statistics determined by TestTone while recording are given as row vectors with one value per channel (empty if unknown): peak (maximum absolute sample value), RMS, DC (mean) and clipped (number of samples at or above the clip level of TestTone). These include all frames recorded while the test signal was played (before averaging, if the periods were averaged). aborted is 1 if TestTone stopped the recording early because of clipping (TestTone -x option; the remaining frames are zero), 0 otherwise.
+%
+% EXAMPLE:
+% > p = mataa_signal_to_TestToneFile (rand(1000,2)*2-1,'',0,44100,'binary');
+% > [s,t,fs] = mataa_TestToneFile_to_signal (p);
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+fid = fopen(pathToFile,'rb','native');
+if fid == -1
+	error(sprintf('mataa_TestToneFile_to_signal: could not open file (''%s'').',pathToFile));
+end
+
+magic = char(fread(fid,8,'char')');
+
+if strcmp(magic,'MATAAF32') % binary TestTone format (see TestTonePA19.c)
+	info.format     = 'binary';
+	info.headerSize = fread(fid,1,'uint32');
+	info.numChannels = fread(fid,1,'uint32');
+	info.numFrames  = fread(fid,1,'uint64');
+	fs              = fread(fid,1,'float64');
+	if isempty(fs)
+		fclose(fid);
+		error('mataa_TestToneFile_to_signal: end of data file reached prematurely! Is the data file corrupted?');
+	end
+	info.inputLatency = 0;
+	info.outputLatency = 0;
+	info.delay = 0;
+	if info.headerSize >= 48 % header with latency information
+		info.inputLatency  = fread(fid,1,'float64');
+		info.outputLatency = fread(fid,1,'float64');
+	end
+	if info.headerSize >= 56 % header with round-trip delay
+		info.delay = fread(fid,1,'float64');
+	end
+	info.numAverages = 1;
+	info.noise = [];
+	info = __no_levels (info);
+	if info.headerSize >= 64 + 8*info.numChannels % header with averaging information
+		fseek(fid,56,'bof');
+		info.numAverages = fread(fid,1,'uint32');
+		flags = fread(fid,1,'uint32');
+		fseek(fid,64,'bof');
+		info.noise = fread(fid,info.numChannels,'float64')';
+		if info.headerSize >= 64 + 40*info.numChannels && bitand(flags,1) % header with level statistics
+			u = fread(fid,[info.numChannels,4],'float64')';
+			info.peak = u(1,:);
+			info.RMS = u(2,:);
+			info.DC = u(3,:);
+			info.clipped = u(4,:);
+			info.aborted = bitand(flags,2) > 0;
+		end
+	end
+	fseek(fid,info.headerSize,'bof'); % skip header fields appended by later versions of the format
+	s = fread(fid,[info.numChannels,info.numFrames],'float32=>double')';
+	fclose(fid);
+	if size(s,1) < info.numFrames
+		error(sprintf('mataa_TestToneFile_to_signal: file contains %i frames only (expected %i frames). Is the data file corrupted?',size(s,1),info.numFrames));
+	end
+
+else % text format
+	fclose(fid);
+	fid = fopen(pathToFile,'rt');
+	info.format = 'text';
+	info.headerSize = 0;
+	info.inputLatency = 0;
+	info.outputLatency = 0;
+	info.delay = 0;
+	info.numAverages = 1;
+	info.noise = [];
+	info = __no_levels (info);
+	fs = 0;
+	numChan = [];
+	doRead = 1;
+	while doRead % read the header
+		l = fgetl(fid);
+		if isempty(l)
+			fclose(fid);
+			error('mataa_TestToneFile_to_signal: found empty line in header, cannot continue.')
+		end
+		if l==-1
+			fclose(fid);
+			error('mataa_TestToneFile_to_signal: end of data file reached prematurely! Is the data file corrupted?');
+		end
+		if strfind(upper(l),'ERROR')
+			fclose(fid);
+			error(sprintf('mataa_TestToneFile_to_signal: %s',l));
+		end
+		if strfind(l,'Number of sound input channels =')
+			numChan = str2num(l(strfind(l,'=')+1:end));
+		elseif strfind(l,'Sampling rate =')
+			fs = sscanf(l(strfind(l,'=')+1:end),'%f');
+		elseif strfind(l,'Input latency =')
+			info.inputLatency = sscanf(l(strfind(l,'=')+1:end),'%f');
+		elseif strfind(l,'Output latency =')
+			info.outputLatency = sscanf(l(strfind(l,'=')+1:end),'%f');
+		elseif strfind(l,'Round-trip delay =')
+			info.delay = sscanf(l(strfind(l,'=')+1:end),'%f',1);
+		elseif strfind(l,'Number of averaged periods =')
+			info.numAverages = sscanf(l(strfind(l,'=')+1:end),'%f',1);
+		elseif strfind(l,'Noise RMS of a single period =')
+			info.noise = sscanf(l(strfind(l,'=')+1:end),'%f')';
+		elseif strfind(l,'time (s)') % this was the last line of the header
+			doRead = 0;
+		elseif ~isempty(str2num(l));
+			% this is the first line of the data block
+			doRead = 0;
+			fseek(fid,ftell(fid)-length(l)-1); % go back to the end of the previous line so that we won't miss the first line of the data later on
+		end
+	end % while doRead
+
+	if isempty(numChan)
+		fclose(fid);
+		error('mataa_TestToneFile_to_signal: could not determine number of channels in recorded data.');
+	end
+
+	% read the data:
+	out = fscanf(fid,'%f');
+
+	% level statistics and warnings written by TestTone after the data:
+	l = fgetl(fid);
+	while ischar(l)
+		if strfind(l,'recording stopped because of clipping')
+			info.aborted = 1;
+		elseif strfind(l,'Peak level =')
+			info.peak = sscanf(l(strfind(l,'=')+1:end),'%f')';
+		elseif strfind(l,'RMS level =')
+			info.RMS = sscanf(l(strfind(l,'=')+1:end),'%f')';
+		elseif strfind(l,'DC offset =')
+			info.DC = sscanf(l(strfind(l,'=')+1:end),'%f')';
+		elseif strfind(l,'Clipped samples')
+			info.clipped = sscanf(l(strfind(l,'=')+1:end),'%f')';
+		end
+		l = fgetl(fid);
+	end
+	fclose(fid);
+	l = length(out);
+	if l < 1
+		error('mataa_TestToneFile_to_signal: no data found in TestTone output file.');
+	end
+	out = reshape(out',numChan+1,l/(numChan+1))';
+	s = out(:,2:end);
+	info.numChannels = numChan;
+	info.numFrames = size(s,1);
+end
+
+if fs > 0
+	t = [0:size(s,1)-1]' / fs;
+else
+	t = [0:size(s,1)-1]';
+end
+
+endfunction
+
+
+function info = __no_levels (info)
+	% level statistics not (yet) known
+	info.peak = [];
+	info.RMS = [];
+	info.DC = [];
+	info.clipped = [];
+	info.aborted = 0;
+endfunction
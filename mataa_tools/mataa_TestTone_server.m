@@ -0,0 +1,190 @@
+function [running,fs_server] = mataa_TestTone_server (command,fs,in_path,out_path,options,N_avg);
+
+% function [running,fs_server] = mataa_TestTone_server (command,fs,in_path,out_path,options,N_avg);
+%
+% DESCRIPTION:
+% Controls the TestTone server. The TestTone server is a TestTone process that keeps the audio stream open and plays / records one test signal per request. This avoids starting a new TestTone process (with initialisation of the audio device) for every measurement, which speeds up measurements that are repeated many times (e.g. mataa_measure_sine_distortion, mataa_measure_HD_noise with N_avg > 1, or mataa_measure_GedLee). mataa_measure_signal_response uses the TestTone server if the 'audio_TestTone_server' field in the MATAA settings is set to a non-zero value, and starts the server automatically if needed.
+%
+% The TestTone server communicates with MATAA through named pipes (FIFOs), which are not available on Windows.
+%
+% NOTE: while the server is running, the audio device is in use by the server. The server is therefore also started (or restarted) with the sample rate fs required by a measurement. Use mataa_TestTone_server ('stop') before using other programs with the audio device.
+%
+% INPUT:
+% command: one of the following strings:
+%	'start': start the server with sample rate fs (if the server is already running with a different sample rate or different options, it is restarted)
+%	'stop': stop the server (if it is running)
+%	'status': check if the server is running
+%	'play': play the test signal in the TestTone file in_path and write the recorded data to the file out_path (binary TestTone format, see mataa_TestToneFile_to_signal). The server is started (or restarted) with sample rate fs if necessary.
+% fs: sample rate (Hz), for 'start' and 'play' only
+% in_path, out_path: paths of the input and output files, for 'play' only
+% options (optional): string with additional TestTone options for the audio stream (device, channel maps, buffer size and latency, e.g. '-d 2 -c 1,2 -C 1 -f 128'), for 'start' and 'play' only. Default: '' (default device and channels).
+% N_avg (optional): number of periods of the test signal to be played back to back and averaged by the server (see mataa_measure_signal_response), for 'play' only. Default: N_avg = 1.
+%
+% OUTPUT:
+% running: flag indicating if the server is running (after executing the command)
+% fs_server: sample rate of the running server (Hz), or [] if the server is not running
+%
+% EXAMPLE:
+% > mataa_settings ('audio_TestTone_server',1); % tell mataa_measure_signal_response to use the TestTone server
+% > mataa_measure_IR ('sweep',44100,1,0.1); % first measurement starts the server
+% > mataa_measure_IR ('sweep',44100,1,0.1); % no more startup delays
+% > mataa_TestTone_server ('stop');
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+plat = mataa_computer;
+if strcmp(plat,'PCWIN')
+	error('mataa_TestTone_server: the TestTone server is not available on Windows.');
+end
+
+base = sprintf('%s%smataa_TestTone_server_%s',tempdir,filesep,getenv('USER'));
+
+[running,fs_server] = __server_status(base);
+
+switch lower(command)
+	case 'status'
+		% nothing else to do
+
+	case 'stop'
+		if running
+			__server_request(base,'QUIT',0);
+			% wait for the server to quit:
+			k = 0;
+			while exist([base '.pid'],'file') && k < 50
+				pause (0.1); k = k+1;
+			end
+		end
+		running = false;
+		fs_server = [];
+
+	case {'start','play'}
+		if ~exist('fs','var')
+			error(sprintf('mataa_TestTone_server: sample rate must be specified for the ''%s'' command.',command));
+		end
+		if ~exist('options','var')
+			options = '';
+		end
+		if running && ( fs_server ~= fs || ~strcmp(__server_options(base),options) ) % server is running with the wrong sample rate or stream options
+			mataa_TestTone_server ('stop');
+			running = false;
+		end
+		if ~running
+			% query the audio device before the server blocks it (mataa_audio_info keeps this info while the server is running):
+			mataa_audio_info;
+
+			TestTone = sprintf('%s%s',mataa_path('TestTone'),'TestTonePA19');
+			system(sprintf('"%s" -S "%s" %s %s > /dev/null 2>&1 &',TestTone,base,options,num2str(fs))); % the ' are needed in case the paths contain spaces
+
+			% remember the stream options of the server:
+			fid = fopen([base '.opt'],'wt');
+			if fid ~= -1
+				fprintf(fid,'%s',options);
+				fclose(fid);
+			end
+
+			% wait for the server to get ready:
+			k = 0;
+			while ~running && k < 100
+				pause (0.05); k = k+1;
+				[running,fs_server] = __server_status(base);
+			end
+			if ~running
+				error('mataa_TestTone_server: could not start the TestTone server (does your TestTone binary support the -S option?).');
+			end
+		end
+
+		if strcmpi(command,'play')
+			if ~exist('in_path','var') || ~exist('out_path','var')
+				error('mataa_TestTone_server: input and output files must be specified for the ''play'' command.');
+			end
+			if ~exist('N_avg','var')
+				N_avg = 1;
+			end
+			rsp = __server_request(base,sprintf('PLAY\t%s\t%s\t%i',in_path,out_path,N_avg),1);
+			if ~strcmp(rsp,'OK')
+				error(sprintf('mataa_TestTone_server: %s',rsp));
+			end
+		end
+
+	otherwise
+		error(sprintf('mataa_TestTone_server: unknown command ''%s''.',command));
+end
+
+endfunction
+
+
+function [running,fs] = __server_status(base)
+	% check if the server is running (the pid file contains the process ID and the sample rate of the server):
+	running = false;
+	fs = [];
+	fid = fopen([base '.pid'],'rt');
+	if fid == -1
+		return
+	end
+	u = fscanf(fid,'%f');
+	fclose(fid);
+	if length(u) < 2 || ~exist([base '.req'],'file')
+		return
+	end
+	if kill(u(1),0) == 0 % process exists
+		running = true;
+		fs = u(2);
+	end
+endfunction
+
+
+function options = __server_options(base)
+	% TestTone options used to start the server:
+	options = '';
+	fid = fopen([base '.opt'],'rt');
+	if fid == -1
+		return
+	end
+	options = fgetl(fid);
+	fclose(fid);
+	if ~ischar(options)
+		options = '';
+	end
+endfunction
+
+
+function rsp = __server_request(base,req,wait_for_reply)
+	% send a request to the server, and wait for the reply:
+	rsp = '';
+	fid = fopen([base '.req'],'wt');
+	if fid == -1
+		error('mataa_TestTone_server: could not send request to the TestTone server.');
+	end
+	fprintf(fid,'%s\n',req);
+	fclose(fid);
+	if wait_for_reply
+		fid = fopen([base '.rsp'],'rt');
+		if fid == -1
+			error('mataa_TestTone_server: could not read reply from the TestTone server.');
+		end
+		rsp = fgetl(fid);
+		fclose(fid);
+		if ~ischar(rsp)
+			error('mataa_TestTone_server: no reply from the TestTone server.');
+		end
+	end
+endfunction
@@ -0,0 +1,86 @@
+function options = mataa_TestTone_stream_options (in_channels,out_channels);
+
+% function options = mataa_TestTone_stream_options (in_channels,out_channels);
+%
+% DESCRIPTION:
+% Returns the TestTone options for the audio stream (channel maps, sound devices, buffer size and latency) as given by the MATAA settings (see mataa_settings: audio_TestTone_InputDevice, audio_TestTone_OutputDevice, audio_TestTone_FramesPerBuffer and audio_TestTone_SuggestedLatency). Missing settings are set to their defaults. The options require a TestTone binary that supports the -b option (see TestTonePA19.c).
+%
+% INPUT:
+% in_channels (optional): ADC channels to be recorded (TestTone -c option). Default: [] (all channels).
+% out_channels (optional): DAC channels used to play the test signal (TestTone -C option). Default: [] (all channels).
+%
+% OUTPUT:
+% options: string with the TestTone options (each option followed by a space, '' if all settings are at their defaults)
+%
+% EXAMPLE:
+% > options = mataa_TestTone_stream_options (mataa_settings('channel_DUT'),mataa_settings('channel_DAC'))
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('in_channels','var')
+	in_channels = [];
+end
+if ~exist ('out_channels','var')
+	out_channels = [];
+end
+
+options = '';
+if ~isempty(in_channels)
+	options = sprintf('%s-c %s ',options,strjoin(arrayfun(@num2str,in_channels,'UniformOutput',false),','));
+end
+if ~isempty(out_channels)
+	options = sprintf('%s-C %s ',options,strjoin(arrayfun(@num2str,out_channels,'UniformOutput',false),','));
+end
+u = mataa_settings ('audio_TestTone_InputDevice');
+if isempty(u) && ~ischar(u) % settings don't have the audio_TestTone_InputDevice field ('' is the default device)
+	mataa_settings ('audio_TestTone_InputDevice',''); % set and store default
+	u = '';
+end
+if ~isempty(u)
+	options = sprintf('%s-i "%s" ',options,num2str(u));
+end
+u = mataa_settings ('audio_TestTone_OutputDevice');
+if isempty(u) && ~ischar(u) % settings don't have the audio_TestTone_OutputDevice field ('' is the default device)
+	mataa_settings ('audio_TestTone_OutputDevice',''); % set and store default
+	u = '';
+end
+if ~isempty(u)
+	options = sprintf('%s-o "%s" ',options,num2str(u));
+end
+u = mataa_settings ('audio_TestTone_FramesPerBuffer');
+if isempty(u) % settings don't have the audio_TestTone_FramesPerBuffer field
+	mataa_settings ('audio_TestTone_FramesPerBuffer',0); % set and store default
+	u = 0;
+end
+if u > 0
+	options = sprintf('%s-f %i ',options,u);
+end
+u = mataa_settings ('audio_TestTone_SuggestedLatency');
+if isempty(u) % settings don't have the audio_TestTone_SuggestedLatency field
+	mataa_settings ('audio_TestTone_SuggestedLatency',0); % set and store default
+	u = 0;
+end
+if u > 0
+	options = sprintf('%s-l %g ',options,u);
+end
+
+endfunction
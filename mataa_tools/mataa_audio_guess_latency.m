@@ -19,6 +19,9 @@ function latency = mataa_audio_guess_latency (fs,maxLatency);
 % OUTPUT:
 % latency: the latency of the system, as defined above (in seconds)
 %
+% NOTE:
+% With TestTone and binary data exchange, TestTone determines the round-trip delay of the audio hardware (t1 + t3) in every measurement, and removes it from the recorded data if the 'audio_TestTone_trim' field in the MATAA settings is set (see mataa_measure_signal_response). A separate latency measurement is then not needed.
+%
 % DISCLAIMER:
 % This file is part of MATAA.
 % 
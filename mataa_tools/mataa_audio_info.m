@@ -1,12 +1,22 @@
-function audioInfo = mataa_audio_info;
+function audioInfo = mataa_audio_info (rescan);
 
-% function audioInfo = mataa_audio_info;
+% function audioInfo = mataa_audio_info (rescan);
 %
 % DESCRIPTION:
 % This function returns a struct (audioInfo) containing information on the default devices for audio input and output. Note: the list of supported sample rates reflects the 'standard' rates offered by the operating system. This is not necessarily identical to the rates supported by hardware itself, as the operating system may provide other rates, e.g. by (automatic) sample-rate conversion (such as in the case of Mac OS X / CoreAudio). Also, the list of supported sample rates may be incomplete, because the TestDevices programs checks for 'standard' rates only. It may therefore be possible to use other sample rates than those returned from this function (check the description of your audio hardware if you need to know the rates supported by the hardware). This function checks for full and half duplex operation (i.e. if the input and output devices are the same), and returns the list of supported sample rates depending on full or half duplex operation (they may be different, e.g. if a high sampling rate is only available with half duplex due to limits in the data transfer rates).
 %
+% The properties of the audio devices are checked by the TestDevices program, using the devices given in the MATAA settings (audio_TestTone_InputDevice and audio_TestTone_OutputDevice). Because this check is slow with some audio devices, its results are stored in a device database (file .mataa_devices.mat in the same directory as the MATAA settings file), and the full check is run only once for each combination of input and output device. Later calls of mataa_audio_info only identify the devices (fast, without checking sample rates and formats) and return the information from the database for the device IDs found, so that a different device (e.g. after plugging in another audio interface or changing the default device of the operating system) is recognised at the next call. The device database requires a TestDevices binary supporting the -j and -l options and Octave with the jsondecode function; otherwise, the full check is run at every call.
+%
+% NOTE: while the TestTone server is running (see mataa_TestTone_server), the audio device is busy and cannot be queried. mataa_audio_info then returns the information obtained in the last query before the server was started.
+%
 % NOTE: some audio interfaces react in unwanted ways to the audio-info query. For instance, the RTX-6001 goes through a nasty cycle of relays clicking, which causes clicks in its audio output and may lead to excessive wear of the relays. To avoid such effects, the test query can be skipped by changing the value of the 'audioinfo_skipcheck' field in the MATAA settings to a non-zero value. mataa_audio_info will then return audioInfo corresponding to a "typical" generic audio interface.
 %
+% INPUT:
+% rescan (optional): if non-zero, check the audio devices again and update the device database, e.g. after a driver update (default: rescan = 0)
+%
+% OUTPUT:
+% audioInfo: struct with the fields 'input' and 'output', each containing the device name, the host API (API), the number of channels, and the supported sample rates (sampleRates; for the 32-bit float format used by TestTone if the device database is used). With the device database, the supported sample rates for each sample format (formats: struct array with fields format, bits and sampleRates) and the device ID are also given.
+%
 % EXAMPLE:
 % (get some information on the audio hardware):
 % > info = mataa_audio_info;
@@ -34,6 +44,19 @@ function audioInfo = mataa_audio_info;
 % Contact: info@audioroot.net
 % Further information: http://www.audioroot.net/MATAA
 
+% the audio device is in use while the TestTone server is running, so return the information obtained before the server was started:
+persistent last_audioInfo
+if ~isempty(last_audioInfo) && ~strcmp(mataa_computer,'PCWIN')
+	if mataa_TestTone_server ('status')
+		audioInfo = last_audioInfo;
+		return
+	end
+end
+
+if ~exist ('rescan','var')
+	rescan = 0;
+end
+
 % prepare device info (with empty/unknown entries):
 audioInfo.input.name = '(UNKNOWN)';
 audioInfo.input.channels = [];
@@ -89,7 +112,7 @@ else
 		audio_IO_method = 'TestTone';
 	end
 
-	if strcmp(upper(audio_IO_method),'TESTTONE')
+	if any(strcmp(upper(audio_IO_method),{'TESTTONE','TESTTONEOCT'})) % TestToneOct uses the same PortAudio devices as TestTone
 
 		switch plat
 		 case {'MAC','PCWIN','LINUX_X86-32','LINUX_X86-64','LINUX_PPC','LINUX_ARM_GNUEABIHF'}
@@ -101,55 +124,14 @@ else
 		 
 				TestDevices = sprintf('%s%s%s',mataa_path('TestDevices'),'TestDevicesPA19',extension);
 				
-				infoFile = mataa_tempfile;
-
-				input_sampleRates_halfDuplex = [];
-				input_sampleRates_fullDuplex = [];
-				output_sampleRates_halfDuplex = [];
-				output_sampleRates_fullDuplex = [];
-				
-				if strcmp(plat,'PCWIN')
-					system(sprintf('"%s" > %s',TestDevices,infoFile)); % the ' are needed if the paths contain spaces
-				else
-					system(sprintf('"%s" > %s 2>/dev/null',TestDevices,infoFile)); % the ' are needed if the paths contain spaces
+				u = [];
+				if exist ('jsondecode')
+					u = __device_database (TestDevices,rescan);
 				end
-						
-				fid=fopen(infoFile,'rt');
-				l = 0;
-				while l ~=-1
-					l = fgetl(fid);
-					% disp (l)
-					if findstr (l,'Default input device')
-						l = l(findstr(l,'=')+2:end);
-						if length(l) > 0
-							audioInfo.input.name = l;
-						end
-					end;
-					if findstr (l,'Host API (input)'), audioInfo.input.API = l(20:end); end;
-					if findstr (l,'Host API (output)'), audioInfo.output.API = l(21:end); end;
-					if findstr (l,'Max input channels'), audioInfo.input.channels = str2num(l(findstr(l,'=')+1:end)); end;
-					if findstr (l,'Supported standard sample rates (input, full-duplex'), input_sampleRates_fullDuplex = str2num(l(findstr(l,'=')+1:end)); end;
-					if findstr (l,'Supported standard sample rates (input, half-duplex'), input_sampleRates_halfDuplex = str2num(l(findstr(l,'=')+1:end)); end;
-					if findstr (l,'Default output device')
-						l = l(findstr(l,'=')+2:end);
-						if length(l) > 0
-							audioInfo.output.name = l;
-						end
-					end;
-					
-					if findstr (l,'Max output channels'), audioInfo.output.channels = str2num(l(findstr(l,'=')+1:end)); end;
-					if findstr (l,'Supported standard sample rates (output, full-duplex'), output_sampleRates_fullDuplex = str2num(l(findstr(l,'=')+1:end)); end;
-					if findstr (l,'Supported standard sample rates (output, half-duplex'), output_sampleRates_halfDuplex = str2num(l(findstr(l,'=')+1:end)); end;
-				end
-				fclose(fid);
-				delete(infoFile);
-				
-				if strcmp(audioInfo.input.name,audioInfo.output.name) % full-duplex operation
-					audioInfo.input.sampleRates = input_sampleRates_fullDuplex;
-					audioInfo.output.sampleRates = output_sampleRates_fullDuplex;
-				else % half-duplex operation
-					audioInfo.input.sampleRates = input_sampleRates_halfDuplex;
-					audioInfo.output.sampleRates = output_sampleRates_halfDuplex;
+				if isempty (u) % TestDevices or Octave without JSON support: check the devices the old way
+					audioInfo = __TestDevices_text (TestDevices,plat,audioInfo);
+				else
+					audioInfo = u;
 				end
 					
 			otherwise
@@ -173,3 +155,189 @@ else
 	end
 	
 end
+
+last_audioInfo = audioInfo;
+
+endfunction
+
+
+function audioInfo = __TestDevices_text (TestDevices,plat,audioInfo)
+	% run TestDevices and parse its text output (default devices, checked at every call)
+	infoFile = mataa_tempfile;
+
+	input_sampleRates_halfDuplex = [];
+	input_sampleRates_fullDuplex = [];
+	output_sampleRates_halfDuplex = [];
+	output_sampleRates_fullDuplex = [];
+	
+	if strcmp(plat,'PCWIN')
+		system(sprintf('"%s" > %s',TestDevices,infoFile)); % the ' are needed if the paths contain spaces
+	else
+		system(sprintf('"%s" > %s 2>/dev/null',TestDevices,infoFile)); % the ' are needed if the paths contain spaces
+	end
+			
+	fid=fopen(infoFile,'rt');
+	l = 0;
+	while l ~=-1
+		l = fgetl(fid);
+		% disp (l)
+		if findstr (l,'Default input device')
+			l = l(findstr(l,'=')+2:end);
+			if length(l) > 0
+				audioInfo.input.name = l;
+			end
+		end;
+		if findstr (l,'Host API (input)'), audioInfo.input.API = l(20:end); end;
+		if findstr (l,'Host API (output)'), audioInfo.output.API = l(21:end); end;
+		if findstr (l,'Max input channels'), audioInfo.input.channels = str2num(l(findstr(l,'=')+1:end)); end;
+		if findstr (l,'Supported standard sample rates (input, full-duplex'), input_sampleRates_fullDuplex = str2num(l(findstr(l,'=')+1:end)); end;
+		if findstr (l,'Supported standard sample rates (input, half-duplex'), input_sampleRates_halfDuplex = str2num(l(findstr(l,'=')+1:end)); end;
+		if findstr (l,'Default output device')
+			l = l(findstr(l,'=')+2:end);
+			if length(l) > 0
+				audioInfo.output.name = l;
+			end
+		end;
+		
+		if findstr (l,'Max output channels'), audioInfo.output.channels = str2num(l(findstr(l,'=')+1:end)); end;
+		if findstr (l,'Supported standard sample rates (output, full-duplex'), output_sampleRates_fullDuplex = str2num(l(findstr(l,'=')+1:end)); end;
+		if findstr (l,'Supported standard sample rates (output, half-duplex'), output_sampleRates_halfDuplex = str2num(l(findstr(l,'=')+1:end)); end;
+	end
+	fclose(fid);
+	delete(infoFile);
+	
+	if strcmp(audioInfo.input.name,audioInfo.output.name) % full-duplex operation
+		audioInfo.input.sampleRates = input_sampleRates_fullDuplex;
+		audioInfo.output.sampleRates = output_sampleRates_fullDuplex;
+	else % half-duplex operation
+		audioInfo.input.sampleRates = input_sampleRates_halfDuplex;
+		audioInfo.output.sampleRates = output_sampleRates_halfDuplex;
+	end
+endfunction
+
+
+function audioInfo = __device_database (TestDevices,rescan)
+	% identify the audio devices and return their properties from the device database (check the devices and add them to the database if they are not known yet). Returns [] if TestDevices does not support the JSON output.
+	audioInfo = [];
+
+	options = '';
+	u = mataa_settings ('audio_TestTone_InputDevice');
+	if isempty(u) && ~ischar(u) % settings don't have the audio_TestTone_InputDevice field ('' is the default device)
+		mataa_settings ('audio_TestTone_InputDevice',''); % set and store default
+		u = '';
+	end
+	if ~isempty(u)
+		options = sprintf('%s-i "%s" ',options,num2str(u));
+	end
+	u = mataa_settings ('audio_TestTone_OutputDevice');
+	if isempty(u) && ~ischar(u) % settings don't have the audio_TestTone_OutputDevice field ('' is the default device)
+		mataa_settings ('audio_TestTone_OutputDevice',''); % set and store default
+		u = '';
+	end
+	if ~isempty(u)
+		options = sprintf('%s-o "%s" ',options,num2str(u));
+	end
+
+	% identify the devices (fast, no checks of sample rates and formats):
+	j = __TestDevices_json (sprintf('"%s" -l %s',TestDevices,options)); % the " are needed if the paths contain spaces
+	if isempty (j)
+		return
+	end
+	key = sprintf ('d%s_%s',__device_id(j.input),__device_id(j.output));
+
+	path = sprintf('%s.mataa_devices.mat',mataa_path('settings'));
+	if exist ('tilde_expand')
+		path = tilde_expand (path);
+	end
+	mataa_devices = struct ();
+	if exist (path,'file')
+		u = load (path);
+		mataa_devices = u.mataa_devices;
+	end
+
+	if isfield (mataa_devices,key) && ~rescan
+		audioInfo = mataa_devices.(key);
+		return
+	end
+
+	% unknown devices: check all sample rates and formats, and add the results to the database
+	disp ('mataa_audio_info: checking the properties of the audio devices (this is done only once for each device)...');
+	j = __TestDevices_json (sprintf('"%s" -j %s',TestDevices,options));
+	if isempty (j)
+		return
+	end
+	full_duplex = ~isempty (j.input) && ~isempty (j.output) && strcmp (j.input.name,j.output.name);
+	audioInfo.input  = __device_info (j.input,full_duplex);
+	audioInfo.output = __device_info (j.output,full_duplex);
+
+	mataa_devices.(key) = audioInfo;
+	tmp = sprintf ('%s.%i.tmp',path,getpid);
+	save ('-mat',tmp,'mataa_devices');
+	if rename (tmp,path) ~= 0 % other processes may read the database at the same time, so replace it atomically
+		delete (tmp);
+		warning (sprintf('mataa_audio_info: could not write the device database %s.',path));
+	end
+endfunction
+
+
+function j = __TestDevices_json (cmd)
+	% run TestDevices and decode its JSON output ([] if this fails)
+	j = [];
+	if strcmp(mataa_computer,'PCWIN')
+		[status,out] = system (sprintf('%s 2>NUL',cmd));
+	else
+		[status,out] = system (sprintf('%s 2>/dev/null',cmd));
+	end
+	if status == 0
+		try
+			j = jsondecode (out);
+		catch
+			j = [];
+		end
+	end
+	if ~isstruct (j) || ~isfield (j,'input') || ~isfield (j,'output')
+		j = [];
+	end
+endfunction
+
+
+function id = __device_id (d)
+	if isempty (d)
+		id = 'none';
+	else
+		id = d.id;
+	end
+endfunction
+
+
+function info = __device_info (d,full_duplex)
+	% audioInfo.input / audioInfo.output from the JSON description of a device
+	info.name = '(UNKNOWN)';
+	info.channels = [];
+	info.sampleRates = [];
+	info.API = 'UNKNOWN';
+	info.id = '';
+	info.formats = struct ('format',{},'bits',{},'sampleRates',{});
+	if isempty (d)
+		return
+	end
+	info.name = d.name;
+	info.channels = d.channels;
+	info.API = d.api;
+	info.id = d.id;
+	for k = 1:length (d.formats)
+		if full_duplex
+			r = d.formats(k).fullDuplex;
+		else
+			r = d.formats(k).halfDuplex;
+		end
+		info.formats(k) = struct ('format',d.formats(k).format,'bits',d.formats(k).bits,'sampleRates',r(:)');
+	end
+	k = find (strcmp ({info.formats.format},'float32')); % sample format used by TestTone
+	if isempty (k)
+		k = 1;
+	end
+	if ~isempty (info.formats)
+		info.sampleRates = info.formats(k).sampleRates;
+	end
+endfunction
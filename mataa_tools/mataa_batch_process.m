@@ -0,0 +1,204 @@
+function [outfiles,status] = mataa_batch_process (in,outdir,param);
+
+% function [outfiles,status] = mataa_batch_process (in,outdir,param);
+%
+% DESCRIPTION:
+% Processes a batch of measurement files (e.g. all measurements of a production run after a calibration change) and exports the results to FRD files (frequency response) or ZMA files (impedance). The files are processed in parallel by a pool of Octave worker processes (parcellfun from the Octave 'parallel' package): each worker takes the next unprocessed file as soon as it has finished the previous one, so that the workers are kept busy even if the processing times of the files differ. If the 'parallel' package is not installed (or param.nproc = 1), the files are processed one after the other.
+%
+% The following file types are processed:
+% - MAT files with impulse response data written by mataa_acoustic_measure (fields h, fs, unit): time gating / cropping, detrending, SPL response, smoothing, export to FRD (same processing as mataa_acoustic_process).
+% - MAT files with impedance data written by mataa_impedance_measure (fields f, Zmag, Zphase): band limitation, smoothing, interpolation, export to ZMA.
+% - TestTone files with the recorded DUT response (see mataa_TestToneFile_to_signal): deconvolution of the impulse response from the DUT channel and the reference signal (param.ref), then processed like the impulse response data above (the unit is 'FS').
+%
+% INPUT:
+% in: directory (all *.mat files in the directory are processed), path to a manifest file (text file with one file path per line, lines starting with '%' or '#' are ignored), or cell array of file paths.
+% outdir (optional): directory for the output files (default: same directory as the input file). The output files have the same name as the input file, with extension .FRD or .ZMA.
+% param (optional): struct with processing parameters (all fields are optional):
+%	param.nproc: number of worker processes (default: number of processor cores)
+%	param.fc: lower cut-off frequency for the time gate of impulse responses (Hz, default: [], no gating)
+%	param.u0: normalise impulse responses to this drive level (V-RMS, default: [], no normalisation)
+%	param.res: smoothing of SPL / impedance curves (1/res octave, default: [], no smoothing)
+%	param.f1, param.f2: frequency range of impedance curves (Hz, default: full range)
+%	param.n: number of data points of impedance curves (logarithmic interpolation, default: [], no interpolation)
+%	param.dut_channel: channel of TestTone files with the DUT response (default: 1)
+%	param.ref: reference signal for TestTone files: channel number of the loopback channel in the same file, or path to the test-signal file (default: 2)
+%	param.info: comment written to the output files (default: name of the input file)
+%
+% OUTPUT:
+% outfiles: cell array with the paths of the output files (empty for files that could not be processed)
+% status: cell array with an empty string for each successfully processed file, or the error message otherwise
+%
+% EXAMPLE:
+% > p.fc = 200; p.res = 6; % 5 ms time gate, 1/6 octave smoothing
+% > [out,status] = mataa_batch_process ('~/measurements/run42','~/measurements/run42/FRD',p);
+% > failed = find (~cellfun('isempty',status))
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('outdir','var')
+	outdir = '';
+end
+if ~exist ('param','var')
+	param = struct ();
+end
+defaults = struct ('nproc',nproc(),'fc',[],'u0',[],'res',[],'f1',[],'f2',[],'n',[],'dut_channel',1,'ref',2,'info',[]);
+names = fieldnames (defaults);
+for i = 1:length (names)
+	if ~isfield (param,names{i})
+		param.(names{i}) = defaults.(names{i});
+	end
+end
+
+% list of files:
+if iscellstr (in)
+	files = in(:);
+elseif exist (in,'dir')
+	d = dir (fullfile (in,'*.mat'));
+	files = cellfun (@(x) fullfile (in,x),{d.name}','UniformOutput',false);
+elseif exist (in,'file')
+	files = strtrim (strsplit (fileread (in),"\n"))';
+	files = files(~cellfun ('isempty',files));
+	files = files(cellfun (@(x) ~any (x(1) == '%#'),files));
+else
+	error (sprintf('mataa_batch_process: could not find ''%s''.',in));
+end
+if ~isempty (outdir) && ~exist (outdir,'dir')
+	mkdir (outdir);
+end
+
+N = length (files);
+if N == 0
+	outfiles = {};
+	status = {};
+	return
+end
+
+nw = min (param.nproc,N);
+use_parallel = false;
+if nw > 1
+	try
+		pkg load parallel
+		use_parallel = true;
+	catch
+		warning ('mataa_batch_process: Octave package ''parallel'' is not available, processing the files one after the other.')
+	end
+end
+
+fun = @(file) __process_file (file,outdir,param);
+if use_parallel
+	% ChunksPerProc = 0: workers ask for the next file as soon as they are done (dynamic load balancing)
+	[outfiles,status] = parcellfun (nw,fun,files,'UniformOutput',false,'ChunksPerProc',0,'VerboseLevel',0);
+else
+	[outfiles,status] = cellfun (fun,files,'UniformOutput',false);
+end
+
+endfunction
+
+
+function [outfile,status] = __process_file (file,outdir,param)
+	% process one file (errors are returned in status, so that one bad file does not stop the batch)
+	outfile = '';
+	status = '';
+	try
+		[fpath,fname,ext] = fileparts (file);
+		if isempty (outdir)
+			outdir = fpath;
+		end
+		info = param.info;
+		if isempty (info)
+			info = fname;
+		end
+
+		if strcmpi (ext,'.mat')
+			X = load (file);
+		else % TestTone file with raw DUT response
+			[s,t,fs] = mataa_TestToneFile_to_signal (file);
+			if ischar (param.ref)
+				ref = mataa_TestToneFile_to_signal (param.ref);
+				ref = ref(:,1);
+			else
+				ref = s(:,param.ref);
+			end
+			X.fs = fs;
+			[X.h,X.t] = mataa_deconvolve_IR (s(:,param.dut_channel),ref,fs,'division');
+			X.unit = 'FS';
+		end
+
+		if isfield (X,'h') % impulse response
+			if ~isempty (param.u0)
+				if isfield (X,'U0')
+					X.U0rms = X.U0; % convert field name from older version
+				end
+				X.h = X.h / X.U0rms * param.u0;
+			end
+			if ~isfield (X,'t')
+				X.t = [0:length(X.h)-1]' / X.fs;
+			end
+			[t_start,t_rise] = mataa_guess_IR_start (X.h,X.t);
+			if isempty (param.fc)
+				[h,t] = mataa_signal_crop (X.h,X.fs,t_start-t_rise,X.t(end));
+			else
+				[h,t] = mataa_signal_crop (X.h,X.fs,t_start-t_rise,t_start + 1/param.fc);
+			end
+			h = detrend (h);
+			if isempty (param.res)
+				[mag,phase,f] = mataa_IR_to_FR (h,X.fs,[],X.unit);
+			else
+				[mag,phase,f] = mataa_IR_to_FR (h,X.fs,1/param.res,X.unit);
+			end
+			outfile = fullfile (outdir,[fname '.FRD']);
+
+		elseif isfield (X,'Zmag') % impedance
+			f1 = param.f1;
+			if isempty (f1)
+				f1 = min (X.f);
+			end
+			f2 = param.f2;
+			if isempty (f2)
+				f2 = max (X.f);
+			end
+			k     = find (X.f >= f1 & X.f <= f2);
+			f     = X.f(k);
+			mag   = X.Zmag(k);
+			phase = X.Zphase(k);
+			if ~isempty (param.res)
+				[mag,phase,f] = mataa_FR_smooth (mag,phase,f,1/param.res);
+			end
+			if ~isempty (param.n)
+				ff    = logspace (log10(f1),log10(f2),param.n);
+				mag   = interp1 (f,mag,ff);
+				phase = interp1 (f,phase,ff);
+				f     = ff;
+			end
+			outfile = fullfile (outdir,[fname '.ZMA']); % ZMA files have the same format as FRD files (magnitude in Ohm)
+
+		else
+			error ('unknown data (no impulse response or impedance data found).');
+		end
+
+		mataa_export_FRD (f,mag,phase,info,outfile);
+
+	catch err
+		outfile = '';
+		status = sprintf ('%s: %s',file,err.message);
+	end
+endfunction
@@ -0,0 +1,79 @@
+function info = mataa_container_info (file);
+
+% function info = mataa_container_info (file);
+%
+% DESCRIPTION:
+% Lists the contents of a MATAA container file (see mataa_container_write). Only the chunk headers are read (the reader skips over the data), so this is fast even for very large files.
+%
+% INPUT:
+% file: path of the container file
+%
+% OUTPUT:
+% info: struct array with one element for each chunk in the file, in the order of the file (fields: name, class, complex, size, offset, bytes). offset is the position of the first data byte in the file and bytes the size of the data (bytes). If several chunks have the same name, the last one is the valid one.
+%
+% EXAMPLE:
+% > info = mataa_container_info ('measurement.mmc');
+% > for k = 1:length(info), disp (sprintf('%s: %s %s',info(k).name,mat2str(info(k).size),info(k).class)); end
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+classes = {'double','single','int8','uint8','int16','uint16','int32','uint32','int64','uint64','logical','char'};
+
+fid = fopen (file,'r','ieee-le');
+if fid == -1
+	error (sprintf('mataa_container_info: could not open file %s.',file));
+end
+magic = char (fread (fid,8,'char')');
+if ~strcmp (magic,'MATAAMC1')
+	fclose (fid);
+	error (sprintf('mataa_container_info: %s is not a MATAA container file.',file));
+end
+fseek (fid,0,'eof');
+len = ftell (fid);
+
+info = struct ('name',{},'class',{},'complex',{},'size',{},'offset',{},'bytes',{});
+pos = 64;
+while pos + 40 <= len
+	fseek (fid,pos,'bof');
+	tag     = char (fread (fid,4,'char')');
+	hsize   = fread (fid,1,'uint32');
+	payload = fread (fid,1,'uint64');
+	total   = fread (fid,1,'uint64');
+	if total < hsize + payload || pos + total > len
+		warning (sprintf('mataa_container_info: %s is truncated (incomplete chunk at byte %i).',file,pos));
+		break
+	end
+	if strcmp (tag,'DATA')
+		u = fread (fid,4,'uint32'); % class, flags, number of dimensions, length of name
+		k = length (info) + 1;
+		info(k).size    = fread (fid,u(3),'uint64')';
+		info(k).name    = char (fread (fid,u(4),'uint8')');
+		info(k).class   = classes{u(1)};
+		info(k).complex = bitand (u(2),1) > 0;
+		info(k).offset  = pos + hsize;
+		info(k).bytes   = payload;
+	end
+	pos = pos + total;
+end
+fclose (fid);
+
+endfunction
@@ -0,0 +1,144 @@
+function x = mataa_container_read (file,name,rows,cols);
+
+% function x = mataa_container_read (file,name,rows,cols);
+%
+% DESCRIPTION:
+% Reads data from a MATAA container file (see mataa_container_write). Either all data in the file are read and returned as a struct (with the same structure as the data written by mataa_container_write), or a single array is read. For a single array, a range of rows (and columns) can be selected. Because the arrays are stored in row-major order, only the selected rows are read from the file (the reader seeks to the first selected row), so a small part of a very large array (e.g. a few seconds of a long multi-channel recording with one row per frame) can be read quickly and without much memory.
+%
+% INPUT:
+% file: path of the container file
+% name (optional): name of the array to be read (see mataa_container_info, e.g. 'IR/h' or 'cal{2}/ADC/sensitivity'). If name is not given or empty, all data are read.
+% rows (optional): indices of the rows to be read (e.g. 48001:96000). The rows from the smallest to the largest index are read from the file, so the rows should be close together. Default: all rows.
+% cols (optional): indices of the columns to be read (second dimension). Default: all columns.
+%
+% OUTPUT:
+% x: struct with all data (if name is not given), or the array with the given name
+%
+% EXAMPLE:
+% > s = mataa_container_read ('measurement.mmc','raw/s',[1:96000]); % first 96000 frames of the raw data
+% > s = mataa_container_read ('measurement.mmc','raw/s',[],2); % second channel
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('name','var')
+	name = '';
+end
+if ~exist ('rows','var')
+	rows = [];
+end
+if ~exist ('cols','var')
+	cols = [];
+end
+
+info = mataa_container_info (file);
+fid = fopen (file,'r','ieee-le');
+if fid == -1
+	error (sprintf('mataa_container_read: could not open file %s.',file));
+end
+
+if isempty (name) % read everything (the last chunk of each name is valid)
+	x = struct ();
+	[u,k] = unique ({info.name},'last');
+	for k = sort (k(:)')
+		x = subsasgn (x,__path_subs(info(k).name),__read_chunk(fid,info(k),[],[]));
+	end
+else
+	k = find (strcmp ({info.name},name),1,'last');
+	if isempty (k)
+		fclose (fid);
+		error (sprintf('mataa_container_read: %s does not contain any data named ''%s''.',file,name));
+	end
+	x = __read_chunk (fid,info(k),rows,cols);
+end
+fclose (fid);
+
+endfunction
+
+
+function x = __read_chunk (fid,it,rows,cols)
+	% read the rows and columns of the array described by it (see mataa_container_info)
+	prec = it.class;
+	b = [8 4 1 1 2 2 4 4 8 8 1 1](strcmp(prec,{'double','single','int8','uint8','int16','uint16','int32','uint32','int64','uint64','logical','char'}));
+	if any (strcmp (prec,{'logical','char'}))
+		prec = 'uint8';
+	end
+
+	d = it.size;
+	n_row = prod (d(2:end)) * (1+it.complex); % values per row
+	if isempty (rows)
+		rows = 1:d(1);
+	end
+	if any (rows < 1 | rows > d(1) | rows ~= round(rows))
+		error (sprintf('mataa_container_read: row index out of range (%s has %i rows).',it.name,d(1)));
+	end
+	if isempty (rows)
+		r1 = 1; r2 = 0;
+	else
+		r1 = min (rows); r2 = max (rows);
+	end
+
+	fseek (fid,it.offset + (r1-1)*n_row*b,'bof');
+	n = (r2-r1+1) * n_row;
+	v = fread (fid,n,['*' prec]);
+	if length (v) < n
+		error (sprintf('mataa_container_read: data of %s are incomplete.',it.name));
+	end
+	if it.complex
+		v = complex (v(1:2:end),v(2:2:end));
+	end
+
+	d(1) = r2-r1+1;
+	x = permute (reshape (v,fliplr(d)),[length(d):-1:1]); % row-major order
+	idx = repmat ({':'},1,length(d));
+	idx{1} = rows - r1 + 1;
+	if ~isempty (cols)
+		idx{2} = cols;
+	end
+	x = x(idx{:});
+
+	switch it.class
+		case 'logical'
+			x = logical (x);
+		case 'char'
+			x = char (x);
+	end
+endfunction
+
+
+function s = __path_subs (name)
+	% subscripts for subsasgn from a chunk name (e.g. 'cal{2}/ADC/sensitivity' --> .cal{2}.ADC.sensitivity)
+	s = struct ('type',{},'subs',{});
+	t = strsplit (name,'/');
+	for i = 1:length (t)
+		s(end+1).type = '.';
+		s(end).subs = regexp (t{i},'^[^\{\(]*','match','once');
+		u = regexp (t{i},'([\{\(])(\d+)[\}\)]','tokens');
+		for j = 1:length (u)
+			if u{j}{1} == '{'
+				s(end+1).type = '{}';
+			else
+				s(end+1).type = '()';
+			end
+			s(end).subs = { str2num(u{j}{2}) };
+		end
+	end
+endfunction
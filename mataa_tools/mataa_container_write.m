@@ -0,0 +1,170 @@
+function mataa_container_write (file,data,append);
+
+% function mataa_container_write (file,data,append);
+%
+% DESCRIPTION:
+% Writes measurement data to a MATAA container file, a chunked binary file that keeps all data belonging to a measurement together (e.g. the raw recorded data, the test signal, the calibration data, the derived impulse / frequency / CSD data and the MATAA settings). Use mataa_container_info to list the contents of a container file, and mataa_container_read to read them.
+%
+% Each numeric, logical or character array in data is written to its own chunk. Nested structs and cell arrays are written as one chunk per array, using the path of the array as the chunk name (e.g. 'cal{2}/ADC/sensitivity' for data.cal{2}.ADC.sensitivity); they are reassembled by mataa_container_read. Other data types (e.g. function handles) are skipped with a warning.
+%
+% The sample data of each chunk start at a multiple of 64 bytes from the start of the file and are stored in row-major order (the last index runs fastest, so the frames of a multi-channel signal with one column per channel are stored one after the other). Complex data are stored with interleaved real and imaginary parts. Therefore, a part of a large array (e.g. some of the frames of a long recording) can be read without reading the whole array (see mataa_container_read), and the arrays can be memory-mapped directly by other programs (e.g. numpy.memmap in Python with the offset, class and size given by mataa_container_info).
+%
+% New chunks can be appended to an existing container file without rewriting it (e.g. to add the results of an analysis to the raw data of a measurement). If a chunk with the same name exists already, the chunk written last is used by mataa_container_read.
+%
+% File format (little-endian byte order):
+%    File header (64 bytes): magic string 'MATAAMC1' (8 bytes), uint32 format version (1), uint32 alignment of the chunks (64), zeros.
+%    Chunks (each starting at a multiple of 64 bytes):
+%       offset  0: 4 bytes  chunk type ('DATA'; readers skip chunks of other types)
+%       offset  4: uint32   size of the chunk header (bytes, multiple of 64; the data start at this offset)
+%       offset  8: uint64   size of the data (bytes)
+%       offset 16: uint64   size of the chunk including header and padding (bytes, multiple of 64; the next chunk starts at this offset)
+%       offset 24: uint32   class of the data (1: double, 2: single, 3: int8, 4: uint8, 5: int16, 6: uint16, 7: int32, 8: uint32, 9: int64, 10: uint64, 11: logical (uint8), 12: char (uint8))
+%       offset 28: uint32   flags (1: complex)
+%       offset 32: uint32   number of dimensions (n)
+%       offset 36: uint32   length of the chunk name (bytes)
+%       offset 40: uint64   size of each dimension (n values)
+%       offset 40+8*n:      chunk name, zero padding up to the size of the chunk header
+%       data (row-major), zero padding up to the size of the chunk
+%
+% INPUT:
+% file: path of the container file
+% data: struct with the data to be written
+% append (optional): if non-zero, the chunks are appended to an existing container file (a new file is created if the file does not exist). Otherwise, a new file is written (an existing file is replaced). Default: append = 0.
+%
+% OUTPUT:
+% (none)
+%
+% EXAMPLE:
+% > [h,t] = mataa_IR_demo;
+% > m.IR.h = h; m.IR.t = t; m.settings = mataa_settings;
+% > mataa_container_write ('measurement.mmc',m);
+% > [mag,phase,f] = mataa_IR_to_FR (h,t);
+% > mataa_container_write ('measurement.mmc',struct('FR',struct('mag',mag,'phase',phase,'f',f)),1); % add the frequency response
+% > m = mataa_container_read ('measurement.mmc')
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~isstruct (data) || numel (data) ~= 1
+	error ('mataa_container_write: data must be a struct.');
+end
+if ~exist ('append','var')
+	append = 0;
+end
+
+items = __flatten (data,'',struct('name',{},'value',{}));
+
+if append && exist (file,'file')
+	fid = fopen (file,'r+','ieee-le');
+	if fid == -1
+		error (sprintf('mataa_container_write: could not open file %s.',file));
+	end
+	magic = char (fread (fid,8,'char')');
+	if ~strcmp (magic,'MATAAMC1')
+		fclose (fid);
+		error (sprintf('mataa_container_write: %s is not a MATAA container file.',file));
+	end
+	fseek (fid,0,'eof');
+else
+	fid = fopen (file,'w','ieee-le');
+	if fid == -1
+		error (sprintf('mataa_container_write: could not open file %s.',file));
+	end
+	fwrite (fid,'MATAAMC1','char');
+	fwrite (fid,[1 64],'uint32'); % format version, alignment
+	fwrite (fid,zeros(1,48),'uint8');
+end
+
+for k = 1:length (items)
+	__write_chunk (fid,items(k).name,items(k).value);
+end
+fclose (fid);
+
+endfunction
+
+
+function items = __flatten (x,name,items)
+	% list of the arrays in x with their paths (nested structs and cell arrays are flattened)
+	if isstruct (x)
+		f = fieldnames (x);
+		for i = 1:numel (x)
+			p = name;
+			if numel (x) > 1
+				p = sprintf ('%s(%i)',name,i);
+			end
+			for j = 1:length (f)
+				if isempty (p)
+					q = f{j};
+				else
+					q = [ p '/' f{j} ];
+				end
+				items = __flatten (x(i).(f{j}),q,items);
+			end
+		end
+	elseif iscell (x)
+		for i = 1:numel (x)
+			items = __flatten (x{i},sprintf('%s{%i}',name,i),items);
+		end
+	elseif isnumeric (x) || islogical (x) || ischar (x)
+		items(end+1).name = name;
+		items(end).value = x;
+	else
+		warning (sprintf('mataa_container_write: %s (class %s) is not supported and was not written.',name,class(x)));
+	end
+endfunction
+
+
+function __write_chunk (fid,name,x)
+	% write one array to a DATA chunk (see format description above)
+	classes = {'double','single','int8','uint8','int16','uint16','int32','uint32','int64','uint64','logical','char'};
+	bytes   = [    8       4       1      1       2       2        4       4        8       8        1        1   ];
+	code = find (strcmp (class(x),classes));
+	prec = classes{code};
+	if code > 10 % logical and char are written as uint8
+		x = uint8 (x);
+		prec = 'uint8';
+	end
+	cplx = iscomplex (x);
+
+	dims = size (x);
+	nd = length (dims);
+	x = permute (x,[nd:-1:1]); % row-major order
+	x = x(:);
+	if cplx
+		x = [ real(x) imag(x) ].';
+		x = x(:);
+	end
+
+	name = uint8 (name);
+	hsize = 64 * ceil ( (40 + 8*nd + length(name)) / 64 );
+	payload = numel (x) * bytes(code);
+	total = hsize + 64 * ceil (payload/64);
+
+	fwrite (fid,'DATA','char');
+	fwrite (fid,hsize,'uint32');
+	fwrite (fid,[payload total],'uint64');
+	fwrite (fid,[code cplx nd length(name)],'uint32');
+	fwrite (fid,dims,'uint64');
+	fwrite (fid,name,'uint8');
+	fwrite (fid,zeros(1,hsize-40-8*nd-length(name)),'uint8');
+	fwrite (fid,x,prec);
+	fwrite (fid,zeros(1,total-hsize-payload),'uint8');
+endfunction
@@ -17,6 +17,10 @@ function [y] = mataa_deConvolve(z,x);
 % then: Z = XY (where the uppercase letters denote the complex fourier transforms of x, y, and z)
 % or: fft(z) = fft(x) fft(y), where x and y are padded with zeros to length Lz
 % hence fft(y) = fft(z) / fft(x), or y = ifft( fft(z) / fft(x) )
+%
+% z may also be a matrix, where each column is deconvolved from x (the FFT of x is then computed only once).
+%
+% NOTE: this is the plain (circular) spectral division. See mataa_deconvolve_IR for deconvolution with zero padding, regularized inverse filters (sweeps) and periodic MLS cross correlation.
 % 
 % DISCLAIMER:
 % This file is part of MATAA.
@@ -39,9 +43,12 @@ function [y] = mataa_deConvolve(z,x);
 % Contact: info@audioroot.net
 % Further information: http://www.audioroot.net/MATAA
 
-x=x(:); z= z(:);
+x=x(:);
+if isvector(z)
+	z = z(:);
+end
 
-y=ifft(fft(z)./fft(x));
+y=ifft(fft(z)./repmat(fft(x),1,size(z,2)));
 
 % get rid of the complex 'noise':
 y=real(y);
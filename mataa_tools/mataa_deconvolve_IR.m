@@ -0,0 +1,216 @@
+function [h,t] = mataa_deconvolve_IR (dut,ref,fs,method,param);
+
+% function [h,t] = mataa_deconvolve_IR (dut,ref,fs,method,param);
+%
+% DESCRIPTION:
+% This function determines the impulse response h(t) of a system from the system's response (dut) to a test signal and the reference signal (ref, i.e. the test signal itself or its loopback recording). This is the deconvolution engine used by mataa_measure_IR, which can also be used to process recorded data later on (e.g. binary TestTone files).
+%
+% The deconvolution is done in the frequency domain using FFT lengths with small prime factors only (see mataa_fft_length). The FFTs of two real signals are computed with a single complex FFT, and the inverse filter of the reference signal is kept in memory, so that repeated deconvolutions with the same reference signal (e.g. multiple measurements using the same test signal) do not need to transform the reference signal again.
+%
+% INPUT:
+% dut: response of the system. Either a vector, or a matrix with each column corresponding to one recording (e.g. replicate measurements), or the path to a TestTone file (see mataa_TestToneFile_to_signal), where each channel is deconvolved separately.
+% ref: reference signal, either a vector (same reference signal for all recordings in dut), or a matrix with the same number of columns as dut (one reference signal per recording, e.g. loopback data). ref may also be the path to a TestTone file (e.g. the test signal file used with TestTone).
+% fs (optional): sample rate (Hz). If dut is a TestTone file, fs may be empty, and the sample rate given in the file is used.
+% method (optional): deconvolution method:
+%	'division' (default): spectral division of dut and ref. The signals are extended by linear ramps to zero to avoid discontinuities at the end of the data (this is the method used by mataa_measure_IR).
+%	'regularized': regularized inverse filter of ref (Kirkeby method), for sweep test signals (e.g. log sweeps). This avoids amplification of noise at frequencies where the test signal has little or no energy (e.g. outside the frequency range of the sweep). param is the regularization factor relative to the maximum energy of the ref spectrum (default: param = 1E-4).
+%	'mls': periodic cross correlation with a maximum length sequence (MLS), computed with the fast Hadamard transform (see mataa_MLS_correlate). ref must contain one period of the MLS (param = period length, default: length of ref), and dut contains the response to one or more periods of the MLS. If dut contains more than one full period, the first period is discarded (transient response to the start of the MLS) and the remaining periods are averaged. The length of h is one MLS period.
+% param (optional): see method.
+%
+% OUTPUT:
+% h: impulse response(s), each column corresponding to one column of dut. With the 'division' and 'regularized' methods, h has the same number of samples as dut.
+% t: time (s), or sample number (starting at 0) if fs is not known.
+%
+% EXAMPLE:
+% > fs = 44100; s = mataa_signal_generator ('sweep_log',fs,1,[20 20000]);
+% > y = filter ([0 0 0.5 0.3 -0.2],1,s); % response of some 'DUT'
+% > [h,t] = mataa_deconvolve_IR (y,s,fs,'regularized');
+% > plot (t(1:20),h(1:20))
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+persistent cache = struct ('method','','nfft',0,'ref',[],'param',[],'R',[]); % inverse filter of the last reference signal
+
+if ~exist ('fs','var')
+	fs = [];
+end
+if ~exist ('method','var')
+	method = 'division';
+end
+if ~exist ('param','var')
+	param = [];
+end
+
+if ischar (dut)
+	[dut,t,fs_file] = mataa_TestToneFile_to_signal (dut);
+	if isempty (fs)
+		fs = fs_file;
+	end
+end
+if ischar (ref)
+	ref = mataa_TestToneFile_to_signal (ref);
+end
+if isvector (dut)
+	dut = dut(:);
+end
+if isvector (ref)
+	ref = ref(:);
+end
+if size (ref,2) > 1 && size (ref,2) ~= size (dut,2)
+	error (sprintf('mataa_deconvolve_IR: ref must have one column or the same number of columns as dut (%i).',size(dut,2)));
+end
+
+l = size (dut,1);
+nc = size (dut,2);
+
+switch lower (method)
+
+	case {'division','regularized'}
+		if size (ref,1) ~= l
+			error (sprintf('mataa_deconvolve_IR: dut and ref must have the same length (%i and %i samples).',l,size(ref,1)));
+		end
+		if strcmpi (method,'division')
+			% extend the data by linear ramps to zero (avoids discontinuities at the end of the data):
+			uu = flipud ([1:l]'/l);
+			dut = [ dut ; uu*dut(end,:) ];
+			ref = [ ref ; uu*ref(end,:) ];
+		elseif isempty (param)
+			param = 1E-4;
+		end
+		nfft = mataa_fft_length (2*l); % zero padding to at least twice the signal length avoids circular wrap-around of the response
+
+		if size (ref,2) == 1 && strcmp (cache.method,lower(method)) && cache.nfft == nfft && isequal (cache.ref,ref) && isequal (cache.param,param)
+			% same reference signal as last time, re-use the inverse filter
+			D = __rfft (dut,nfft);
+			R = cache.R;
+		else
+			if size (ref,2) == 1
+				D = __rfft (dut,nfft);
+				R = fft (ref,nfft);
+			else % transform dut and ref together
+				X = __rfft ([ dut ref ],nfft);
+				D = X(:,1:nc);
+				R = X(:,nc+1:end);
+			end
+			if strcmpi (method,'division')
+				R = 1 ./ R;
+			else
+				P = abs (R).^2;
+				R = conj (R) ./ ( P + param*max(P(:)) );
+			end
+			if size (ref,2) == 1
+				cache.method = lower (method);
+				cache.nfft = nfft;
+				cache.ref = ref;
+				cache.param = param;
+				cache.R = R;
+			end
+		end
+
+		if size (R,2) == 1
+			H = D .* repmat (R,1,nc);
+		else
+			H = D .* R;
+		end
+		H(1,:) = 0; % remove DC
+		h = __rifft (H);
+		h = h(1:l,:); % the rest is the response to the zero padding (or the non-causal part of the regularized inverse)
+
+	case 'mls'
+		if isempty (param)
+			param = size (ref,1);
+		end
+		P = param;
+		m = ref(1:P,1);
+		K = floor (l/P); % number of full MLS periods in dut
+		if K < 1
+			error (sprintf('mataa_deconvolve_IR: dut must contain at least one full MLS period (%i samples).',P));
+		end
+		if K > 1 % discard the first period (transient response)
+			d = reshape (dut(P+1:K*P,:),P,K-1,nc);
+			d = reshape (mean (d,2),P,nc);
+		else
+			d = dut(1:P,:);
+		end
+
+		% periodic cross correlation of d with m:
+		h = [];
+		if P == 2^round(log2(P+1))-1 && all (abs(m) == abs(m(1)))
+			[h,is_mls] = mataa_MLS_correlate (d,m); % fast Hadamard transform (h = [] if m is not an MLS)
+		end
+		if isempty (h) % not a binary MLS, use the FFT
+			M = conj (fft (m));
+			h = __rifft (__rfft (d,P) .* repmat (M,1,nc));
+		end
+
+		% the periodic autocorrelation of an MLS with values +/-a is a^2*(P+1)*delta(k) - a^2, correct for the constant offset:
+		a2 = mean (m.^2);
+		if sum (m) ~= 0
+			h = ( h + a2 * repmat (sum(d,1)/sum(m),P,1) ) / ( a2*(P+1) );
+		else
+			h = h / ( a2*(P+1) );
+		end
+
+	otherwise
+		error (sprintf('mataa_deconvolve_IR: unknown method ''%s''.',method));
+end
+
+if ~isempty (fs) && fs > 0
+	t = [0:size(h,1)-1]' / fs;
+else
+	t = [0:size(h,1)-1]';
+end
+
+endfunction
+
+
+function X = __rfft (x,nfft)
+	% FFT of the real-valued columns of x (zero padded to length nfft). Two real columns are transformed with one complex FFT.
+	nc = size (x,2);
+	np = floor (nc/2);
+	X = complex (zeros (nfft,nc));
+	if np > 0
+		Z = fft (x(:,1:2:2*np) + 1i*x(:,2:2:2*np),nfft);
+		Zc = conj (Z([1 nfft:-1:2],:)); % Z(-k)*
+		X(:,1:2:2*np) = ( Z + Zc ) / 2;
+		X(:,2:2:2*np) = ( Z - Zc ) / (2i);
+	end
+	if mod (nc,2)
+		X(:,nc) = fft (x(:,nc),nfft);
+	end
+endfunction
+
+
+function x = __rifft (X)
+	% inverse FFT of the columns of X, which are the spectra of real-valued signals (Hermitian symmetric). Two columns are transformed with one complex FFT.
+	nc = size (X,2);
+	np = floor (nc/2);
+	x = zeros (size(X));
+	if np > 0
+		z = ifft (X(:,1:2:2*np) + 1i*X(:,2:2:2*np));
+		x(:,1:2:2*np) = real (z);
+		x(:,2:2:2*np) = imag (z);
+	end
+	if mod (nc,2)
+		x(:,nc) = real (ifft (X(:,nc)));
+	end
+endfunction
@@ -0,0 +1,172 @@
+function [hi,x] = mataa_deconvolve_IR_HD (y,P,T,fs,N,tL,unit);
+
+% function [hi,x] = mataa_deconvolve_IR_HD (y,P,T,fs,N,tL,unit);
+%
+% DESCRIPTION:
+% Determines the impulse responses and frequency responses of the fundamental and the harmonic distortion products from the response of a DUT to an exponential sine sweep ("Farina method"). This is the analysis engine used by mataa_measure_IR_HD, which can also be used to process recorded data later on. See mataa_measure_IR_HD for the details of the sweep signal and for references.
+%
+% The DUT response is convolved with the inverse filter of the sweep using an FFT-based overlap-save scheme: the response is cut into overlapping blocks, which are transformed with a single multi-column FFT and multiplied with the spectrum of the inverse filter. Only the part of the convolution that contains the impulse responses of the fundamental and the harmonics is computed, so that the computing time depends on the sweep length and the latency, but not on the (possibly long) zero padding of the recording. The sweep, the inverse filter and its spectrum are kept in memory for repeated analyses with the same sweep parameters (P, T, fs).
+%
+% The harmonic impulse responses are separated by their known time offsets relative to the fundamental impulse response, tN(k) = T*log(k)/(P*log(2)), and converted to frequency responses.
+%
+% INPUT:
+% y: response of the DUT to the sweep (vector), including the zero padding used for the latency of the audio interface. If y is empty, only the sweep signal x is returned (e.g. to play the test signal).
+% P: integer number of octaves of the sweep (see mataa_measure_IR_HD)
+% T: sweep duration (seconds)
+% fs: sampling frequency (Hz)
+% N: number of harmonics included in the analysis
+% tL: length of anechoic part of impulse response (seconds)
+% unit (optional): unit of y (default: unit = 'FS')
+%
+% OUTPUT:
+% hi: vector of structs with the results. hi(1) corresponds to the fundamental, h(k) to the k-th harmonic, with k = 2...N (see mataa_measure_IR_HD).
+% x: sweep signal (column vector, amplitude 1)
+%
+% EXAMPLE:
+% > fs = 48000; [hi,x] = mataa_deconvolve_IR_HD ([],8,2,fs); % sweep signal
+% > y = [ zeros(4800,1) ; x + 0.05*x.^2 ; zeros(4800,1) ]; % response of some 'DUT' with 2nd harmonic distortion
+% > hi = mataa_deconvolve_IR_HD (y,8,2,fs,3,0.01);
+% > semilogx (hi(2).f,hi(2).percent)
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2017 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+persistent cache = struct ('P',0,'Ns',0,'fs',0,'x',[],'nfft',0,'H',[]); % sweep and inverse filter of the last sweep parameters
+
+% check input:
+if (P - fix(P)) ~= 0
+	error('mataa_deconvolve_IR_HD: P must be an integer');
+end
+if P <= 1
+	error('mataa_deconvolve_IR_HD: P must be greater than 1 (first octave is used for fade in of test signal)');
+end
+if ~exist ('unit','var')
+	unit = 'FS';
+end
+
+Ns = round(fs * T);
+M = Ns+1; % length of sweep and inverse filter
+
+if cache.P ~= P || cache.Ns ~= Ns || cache.fs ~= fs
+	cache.P = P;
+	cache.Ns = Ns;
+	cache.fs = fs;
+	cache.x = __sweep (P,Ns);
+	cache.nfft = mataa_fft_length (2*M); % overlap-save blocks of at least M new samples
+	n = [0:Ns]';
+	invfilter = flipud(cache.x) .* ((2 ^ (P / Ns)) .^ (-n)) .* (P * log(2)) ./ (1 - (2 ^ (-P)));
+	cache.H = fft (invfilter,cache.nfft) * (2 / Ns); % includes the amplitude scaling of the impulse response
+end
+x = cache.x;
+
+if isempty (y)
+	hi = [];
+	return
+end
+
+if (N - fix(N)) ~= 0
+	error('mataa_deconvolve_IR_HD: N must be an integer');
+end
+if N <= 0
+	error('mataa_deconvolve_IR_HD: N must be greater than 0');
+end
+
+y = y(:);
+L = length (y);
+if L < M
+	error (sprintf('mataa_deconvolve_IR_HD: the DUT response (%i samples) is shorter than the sweep (%i samples).',L,M));
+end
+
+% Time shifts of harmonics:
+tN = 0; % fundamental is at t = 0
+if N > 1
+	tN = [ tN , Ns .* log([2:N]) ./ (fs * log(2 ^ P)) ];
+end
+
+% Range of the convolution containing the impulse responses (zero-based sample indices): the fundamental starts at M-1 (no delay) or later, but not after the end of the recording. The harmonics are up to tN(N) earlier.
+o1 = max (0, M-1 - ceil(tN(end)*fs) - round(0.01*fs));
+o2 = min (L+M-2, L-1 + ceil(tL*fs));
+
+% Overlap-save convolution of y with the inverse filter, all blocks in one FFT:
+nfft = cache.nfft;
+B = nfft - M + 1; % number of output samples per block
+nb = ceil ((o2-o1+1)/B);
+yp = [ zeros(M-1,1) ; y ; zeros(max(0,o1+nb*B-L),1) ]; % yp(j) = y(j-M+1), zero-based
+Y = fft (yp([1:nfft]' + o1 + B*[0:nb-1]));
+h = real (ifft (Y .* repmat(cache.H,1,nb)));
+h = h(M:nfft,:); % valid part of each block
+h = h(:);
+h = h(1:o2-o1+1);
+t = (o1 + [0:length(h)-1]') ./ fs;
+
+% Find the start of main (fundamental) impulse response:
+k = M - o1;
+t0 = mataa_guess_IR_start(h(k:end),t(k:end));
+t = t-t0; % set pulse of fundamental to t = 0
+
+% separate the fundamental and harmonics, convert to frequency domain:
+hi = [];
+for k = 1:N
+	if k == 1
+		[u.h,u.t] = mataa_signal_crop(h,t,0,tL); % extract the fundamental
+	else
+		Lk = min ( tL/k , 0.9*(tN(k)-tN(k-1)) );
+		[u.h,u.t] = mataa_signal_crop(h,t,-tN(k),-tN(k)+Lk); % extract the k-th harmonic
+	end
+	u.h_unit = unit;
+
+	[u.mag,u.phase,u.f,u.mag_unit] = mataa_IR_to_FR (u.h,u.t,[],u.h_unit); % convert to frequency domain
+	u.f = u.f / k;
+	kNyq = find (u.f < fs/2);
+	u.mag = u.mag(kNyq);
+	u.phase = u.phase(kNyq);
+	u.f = u.f(kNyq);
+	if k > 1
+		ref = interp1 (hi(1).f,hi(1).mag,u.f);
+		u.percent = 10.^((u.mag - ref)/20) * 100; % difference relative to fundamental, in percent
+	else
+		u.percent = repmat (100,size(u.f)); % set fundamental to 100%
+	end
+	hi = [ hi u ];
+end
+
+endfunction
+
+
+function x = __sweep (P,Ns)
+	% exponential sweep with P octaves and Ns+1 samples, with fade-in and fade-out
+	n = [0:Ns]';
+	M = round(Ns / (log(2 ^ P) * (2 ^ (P + 1))));
+
+	x = sin(2 .* pi .* M .* exp(n .* log(2 ^ P) ./ Ns));
+
+	% 1 octave fade-in at beginning of test signal:
+	fadeinlen = floor(Ns / P);
+	window = flipud (mataa_signal_window (repmat(1,fadeinlen,1),'hann_half'));
+	window = postpad(window, length(x), 1);
+	x = x .* window;
+
+	% 1/24 octave fade-out at end of test signal:
+	fadeoutlen = floor(Ns / (24 * P));
+	window = mataa_signal_window (repmat(1,fadeoutlen,1),'hann_half');
+	window = prepad(window, length(x), 1);
+	x = x .* window;
+endfunction
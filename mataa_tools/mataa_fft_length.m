@@ -0,0 +1,61 @@
+function n = mataa_fft_length (L);
+
+% function n = mataa_fft_length (L);
+%
+% DESCRIPTION:
+% Returns the smallest length n >= L that is efficient for the FFT, i.e. a number whose prime factors are 2, 3, 5 and 7 only. Zero-padding data to length n instead of a length with large prime factors can speed up the FFT by orders of magnitude, while keeping the padding much shorter than rounding up to the next power of two.
+%
+% INPUT:
+% L: minimum length (positive integer)
+%
+% OUTPUT:
+% n: optimal FFT length
+%
+% EXAMPLE:
+% > n = mataa_fft_length (1000003) % gives 1000188 = 2^2 * 3^6 * 7^3 (1000003 is prime)
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+% 
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+% 
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+% 
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+% 
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+L = ceil (L);
+if L <= 1
+	n = 1;
+	return
+end
+
+% try all products 2^a * 3^b * 5^c * 7^d in the range L...2^nextpow2(L):
+n = 2^nextpow2 (L);
+p7 = 1;
+while p7 < n
+	p5 = p7;
+	while p5 < n
+		p3 = p5;
+		while p3 < n
+			p2 = p3 * 2^max ([ 0 ceil(log2(L/p3)) ]); % smallest p3*2^a >= L
+			if p2 < n
+				n = p2;
+			end
+			p3 = p3 * 3;
+		end
+		p5 = p5 * 5;
+	end
+	p7 = p7 * 7;
+end
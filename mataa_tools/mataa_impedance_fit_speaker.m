@@ -0,0 +1,266 @@
+function [x,res] = mataa_impedance_fit_speaker (f,mag,phase,model);
+
+% function [x,res] = mataa_impedance_fit_speaker (f,mag,phase,model);
+%
+% DESCRIPTION:
+% Fits a speaker impedance model (see mataa_impedance_speaker_model_LR2 and mataa_impedance_speaker_model_WRIGHT) to one or more impedance curves. This is the fitting engine used by mataa_impedance_fit_speaker_LR2 and mataa_impedance_fit_speaker_WRIGHT.
+%
+% The complex impedance data Z = mag*exp(i*phase) are fitted with a Levenberg-Marquardt algorithm, minimising the sum of the squared relative deviations |Z_model-Z|^2/|Z|^2. The model and its derivatives with respect to the parameters are calculated analytically, and the parameters are fitted on a logarithmic scale (so they remain positive). The fit is done in three steps: (1) the parameters of the resonance peak (Rdc, f0, Qe, Qm) are fitted to the data below 3*f0, starting from values estimated from the shape of the impedance peak, (2) the starting values of the high-frequency parameters are estimated from the remaining impedance at frequencies above 3*f0, and (3) all parameters are fitted to the full frequency range.
+%
+% If mag and phase are matrices, each column is fitted as a separate impedance curve. All curves are processed together (vectorised model evaluation and normal equations), which is much faster than fitting the curves one by one. The fit is deterministic and does not use global variables, so it can safely be run in parallel processes (see mataa_batch_process).
+%
+% INPUT:
+% f: frequency values of the impedance data (Hz)
+% mag: magnitude of impedance data (Ohm). Vector, or matrix with one column per impedance curve.
+% phase: phase of impedance data (degrees), same size as mag.
+% model: 'LR2' (mataa_impedance_speaker_model_LR2) or 'WRIGHT' (mataa_impedance_speaker_model_WRIGHT).
+%
+% OUTPUT:
+% x: best-fit parameters, one row per impedance curve. LR2: x = [Rdc f0 Qe Qm L1 L2 R2], WRIGHT: x = [Rdc f0 Qe Qm Kr Xr Ki Xi] (units as in the model functions, i.e. Ohm, Hz and H).
+% res: RMS relative deviation of the model from the data for each impedance curve (column vector).
+%
+% EXAMPLE:
+% > f = logspace(1,4,300)';
+% > [m1,p1] = mataa_impedance_speaker_model_LR2 (f,7.66,33.22,0.45,3.4,0.4e-3,1.1e-3,13);
+% > [m2,p2] = mataa_impedance_speaker_model_LR2 (f,6.1,45,0.35,5.0,0.3e-3,0.9e-3,9);
+% > [x,res] = mataa_impedance_fit_speaker (f,[m1 m2],[p1 p2],'LR2')
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+model = upper (model);
+if ~any (strcmp (model,{'LR2','WRIGHT'}))
+	error (sprintf('mataa_impedance_fit_speaker: unknown model ''%s''.',model));
+end
+
+f = f(:);
+if isvector (mag)
+	mag = mag(:);
+	phase = phase(:);
+end
+if size (mag,1) ~= length (f)
+	error ('mataa_impedance_fit_speaker: f and mag must be of the same length.')
+end
+if any (size(phase) ~= size(mag))
+	error ('mataa_impedance_fit_speaker: mag and phase must be of the same size.')
+end
+if any (f <= 0)
+	error ('mataa_impedance_fit_speaker: frequency values must be positive.')
+end
+
+[Nf,M] = size (mag);
+Z = mag .* exp (1i*phase/180*pi);
+W = 1 ./ mag; % weights for relative deviations
+
+% (1) fit the resonance peak (data below 3*f0):
+x = zeros (M,4);
+for m = 1:M
+	x(m,:) = __guess_LCR (f,mag(:,m));
+end
+W1 = W .* (f < 3*x(:,2)');
+k = find (sum (W1 > 0,1) < 8); % not enough data below 3*f0, use all data
+W1(:,k) = W(:,k);
+x = __LM ('LCR',f,Z,W1,x);
+
+% (2) starting values of the high-frequency part:
+Zr = Z - __model ('LCR',f,x); % impedance not explained by the resonance peak
+w = 2*pi*f;
+xh = zeros (M,3 + strcmp(model,'WRIGHT'));
+for m = 1:M
+	k = find (f >= 3*x(m,2));
+	if length (k) < 3
+		k = [max(1,Nf-2):Nf]';
+	end
+	if strcmp (model,'LR2')
+		Le = max (median (imag(Zr(k,m))./w(k)),1E-6);
+		xh(m,:) = [ Le/2 , Le , max(real(Zr(k(end),m)),0.1*x(m,1)) ];
+	else
+		[Kr,Xr] = __power_law (w(k),real(Zr(k,m)));
+		[Ki,Xi] = __power_law (w(k),imag(Zr(k,m)));
+		xh(m,:) = [ Kr , Xr , Ki , Xi ];
+	end
+end
+
+% (3) fit all parameters to the full frequency range:
+[x,res] = __LM (model,f,Z,W,[ x xh ]);
+
+endfunction
+
+
+function x = __guess_LCR (f,mag)
+	% starting values of Rdc, f0, Qe and Qm from the shape of the impedance peak
+	Rdc = min (mag);
+
+	% f0 between the steepest rise and the steepest fall of the impedance:
+	u = diff (mag);
+	F = ( f(1:end-1) + f(2:end) ) / 2;
+	[u1,k1] = max (u); [u2,k2] = min (u);
+	f0 = (F(k1)+F(k2))/2;
+
+	% impedance at f0:
+	[u,k] = min (abs(f-f0));
+	Rmax = max (mag(k),1.1*Rdc);
+
+	% frequencies where the impedance is sqrt(Rmax*Rdc):
+	k = find (f < f0);
+	if isempty (k)
+		f1 = f0/2;
+	else
+		[u,j] = min (abs(mag(k)-sqrt(Rmax*Rdc)));
+		f1 = f(k(j));
+	end
+	f2 = f0^2/f1;
+
+	Qm = f0/(f2-f1)*sqrt(Rmax/Rdc);
+	Qe = Qm / (Rmax/Rdc-1);
+	x = [ Rdc , f0 , Qe , Qm ];
+endfunction
+
+
+function [K,X] = __power_law (w,y)
+	% fit y = K*w^X to the positive values of y (log-log regression)
+	k = find (y > 0);
+	if length (k) < 2
+		X = 0.7;
+		K = max (median(abs(y)),1E-3) / median(w)^X;
+	else
+		a = [ ones(length(k),1) log(w(k)) ] \ log(y(k));
+		X = min (max (a(2),0.1),1.5);
+		K = exp (mean (log(y(k)) - X*log(w(k))));
+	end
+endfunction
+
+
+function [Z,J] = __model (model,f,x)
+	% impedance Z of the model at frequencies f (one column per row of x), and derivatives with respect to the logarithms of the parameters (J(:,:,k) = x(:,k)' .* dZ/dx(:,k)')
+	Rdc = x(:,1)'; f0 = x(:,2)'; Qe = x(:,3)'; Qm = x(:,4)';
+
+	% resonance peak (parallel LCR circuit, see mataa_impedance_speaker_model_LR2): Zlow = Rdc/Qe / (1/Qm + i*(f/f0-f0/f))
+	r = f ./ f0;
+	D = 1./Qm + 1i*(r - 1./r);
+	Zlow = Rdc ./ (Qe .* D);
+	Z = Rdc + Zlow;
+
+	if nargout > 1
+		J = zeros (length(f),rows(x),columns(x));
+		J(:,:,1) = Rdc + Zlow;
+		J(:,:,2) = 1i * Zlow .* (r + 1./r) ./ D;
+		J(:,:,3) = -Zlow;
+		J(:,:,4) = Zlow ./ (D .* Qm);
+	end
+
+	switch model
+		case 'LR2' % L1 in series with L2 || R2
+			a = 1i*2*pi*f;
+			L1 = x(:,5)'; L2 = x(:,6)'; R2 = x(:,7)';
+			Z1 = a .* L1;
+			Q = R2 + a .* L2;
+			Z2 = a .* L2 .* R2 ./ Q;
+			Z = Z + Z1 + Z2;
+			if nargout > 1
+				J(:,:,5) = Z1;
+				J(:,:,6) = Z2 .* R2 ./ Q;
+				J(:,:,7) = Z2 .* a .* L2 ./ Q;
+			end
+		case 'WRIGHT' % Kr*w^Xr + i*Ki*w^Xi
+			w = 2*pi*f;
+			lw = log (w);
+			Kr = x(:,5)'; Xr = x(:,6)'; Ki = x(:,7)'; Xi = x(:,8)';
+			Hr = Kr .* w.^Xr;
+			Hi = 1i * Ki .* w.^Xi;
+			Z = Z + Hr + Hi;
+			if nargout > 1
+				J(:,:,5) = Hr;
+				J(:,:,6) = Hr .* lw .* Xr;
+				J(:,:,7) = Hi;
+				J(:,:,8) = Hi .* lw .* Xi;
+			end
+	end
+endfunction
+
+
+function [x,res] = __LM (model,f,Zd,W,x)
+	% Levenberg-Marquardt fit of the model to the data Zd (one column per curve, weights W), starting from the parameters x (one row per curve). The logarithms of the parameters are fitted, and all curves are iterated together until each of them has converged.
+	N_iter_max = 200;
+	tol = 1E-10; % relative change of the sum of squares at convergence
+
+	M = rows (x);
+	np = columns (x);
+	p = log (x);
+	[Z,J] = __model (model,f,x);
+	r = (Z - Zd) .* W;
+	J = J .* W;
+	cost = sum (abs(r).^2,1)';
+	lambda = repmat (1E-3,M,1);
+	active = true (M,1);
+
+	for iter = 1:N_iter_max
+		ia = find (active);
+		if isempty (ia)
+			break
+		end
+		Ma = length (ia);
+
+		% normal equations of all active curves:
+		A = zeros (np,np,Ma);
+		g = zeros (np,Ma);
+		for a = 1:np
+			Ja = conj (J(:,ia,a));
+			g(a,:) = real (sum (Ja .* r(:,ia),1));
+			for b = a:np
+				A(a,b,:) = reshape (real (sum (Ja .* J(:,ia,b),1)),1,1,Ma);
+				A(b,a,:) = A(a,b,:);
+			end
+		end
+
+		% damped Gauss-Newton steps (limited to a factor of e^2 per iteration):
+		dp = zeros (Ma,np);
+		for m = 1:Ma
+			d = max (diag (A(:,:,m)),1E-12);
+			dp(m,:) = ( -( A(:,:,m) + lambda(ia(m))*diag(d) ) \ g(:,m) )';
+		end
+		dp = max (min (dp,2),-2);
+		pn = p(ia,:) + dp;
+		[Zn,Jn] = __model (model,f,exp(pn));
+		rn = (Zn - Zd(:,ia)) .* W(:,ia);
+		cn = sum (abs(rn).^2,1)';
+		ok = cn < cost(ia);
+
+		% accept the steps that reduced the sum of squares, and reduce the damping:
+		k = ia(ok);
+		converged = false (Ma,1);
+		converged(ok) = ( cost(k) - cn(ok) ) <= tol * cost(k);
+		p(k,:) = pn(ok,:);
+		r(:,k) = rn(:,ok);
+		J(:,k,:) = Jn(:,ok,:) .* W(:,k);
+		cost(k) = cn(ok);
+		lambda(k) = max (lambda(k)/10,1E-12);
+		active(ia(converged)) = false;
+
+		% increase the damping for the other curves (stop if no further improvement is possible):
+		k = ia(~ok);
+		lambda(k) = lambda(k)*10;
+		active(k) = lambda(k) <= 1E10;
+	end
+
+	x = exp (p);
+	res = sqrt (cost ./ max (1,sum(W > 0,1)'));
+endfunction
@@ -1,17 +1,25 @@
-function [Rdc,f0,Qe,Qm,L1,L2,R2] = mataa_impedance_fit_speaker_LR2 (f,mag,phase);
+function [Rdc,f0,Qe,Qm,L1,L2,R2,res] = mataa_impedance_fit_speaker_LR2 (f,mag,phase);
 
-% function [Rdc,f0,Qe,Qm,L1,L2,R2] = mataa_impedance_fit_speaker_LR2 (f,mag,phase);
+% function [Rdc,f0,Qe,Qm,L1,L2,R2,res] = mataa_impedance_fit_speaker_LR2 (f,mag,phase);
 %
 % DESCRIPTION:
 % Fits the impedance model of mataa_impedance_speaker_model_LR2 to the impedance data mag(f) and phase(f). This can be useful in determining Thielle/Small parameters from impedance measurements.
 %
+% The fit uses a Levenberg-Marquardt algorithm with analytic derivatives of the model (see mataa_impedance_fit_speaker for details). If mag and phase are matrices, each column is fitted as a separate impedance curve, and all curves are fitted together.
+%
 % INPUT:
 % f: frequency values of the impedance data
-% mag: magnitude of impedance data (Ohm)
-% phase: phase of impedance data (degrees)
+% mag: magnitude of impedance data (Ohm). Vector, or matrix with one column per impedance curve.
+% phase: phase of impedance data (degrees), same size as mag.
 %
 % OUTPUT:
-% Rdc, f0, Qe, Qm, L1, L2, R2: see mataa_impedance_speaker_model_LR2 (input parameters)
+% Rdc, f0, Qe, Qm, L1, L2, R2: see mataa_impedance_speaker_model_LR2 (input parameters). If more than one impedance curve is fitted, these are row vectors with one value per curve.
+% res: RMS relative deviation of the model from the data (see mataa_impedance_fit_speaker)
+%
+% EXAMPLE:
+% > f = logspace(1,4,300);
+% > [mag,phase] = mataa_impedance_speaker_model_LR2 (f,7.66,33.22,0.45,3.4,0.4e-3,1.1e-3,13);
+% > [Rdc,f0,Qe,Qm,L1,L2,R2] = mataa_impedance_fit_speaker_LR2 (f,mag,phase)
 % 
 % DISCLAIMER:
 % This file is part of MATAA.
@@ -34,139 +42,13 @@ function [Rdc,f0,Qe,Qm,L1,L2,R2] = mataa_impedance_fit_speaker_LR2 (f,mag,phase)
 % Contact: info@audioroot.net
 % Further information: http://www.audioroot.net/MATAA
 
-if exist ('OCTAVE_VERSION','builtin')
-    if ~exist ('fminsearch','file')
-        error ('mataa_impedance_fit_speaker: the ''fminsearch'' function is missing. You may need to install the optim package from Octave forge.')
-    end
-end
-
-if ~(length (f) == length (mag))
-    error ('mataa_impedance_fit_speaker: f and mag must be of the same length.')
-end
-
-% unwrap phase:
-phase = unwrap (phase/180*pi)/pi*180;
-
-% guess starting value for Rdc:
-Rdc = min (mag);
-
-% guess starting values for f0:
-u = diff (mag);
-F = ( f(1:end-1) + f(2:end))/2;
-[u1,k1] = max (u); [u2,k2] = min (u);
-if ~exist ('f0','var')
-    f0 = (F(k1)+F(k2))/2;
-end
-clear F
-
-% estimate impedance at f0:
-[u,k] = min(abs(f-f0));
-Rmax = mag(k);
-clear u
-clear k
-
-% estimate f1 and f2:
-k = find(f<f0);
-[u,k] = min(abs(mag(k)-sqrt(Rmax*Rdc)));
-f1 = f(k);
-clear u
-clear k
-f2 = f0^2/f1;
-
-% guess starting values for Qe and Qm:
-Qm = f0/(f2-f1)*sqrt(Rmax/Rdc);
-Qe = Qm / (Rmax/Rdc-1);
-
-clear f1
-clear f2
-
-i_low = find (f < 3*f0);
-i_high = find (f >= 3*f0);
-
-% find best-fit values of Rdc, f0, Q, L1, L2, and R2:
-global ff = f;
-global ff_low = f (i_low);
-global ff_high = f (i_high);
-global mm = mag;
-global pp = phase;
-global mm_low = mag(i_low);
-global mm_high = mag(i_high);;
-global pp_low = phase(i_low);
-global pp_high = phase(i_high);;
-global x1
-
-% fit low-frequency part
-x0 = [Rdc f0 Qe Qm];
-x1 = fminsearch (@ZspeakerMin_low,x0);
-
-% fit high-frequency part:
-x0 = [1 1 1];
-x2 = fminsearch (@ZspeakerMin_high,x0);
-
-% fit full frequency range:
-x0 = [x1 x2];
-x = fminsearch (@ZspeakerMin_full,x0);
-% x = x0;
-
-clear global ff
-clear global mm
-
-Rdc = x(1);
-f0  = x(2);
-Qe  = x(3);
-Qm  = x(4);
-L1  = x(5)/1000;
-L2  = x(6)/1000;
-R2  = x(7);
-
-%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
-
-function chiSquare = ZspeakerMin_general (f,MAG,PHAS,Rdc,f0,Qe,Qm,L1,L2,R2)
-x = [Rdc,f0,Qe,Qm,L1,L2,R2];
-if any (i = find (x < 0))
-    chiSquare = 1E7 + (sum (abs (x(i))))^10;
-elseif Rdc == 0
-    chiSquare = 1E7;
-elseif Qe == 0
-    chiSquare = 1E7;
-elseif Qm == 0
-    chiSquare = 1E7;
-elseif f0 == 0
-    chiSquare = 1E7;
-elseif R2 == 0
-    chiSquare = 1E7;
-else
-    [m,p] = mataa_impedance_speaker_model_LR2 (f,Rdc,f0,Qe,Qm,L1/1000,L2/1000,R2);
-    chiSquare = sum ((m-MAG).^2) + sum ( ( (p-mean (p)) - (PHAS-mean(PHAS)) ).^2);
-end
-
-
-
-
-function chiSquare = ZspeakerMin_low (x)
-    global ff_low;
-    global mm_low;
-    global pp_low;
-    
-    chiSquare = ZspeakerMin_general(ff_low,mm_low,pp_low,x(1),x(2),x(3),x(4),0,0,Inf);
-
-
-
-
-function chiSquare = ZspeakerMin_high (x)
-    global ff_high;
-    global mm_high;
-    global pp_high;
-    global x1;
-    
-    chiSquare = ZspeakerMin_general(ff_high,mm_high,pp_high,x1(1),x1(2),x1(3),x1(4),x(1),x(2),x(3)); 
-
-
-
-
-function chiSquare = ZspeakerMin_full (x)
-    global ff;
-    global mm;
-    global pp;
+[x,res] = mataa_impedance_fit_speaker (f,mag,phase,'LR2');
 
-    chiSquare = ZspeakerMin_general(ff,mm,pp,x(1),x(2),x(3),x(4),x(5),x(6),x(7)); 
+Rdc = x(:,1)';
+f0  = x(:,2)';
+Qe  = x(:,3)';
+Qm  = x(:,4)';
+L1  = x(:,5)';
+L2  = x(:,6)';
+R2  = x(:,7)';
+res = res';
@@ -0,0 +1,55 @@
+function [Rdc,f0,Qe,Qm,Kr,Xr,Ki,Xi,res] = mataa_impedance_fit_speaker_WRIGHT (f,mag,phase);
+
+% function [Rdc,f0,Qe,Qm,Kr,Xr,Ki,Xi,res] = mataa_impedance_fit_speaker_WRIGHT (f,mag,phase);
+%
+% DESCRIPTION:
+% Fits the impedance model of mataa_impedance_speaker_model_WRIGHT to the impedance data mag(f) and phase(f). This can be useful in determining Thielle/Small parameters from impedance measurements.
+%
+% The fit uses a Levenberg-Marquardt algorithm with analytic derivatives of the model (see mataa_impedance_fit_speaker for details). If mag and phase are matrices, each column is fitted as a separate impedance curve, and all curves are fitted together.
+%
+% INPUT:
+% f: frequency values of the impedance data
+% mag: magnitude of impedance data (Ohm). Vector, or matrix with one column per impedance curve.
+% phase: phase of impedance data (degrees), same size as mag.
+%
+% OUTPUT:
+% Rdc, f0, Qe, Qm, Kr, Xr, Ki, Xi: see mataa_impedance_speaker_model_WRIGHT (input parameters). If more than one impedance curve is fitted, these are row vectors with one value per curve.
+% res: RMS relative deviation of the model from the data (see mataa_impedance_fit_speaker)
+%
+% EXAMPLE:
+% > f = logspace(1,4,300);
+% > [mag,phase] = mataa_impedance_speaker_model_WRIGHT (f,6.1,45,0.35,5.0,4.5E-3,0.65,27E-3,0.68);
+% > [Rdc,f0,Qe,Qm,Kr,Xr,Ki,Xi] = mataa_impedance_fit_speaker_WRIGHT (f,mag,phase)
+% 
+% DISCLAIMER:
+% This file is part of MATAA.
+% 
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+% 
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+% 
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+% 
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+[x,res] = mataa_impedance_fit_speaker (f,mag,phase,'WRIGHT');
+
+Rdc = x(:,1)';
+f0  = x(:,2)';
+Qe  = x(:,3)';
+Qm  = x(:,4)';
+Kr  = x(:,5)';
+Xr  = x(:,6)';
+Ki  = x(:,7)';
+Xi  = x(:,8)';
+res = res';
@@ -3,14 +3,14 @@ function [t,s] = mataa_import_AIFF (file);
 % function [t,s] = mataa_import_AIFF (file)
 %
 % DESCRIPTION:
-% Import time-domain data from an AIFF file. This function requires the sndfile-convert utiliy, which is part of libsndfile ( http://www.mega-nerd.com/libsndfile ).
+% Import time-domain data from an AIFF or AIFF-C file. The file is read directly by mataa_import_file (no external programs are needed).
 %
 % INPUT:
 % file: string containing the name of the file containing the data to be imported. The string may contain a complete path. If no path is given, the file is assumed to be located in the current working directory.
 % 
 % OUTPUT:
 % t: time values (s)
-% s: signal samples
+% s: signal samples (one column per channel, scaled to the range -1...+1)
 %
 % DISCLAIMER:
 % This file is part of MATAA.
@@ -38,22 +38,7 @@ if nargin == 0
 end
 
 if length (file) == 0
-    error ('mataa_export_TMD: the file name must not be empty.');
+    error ('mataa_import_AIFF: the file name must not be empty.');
 end
 
-t = [];
-s = [];
-comments = cellstr ('');
-nc = 0;
-
-% convert the AIFF file to a MAT file:
-outfile = sprintf ('%s.mat',tmpnam);
-cmd     = sprintf ('sndfile-convert %s %s',file,outfile);
-[status, output] = system (cmd);
-
-X = load (outfile); % load the mat file
-
-delete (outfile); % clean up
-
-s = X.wavedata; s = s(:);
-t = linspace (0,(length(s)-1)/X.samplerate,length(s)); t = t(:);
\ No newline at end of file
+[t,s] = mataa_import_file (file,'AIFF');
@@ -0,0 +1,134 @@
+function [outfiles,status] = mataa_import_batch (in,outdir,nw);
+
+% function [outfiles,status] = mataa_import_batch (in,outdir,nw);
+%
+% DESCRIPTION:
+% Imports a batch of files written by other audio or measurement programs (e.g. a legacy archive of MLSSA, ARTA or AIFF measurements) with mataa_import_file, and writes the data of each file to a MATAA container file (see mataa_container_write). The container file contains the time or frequency values (x), the data (s), and the information about the file (info, see mataa_import_file), together with the path of the original file (source).
+%
+% The files are imported in parallel by a pool of Octave worker processes if the Octave 'parallel' package is available (see mataa_batch_process). Files that cannot be imported do not stop the batch; their error messages are returned in status.
+%
+% mataa_import_batch can also be run from the command line (e.g. in a shell script), for example:
+%    octave --no-gui --eval "addpath ('/path/to/MATAA/mataa_tools'); mataa_import_batch ('archive','converted');"
+%
+% INPUT:
+% in: directory (all files with a supported extension are imported: .aif, .aiff, .aifc, .wav, .rf64, .tim, .frq, .pir, .tmd; the extension is not case sensitive), path to a manifest file (text file with one file path per line, lines starting with '%' or '#' are ignored), or cell array of file paths.
+% outdir (optional): directory for the container files (default: same directory as the input file). The container files have the same name as the input file (including its extension, so that e.g. the files X.TIM and X.FRQ of an MLSSA archive are written to X.TIM.mmc and X.FRQ.mmc), with extension .mmc appended. Input files that would be written to the same container file are not imported (an error message is returned in status).
+% nw (optional): number of worker processes (default: number of processor cores)
+%
+% OUTPUT:
+% outfiles: cell array with the paths of the container files (empty for files that could not be imported)
+% status: cell array with an empty string for each successfully imported file, or the error message otherwise
+%
+% EXAMPLE:
+% > [out,status] = mataa_import_batch ('~/MLSSA_archive','~/MLSSA_archive/MATAA');
+% > failed = find (~cellfun('isempty',status))
+% > h = mataa_container_read (out{1},'s');
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('outdir','var')
+	outdir = '';
+end
+if ~exist ('nw','var')
+	nw = nproc ();
+end
+
+% list of files:
+if iscellstr (in)
+	files = in(:);
+elseif exist (in,'dir')
+	d = dir (in);
+	d = d(~[d.isdir]);
+	[p,n,ext] = cellfun (@fileparts,{d.name}','UniformOutput',false);
+	d = d(ismember (lower(ext),{'.aif','.aiff','.aifc','.wav','.rf64','.tim','.frq','.pir','.tmd'}));
+	files = cellfun (@(x) fullfile (in,x),{d.name}','UniformOutput',false);
+elseif exist (in,'file')
+	files = strtrim (strsplit (fileread (in),"\n"))';
+	files = files(~cellfun ('isempty',files));
+	files = files(cellfun (@(x) ~any (x(1) == '%#'),files));
+else
+	error (sprintf('mataa_import_batch: could not find ''%s''.',in));
+end
+if ~isempty (outdir) && ~exist (outdir,'dir')
+	mkdir (outdir);
+end
+
+N = length (files);
+if N == 0
+	outfiles = {};
+	status = {};
+	return
+end
+
+nw = min (nw,N);
+use_parallel = false;
+if nw > 1
+	try
+		pkg load parallel
+		use_parallel = true;
+	catch
+		warning ('mataa_import_batch: Octave package ''parallel'' is not available, importing the files one after the other.')
+	end
+end
+
+% container files (must be unique, files importing to the same container file would overwrite each other):
+outfiles = cellfun (@(file) __container_path (file,outdir),files,'UniformOutput',false);
+[u,i,j] = unique (outfiles);
+dup = accumarray (j(:),1)(j(:)) > 1;
+status = repmat ({''},N,1);
+
+fun = @(file,outfile) __import_file (file,outfile);
+if use_parallel
+	[outfiles(~dup),status(~dup)] = parcellfun (nw,fun,files(~dup),outfiles(~dup),'UniformOutput',false,'ChunksPerProc',0,'VerboseLevel',0);
+else
+	[outfiles(~dup),status(~dup)] = cellfun (fun,files(~dup),outfiles(~dup),'UniformOutput',false);
+end
+for k = find (dup(:))'
+	status{k} = sprintf ('%s: other input files are also written to %s, file not imported.',files{k},outfiles{k});
+	outfiles{k} = '';
+end
+
+endfunction
+
+
+function outfile = __container_path (file,outdir)
+	% path of the container file for the given input file
+	[fpath,fname,ext] = fileparts (file);
+	if isempty (outdir)
+		outdir = fpath;
+	end
+	outfile = fullfile (outdir,[fname ext '.mmc']);
+endfunction
+
+
+function [outfile,status] = __import_file (file,outfile)
+	% import one file and write it to a container file (errors are returned in status)
+	status = '';
+	try
+		[X.x,X.s,X.info] = mataa_import_file (file);
+		X.source = file;
+		mataa_container_write (outfile,X);
+	catch err
+		outfile = '';
+		status = err.message;
+	end
+endfunction
@@ -0,0 +1,412 @@
+function [x,s,info] = mataa_import_file (file,format);
+
+% function [x,s,info] = mataa_import_file (file,format);
+%
+% DESCRIPTION:
+% Import data from a file written by another audio or measurement program. The following file formats are supported:
+% - AIFF and AIFF-C (uncompressed PCM with 8, 16, 24 or 32 bits, 32 or 64 bit floating point)
+% - WAV, RF64 and BW64 (PCM with 8, 16, 24 or 32 bits, 32 or 64 bit floating point, including WAVE_FORMAT_EXTENSIBLE). RF64 / BW64 files are WAV files with 64-bit chunk sizes, which are used for recordings larger than 4 GB.
+% - MLSSA TIM (impulse response) and FRQ (transfer function) files, little or big endian
+% - ARTA PIR files (impulse response)
+% - TMD files (see mataa_import_TMD)
+%
+% The files are parsed in-process (no external programs or temporary files are used). Only the few bytes of the chunk headers are read to find the sample data, and the sample data are then read with a single fread call that also converts the byte order (bulk conversion instead of one fread call per value). This makes importing large archives of measurement files fast (see mataa_import_batch).
+%
+% INPUT:
+% file: string containing the name of the file containing the data to be imported. The string may contain a complete path. If no path is given, the file is assumed to be located in the current working directory.
+% format (optional): file format ('AIFF', 'WAV', 'MLSSA', 'PIR' or 'TMD'). Default: the format is determined from the first bytes of the file (or from the file name extension for TMD files).
+%
+% OUTPUT:
+% x: time values (s), or frequency values (Hz) for MLSSA FRQ files
+% s: signal samples (one column per channel). Integer samples of AIFF and WAV files are scaled to the range -1...+1 (full scale). For MLSSA FRQ files, s is the complex transfer function.
+% info: struct with information about the data in the file. The following fields are always present:
+%	info.format: file format ('AIFF', 'AIFC', 'WAV', 'RF64', 'MLSSA_TIM', 'MLSSA_FRQ', 'PIR' or 'TMD')
+%	info.fs: sampling rate (Hz)
+%	info.channels: number of channels
+% Further fields depend on the file format (e.g. info.bits and info.encoding for AIFF and WAV files, all header fields of MLSSA and PIR files, or info.comments for TMD files).
+%
+% EXAMPLE:
+% > [t,s,info] = mataa_import_file ('recording.wav');
+% > plot (t,s(:,1)); title (sprintf('%s file, %i channels, fs = %g Hz',info.format,info.channels,info.fs))
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if nargin == 0
+	file = '';
+end
+if ~exist ('format','var')
+	format = '';
+end
+
+if length (file) == 0
+	error ('mataa_import_file: the file name must not be empty.');
+end
+
+[fid,msg] = fopen (file,'r');
+if fid == -1
+	error (sprintf ('mataa_import_file: %s (file: %s).',msg,file))
+end
+
+% determine the file format from the first bytes of the file:
+h = fread (fid,12,'*uint8')';
+h(end+1:12) = 0;
+id = char (h(1:4));
+type = char (h(9:12));
+tag = __value (h(1:2),'uint16',0);
+[fpath,fname,ext] = fileparts (file);
+if strcmp (id,'FORM') && any (strcmp (type,{'AIFF','AIFC'}))
+	fmt = 'AIFF';
+elseif any (strcmp (id,{'RIFF','RF64','BW64'})) && strcmp (type,'WAVE')
+	fmt = 'WAV';
+elseif strcmp (id,"PIR\0")
+	fmt = 'PIR';
+elseif any (tag == [43981 52651 48350 57020])
+	fmt = 'MLSSA';
+elseif strcmpi (ext,'.tmd')
+	fmt = 'TMD';
+else
+	fmt = '';
+end
+if isempty (format)
+	format = fmt;
+	if isempty (format)
+		fclose (fid);
+		error (sprintf ('mataa_import_file: unknown file format (file: %s).',file))
+	end
+elseif ~strcmpi (format,fmt)
+	fclose (fid);
+	error (sprintf ('mataa_import_file: %s is not a %s file.',file,upper(format)))
+end
+
+try
+	switch upper (format)
+		case 'AIFF'
+			[x,s,info] = __read_AIFF (fid);
+		case 'WAV'
+			[x,s,info] = __read_WAV (fid);
+		case 'MLSSA'
+			[x,s,info] = __read_MLSSA (fid);
+		case 'PIR'
+			[x,s,info] = __read_PIR (fid);
+		case 'TMD'
+			[x,s,comments] = mataa_import_TMD (file);
+			info.format = 'TMD';
+			info.fs = 1 / mean (diff(x));
+			info.channels = 1;
+			info.comments = comments;
+	end
+catch err
+	fclose (fid);
+	error (sprintf ('mataa_import_file: %s (file: %s).',err.message,file))
+end
+fclose (fid);
+
+endfunction
+
+
+function x = __value (b,type,be)
+	% values of the given type from the bytes b (be: the bytes are in big-endian order)
+	x = typecast (uint8(b(:)'),type);
+	[c,maxsize,endian] = computer ();
+	if be ~= (endian == 'B')
+		x = swapbytes (x);
+	end
+	x = double (x);
+endfunction
+
+
+function x = __extended (b)
+	% 80-bit IEEE 754 extended precision number (big endian, used for the sampling rate in AIFF files)
+	e = bitand (__value (b(1:2),'uint16',1),32767);
+	m = __value (b(3:6),'uint32',1) * 2^32 + __value (b(7:10),'uint32',1);
+	x = m * 2^(e-16383-63);
+	if b(1) >= 128
+		x = -x;
+	end
+endfunction
+
+
+function [c,len] = __chunks (fid,pos,be)
+	% list of the chunks (id, position of data, size of data) of a RIFF or AIFF file, starting at byte pos
+	fseek (fid,0,'eof');
+	len = ftell (fid);
+	c = struct ('id',{},'pos',{},'size',{});
+	while pos + 8 <= len
+		fseek (fid,pos,'bof');
+		h = fread (fid,8,'*uint8')';
+		n = __value (h(5:8),'uint32',be);
+		c(end+1) = struct ('id',char(h(1:4)),'pos',pos+8,'size',n);
+		pos = pos + 8 + n + mod(n,2); % chunks are padded to an even number of bytes
+	end
+endfunction
+
+
+function h = __chunk_data (fid,c,id,file_type)
+	% data of the first chunk with the given id
+	k = find (strcmp ({c.id},id),1);
+	if isempty (k)
+		error (sprintf('%s chunk missing in %s file',deblank(id),file_type));
+	end
+	fseek (fid,c(k).pos,'bof');
+	h = fread (fid,c(k).size,'*uint8')';
+endfunction
+
+
+function s = __read_samples (fid,pos,N,nch,encoding,bits,be)
+	% read N frames of nch interleaved channels starting at byte pos (integer samples are scaled to -1...+1)
+	if be
+		arch = 'ieee-be';
+	else
+		arch = 'ieee-le';
+	end
+	fseek (fid,pos,'bof');
+	n = N*nch;
+	switch sprintf ('%s%i',encoding,bits)
+		case 'pcm8'
+			[s,count] = fread (fid,n,'int8=>double',0,arch);
+			s = s / 2^7;
+		case 'upcm8' % 8-bit WAV data are unsigned
+			[s,count] = fread (fid,n,'uint8=>double',0,arch);
+			s = (s-128) / 2^7;
+		case 'pcm16'
+			[s,count] = fread (fid,n,'int16=>double',0,arch);
+			s = s / 2^15;
+		case 'pcm24'
+			[u,count] = fread (fid,3*n,'*uint8');
+			u = double (reshape (u(1:3*floor(count/3)),3,[]));
+			if be
+				u = flipud (u);
+			end
+			s = ( u(1,:) + 256*u(2,:) + 65536*u(3,:) )';
+			s = ( s - 2^24*(s >= 2^23) ) / 2^23;
+			count = length (s);
+		case 'pcm32'
+			[s,count] = fread (fid,n,'int32=>double',0,arch);
+			s = s / 2^31;
+		case 'float32'
+			[s,count] = fread (fid,n,'float32=>double',0,arch);
+		case 'float64'
+			[s,count] = fread (fid,n,'float64=>double',0,arch);
+		otherwise
+			error (sprintf('%i-bit %s data are not supported',bits,encoding));
+	end
+	if count < n
+		warning (sprintf('mataa_import_file: file is truncated (%i of %i samples read).',count,n));
+		s = s(1:nch*floor(count/nch));
+	end
+	s = reshape (s,nch,[])';
+endfunction
+
+
+function [t,s,info] = __read_AIFF (fid)
+	% AIFF / AIFF-C file (big endian)
+	fseek (fid,8,'bof');
+	info.format = char (fread (fid,4,'char')');
+	c = __chunks (fid,12,1);
+
+	h = __chunk_data (fid,c,'COMM','AIFF');
+	info.channels = __value (h(1:2),'int16',1);
+	N             = __value (h(3:6),'uint32',1);
+	info.bits     = __value (h(7:8),'int16',1);
+	info.fs       = __extended (h(9:18));
+	info.encoding = 'pcm';
+	be = 1;
+	if strcmp (info.format,'AIFC')
+		switch char (h(19:22))
+			case {'NONE','twos'}
+			case 'sowt' % little-endian PCM
+				be = 0;
+			case {'fl32','FL32'}
+				info.encoding = 'float';
+				info.bits = 32;
+			case {'fl64','FL64'}
+				info.encoding = 'float';
+				info.bits = 64;
+			otherwise
+				error (sprintf('compression type ''%s'' is not supported',char(h(19:22))));
+		end
+	end
+	info.bits = 8 * ceil (info.bits/8); % samples are stored in whole bytes
+
+	k = find (strcmp ({c.id},'SSND'),1);
+	if isempty (k)
+		error ('SSND chunk missing in AIFF file');
+	end
+	fseek (fid,c(k).pos,'bof');
+	offset = fread (fid,1,'uint32',0,'ieee-be');
+	s = __read_samples (fid,c(k).pos+8+offset,N,info.channels,info.encoding,info.bits,be);
+	t = [0:rows(s)-1]' / info.fs;
+endfunction
+
+
+function [t,s,info] = __read_WAV (fid)
+	% WAV / RF64 / BW64 file (little endian)
+	fseek (fid,0,'bof');
+	info.format = char (fread (fid,4,'char')');
+	if strcmp (info.format,'BW64')
+		info.format = 'RF64';
+	elseif strcmp (info.format,'RIFF')
+		info.format = 'WAV';
+	end
+	[c,len] = __chunks (fid,12,0);
+
+	h = __chunk_data (fid,c,'fmt ','WAV');
+	tag           = __value (h(1:2),'uint16',0);
+	info.channels = __value (h(3:4),'uint16',0);
+	info.fs       = __value (h(5:8),'uint32',0);
+	blockalign    = __value (h(13:14),'uint16',0);
+	info.bits     = __value (h(15:16),'uint16',0);
+	if tag == 65534 && length (h) >= 26 % WAVE_FORMAT_EXTENSIBLE: format tag from the sub-format GUID
+		tag = __value (h(25:26),'uint16',0);
+	end
+	switch tag
+		case 1
+			info.encoding = 'pcm';
+		case 3
+			info.encoding = 'float';
+		otherwise
+			error (sprintf('WAV format tag %i is not supported',tag));
+	end
+
+	k = find (strcmp ({c.id},'data'),1);
+	if isempty (k)
+		error ('data chunk missing in WAV file');
+	end
+	n = c(k).size;
+	if strcmp (info.format,'RF64') && n == 4294967295 % size of the data is in the ds64 chunk
+		d = __chunk_data (fid,c,'ds64','RF64');
+		n = __value (d(9:16),'uint64',0);
+	end
+	n = min (n,len-c(k).pos);
+	encoding = info.encoding;
+	if strcmp (encoding,'pcm') && info.bits == 8
+		encoding = 'upcm';
+	end
+	s = __read_samples (fid,c(k).pos,floor(n/blockalign),info.channels,encoding,8*blockalign/info.channels,0);
+	t = [0:rows(s)-1]' / info.fs;
+endfunction
+
+
+function [x,p] = __field (b,p,type,n,be)
+	% n values of the given type at byte offset p of b, and the offset of the following field ([] if b is too short)
+	switch type
+		case 'char'
+			w = 1;
+		case {'int16','uint16'}
+			w = 2;
+		case {'int32','uint32','single'}
+			w = 4;
+	end
+	x = [];
+	if p + n*w <= length (b)
+		if strcmp (type,'char')
+			x = char (b(p+1:p+n));
+		else
+			x = __value (b(p+1:p+n*w),type,be);
+		end
+	end
+	p = p + n*w;
+endfunction
+
+
+function [x,s,info] = __read_MLSSA (fid)
+	% MLSSA TIM / FRQ file (MLSSA version 9.0, little or big endian)
+	fseek (fid,0,'bof');
+	b = fread (fid,Inf,'*uint8')';
+	tag = __value (b(1:2),'uint16',0);
+	be = any (tag == [52651 57020]);
+	p = 4;
+	if any (tag == [43981 52651])
+		info.format = 'MLSSA_TIM';
+		[info.acquisition_algorithm,p] = __field (b,p,'int16',1,be);
+		[dt,p] = __field (b,p,'single',1,be); % ms
+		[N,p]  = __field (b,p,'uint32',1,be);
+		[s,p]  = __field (b,p,'single',N,be);
+		[info.title,p] = __field (b,p,'char',80,be);
+		info.fs = 1000 / dt;
+		info.df = NaN;
+		x = [0:N-1]' / info.fs;
+	else
+		info.format = 'MLSSA_FRQ';
+		[df,p] = __field (b,p,'single',1,be); % kHz
+		[N,p]  = __field (b,p,'uint32',1,be);
+		[s,p]  = __field (b,p,'single',2*N,be);
+		if ~isempty (s)
+			s = complex (s(1:2:end),s(2:2:end));
+		end
+		info.df = 1000 * df;
+		info.fs = 2*(N-1) * info.df;
+		x = [0:N-1]' * info.df;
+	end
+	if isempty (s)
+		error ('MLSSA file is truncated');
+	end
+	s = s(:);
+	info.channels = 1;
+	[info.comment,p] = __field (b,p,'char',60,be);
+
+	% setup of the measurement (see the appendix of the MLSSA manual):
+	setup = { 'fftsize','uint32',1 ; 'window_type','int16',1 ; 'sample_rate','single',1 ; 'filter_band','single',1 ; 'filter_gain','single',1 ; 'filter_gain_num','int16',1 ; ...
+		'trigger_delay','uint32',1 ; 'trigger_type','int16',1 ; 'stimulus_type','int16',1 ; 'stimulus_period','uint32',1 ; 'stimulus_order','int16',1 ; 'stimulus_amp','single',1 ; ...
+		'stimulus_on','int16',1 ; 'acquire_size','uint32',1 ; 'acquire_algorithm','int16',1 ; 'filter_type','int16',1 ; 'printer_type','int16',1 ; 'beeper_on','int16',1 ; ...
+		'dc_couple','int16',1 ; 'autorange_on','int16',1 ; 'units_factor','single',1 ; 'units_label','char',11 ; 'db_reference','single',1 ; 'stim_units_factor','single',1 ; ...
+		'stim_units_label','char',11 ; 'ratio_mode','int16',1 ; 'phase_units','int16',1 ; 'equalize_on','int16',1 ; 'stimulus_low','uint32',1 ; 'stimulus_high','uint32',1 };
+	for i = 1:rows (setup)
+		[info.(setup{i,1}),p] = __field (b,p,setup{i,2},setup{i,3},be);
+	end
+endfunction
+
+
+function [t,s,info] = __read_PIR (fid)
+	% ARTA PIR file (little endian)
+	fseek (fid,0,'bof');
+	b = fread (fid,Inf,'*uint8')';
+	if length (b) < 80
+		error ('PIR file is truncated');
+	end
+	info.filesignature = char (b(1:4)); % file signature, should be PIR\0
+
+	% header (19 fields of 4 bytes: u = uint32, i = int32, f = float32):
+	names = { 'version','infosize','reserved1','reserved2','fskHz','samplerate','length','inputdevice','devicesens','measurement_type', ...
+		'avgtype','numavg','bfiltered','gentype','peakleft','peakright','gensubtype','reserved3','reserved4' };
+	types = 'uiiifiiifiiiiiffiff';
+	h = b(5:80);
+	v.u = __value (h,'uint32',0);
+	v.i = __value (h,'int32',0);
+	v.f = __value (h,'single',0);
+	for k = 1:length (names)
+		info.(names{k}) = v.(types(k))(k);
+	end
+
+	n = min (info.length,floor((length(b)-80)/4));
+	if n < info.length
+		warning (sprintf('mataa_import_file: file is truncated (%i of %i samples read).',n,info.length));
+	end
+	s = __value (b(81:80+4*n),'single',0)';
+	k = 80+4*n;
+	info.usertext = char (b(k+1:min(k+info.infosize,end)));
+
+	info.format = 'PIR';
+	info.fs = 1000 * info.fskHz;
+	info.channels = 1;
+	t = [0:n-1]' / info.fs;
+endfunction
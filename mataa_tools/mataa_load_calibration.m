@@ -1,15 +1,18 @@
-function cal = mataa_load_calibration (calfile)
+function [cal,files] = mataa_load_calibration (calfile)
 
-% function cal = mataa_load_calibration (calfile)
+% function [cal,files] = mataa_load_calibration (calfile)
 %
 % DESCRIPTION:
 % Load calibration data for test devices from calibration file.
+%
+% The calibration data are kept in memory after the file has been read (including the data of files included with FILE = ...). The data are read from disk again only if the modification time of the calibration file or of one of the included files has changed.
 % 
 % INPUT:
 % calfile: name of calibration file (e.g., "Behringer_ECM8000.txt")
 % 
 % OUTPUT:
 % cal: struct with calibration data.
+% files: cell array with the paths of the calibration file and of all files included in it
 % 
 % EXAMPLE:
 % To load the (generic) calibration data for a Behringer ECM8000 microphone:
@@ -37,15 +40,29 @@ function cal = mataa_load_calibration (calfile)
 % Further information: http://www.audioroot.net/MATAA
 
 
+persistent cache = struct ('file',{},'files',{},'stamp',{},'cal',{}); % calibration data of the files read before
+
 calpath = mataa_path ("calibration");
 calfile = sprintf ("%s%s",calpath,calfile);
 
+% use the cached data if the file and the files included in it did not change:
+k = find (strcmp ({cache.file},calfile));
+if ~isempty (k)
+	if isequal (__file_stamp (cache(k).files),cache(k).stamp)
+		cal = cache(k).cal;
+		files = cache(k).files;
+		return
+	end
+	cache(k) = [];
+end
+files = {calfile};
+
 [fid,msg] = fopen (calfile,"rt");
 if fid < 0
     error (sprintf("mataa_load_calibration: could no open calilbration file '%s' (%s).",calfile,msg));
 end
 
-f = gain = phase = [];
+data = {}; % lines with transfer function data
 lineNo = 0;
 
 % read file and parse data:
@@ -112,7 +129,8 @@ while (! feof (fid) )
 				cal.sensitivity_autoscalefunction =  strtrim (val);
 
     			case "FILE" % load data from another file
-    				u = mataa_load_calibration (val);
+    				[u,u_files] = mataa_load_calibration (val);
+    				files = [ files u_files ];
     				switch toupper(u.type)
     					case "DAC"
     						cal.DAC = u.DAC;
@@ -132,22 +150,22 @@ while (! feof (fid) )
     		end % switch key
     		
 		else % transfer function / gain in dB relative to absolute sensitivity value 
-	    	u = strsplit (untabify(l)," ");
-	    	f     = [ f    ; str2num(u{1}) ];
-	    	gain  = [ gain ; str2num(u{2}) ];
-	    	if length(u) > 2
-		    	phase = [ phase ; str2num(u{3}) ];
-		    end
+	    	data{end+1} = l; % parse all data lines at once below
     	end
     end % isempty(l)
      
 end % while feof(fid)
 
-if ~isempty (f)
-	cal.transfer.f    = f;
-	cal.transfer.gain = gain;
-	if ~isempty (phase)
-		cal.transfer.phase = phase;
+if ~isempty (data)
+	nc = numel (sscanf (data{1},"%f"));
+	X = sscanf (strjoin (data," "),"%f",[nc,Inf])';
+	if nc < 2 || size (X,1) ~= length (data)
+		error (sprintf("mataa_load_calibration: cannot parse transfer function data in file '%s' (all lines must have the same number of values: frequency, gain, and (optionally) phase).",calfile));
+	end
+	cal.transfer.f    = X(:,1);
+	cal.transfer.gain = X(:,2);
+	if nc > 2
+		cal.transfer.phase = X(:,3);
 	end
 	[cal.transfer.f,k] = sort (cal.transfer.f);
 	cal.transfer.gain = cal.transfer.gain(k);
@@ -210,3 +228,19 @@ switch toupper(cal.type)
 		error (sprintf("mataa_load_calibration: unknown device type '%s.'",cal.type))
 end
 
+% store the data in the cache:
+cache(end+1) = struct ('file',calfile,'files',{files},'stamp',__file_stamp(files),'cal',cal);
+
+endfunction
+
+
+function stamp = __file_stamp (files)
+	% modification time, size and inode of the files (one row per file, NaN if a file does not exist). The size and inode detect changes within the resolution of the modification time (see mataa_settings).
+	stamp = repmat (NaN,length(files),3);
+	for i = 1:length (files)
+		[info,err] = stat (files{i});
+		if ~err
+			stamp(i,:) = [ info.mtime info.size info.ino ];
+		end
+	end
+endfunction
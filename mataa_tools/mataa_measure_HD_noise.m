@@ -20,7 +20,7 @@ function [HD,fHD,THD,THDN,L,f,unit] = mataa_measure_HD_noise ( f0,T,fs,N_h,laten
 % fLow,fHigh (optional): frequency bandwith of analysis (default: fLow = [], fHigh = []):
 %	- If fLow is not empty, only spectral data at frequencies larger or equal to fLow are used for the analysis.
 %	- If fHIgh is not empty, only spectral data at frequencies lower or equal to fHigh are used for the analysis.
-% N_avg (optional): number of averages (integer, default: N_avg = 1). If N_avg > 1, the measurement is repeated N_avg times, and the mean result is returned. This is useful to reduce the noise floor.
+% N_avg (optional): number of averages (integer, default: N_avg = 1). If N_avg > 1, the test signal is played N_avg times in a single audio stream, and the recorded periods are averaged synchronously (see mataa_measure_sine_distortion). This is useful to reduce the noise floor. Note that this also reduces the noise contribution to THD+N.
 %
 % OUTPUT:
 % HD: amplitudes (zero-to-peak) and phase angles (radians) of the fundamental and harmonics (size(HD) = [2,N_h]).
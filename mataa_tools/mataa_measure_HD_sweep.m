@@ -0,0 +1,120 @@
+function [f0,THD,THDN,HD,settled,t_settle] = mataa_measure_HD_sweep (f1,f2,N,fs,N_h,amplitude,N_avg,fftSize,settle,out_channel);
+
+% function [f0,THD,THDN,HD,settled,t_settle] = mataa_measure_HD_sweep (f1,f2,N,fs,N_h,amplitude,N_avg,fftSize,settle,out_channel);
+%
+% DESCRIPTION:
+% Measures harmonic distortion (THD) and distortion plus noise (THD+N) versus frequency using a stepped-sine sweep. The sine tones are played back to back in a single audio stream by TestTone (-H option, see TestTonePA19.c), which generates the next tone while the current tone is recorded, and analyses the previous tone in a separate thread. For each tone, the analysis starts as soon as the DUT response has settled (the transient at the start of the tone is skipped automatically). The measurement therefore takes roughly the sum of the tone durations, instead of one TestTone run with latency padding per frequency as with repeated calls of mataa_measure_HD_noise.
+%
+% The tone frequencies are adjusted to the FFT bins (no window function is needed). The tones are played on a single DAC channel, and the ADC channel given by mataa_settings('channel_DUT') is analysed. The audio devices, buffer size and latency of the audio stream are taken from the MATAA settings (see mataa_TestTone_stream_options). The THD and THD+N ratios are normalised to the level of the fundamental (see mataa_measure_HD_noise). THD+N includes all frequencies except DC and the fundamental.
+%
+% INPUT:
+% f1, f2: frequency range of the sweep (Hz)
+% N: number of tones (logarithmic frequency spacing)
+% fs: sampling frequency in Hz
+% N_h (optional): highest harmonic analysed (default: N_h = 5)
+% amplitude (optional): amplitude of the tones (zero-to-peak, digital units, default: amplitude = 0.5)
+% N_avg (optional): number of FFT blocks averaged per tone (default: N_avg = 1)
+% fftSize (optional): FFT size (power of two, default: fftSize = 8192)
+% settle (optional): maximum settling time per tone in seconds (default: settle = 0.2). If the response has not settled within this time, the tone is analysed anyway and flagged in 'settled'.
+% out_channel (optional): DAC channel used to play the tones (default: out_channel = mataa_settings('channel_DAC'))
+%
+% OUTPUT:
+% f0: tone frequencies (Hz)
+% THD: total harmonic distortion ratio of each tone
+% THDN: THD+N ratio of each tone
+% HD: amplitudes (zero-to-peak, digital units) of the fundamental (HD(:,1)) and the harmonics (HD(:,k) = k-th harmonic, zero above the Nyquist frequency), one row per tone
+% settled: flag indicating if the response to each tone settled within the settling time
+% t_settle: start of the analysis window of each tone (s, relative to the start of the tone)
+%
+% EXAMPLE (30 tones from 20 Hz to 20 kHz, 96 kHz sampling rate):
+% > [f0,THD,THDN] = mataa_measure_HD_sweep (20,20000,30,96000);
+% > semilogx (f0,20*log10([THD THDN])); xlabel ('Frequency (Hz)'); ylabel ('Level rel. fundamental (dB)'); legend ('THD','THD+N')
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2018 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('N_h','var')
+	N_h = 5;
+end
+if ~exist ('amplitude','var')
+	amplitude = 0.5;
+end
+if ~exist ('N_avg','var')
+	N_avg = 1;
+end
+if ~exist ('fftSize','var')
+	fftSize = 8192;
+end
+if ~exist ('settle','var')
+	settle = 0.2;
+end
+if ~exist ('out_channel','var')
+	out_channel = mataa_settings ('channel_DAC');
+	if isempty(out_channel) % settings don't have the channel_DAC field
+		mataa_settings ('channel_DAC',1); % set and store default
+		out_channel = 1;
+	end
+end
+
+if amplitude <= 0 || amplitude > 1
+	error ('mataa_measure_HD_sweep: amplitude must be larger than 0 and not larger than 1 (digital units).');
+end
+if N_h < 1 || N_h > 20
+	error ('mataa_measure_HD_sweep: N_h must be between 1 and 20.');
+end
+
+% the audio device must not be blocked by the TestTone server:
+mataa_TestTone_server ('stop');
+
+% audio stream options:
+options = mataa_TestTone_stream_options (mataa_settings('channel_DUT'),out_channel);
+
+% run the sweep:
+out_path = tempname;
+TestTone = sprintf ('%s%s',mataa_path('TestTone'),'TestTonePA19');
+cmd = sprintf ('"%s" -H %g,%g,%i -a %g -N %i -A %i -F %i -s %g %s%s > "%s"',TestTone,f1,f2,N,amplitude,N_h,N_avg,fftSize,settle,options,num2str(fs),out_path); % the " are needed in case the paths contain spaces
+[status,output] = system (cmd);
+if status ~= 0
+	if exist (out_path,'file')
+		delete (out_path);
+	end
+	error (sprintf('mataa_measure_HD_sweep: TestTone failed (does your TestTone binary support the -H option?):\n%s',output));
+end
+
+% read the results (one line per tone, lines starting with % are comments):
+x = load ('-ascii',out_path);
+delete (out_path);
+if isempty (x)
+	error ('mataa_measure_HD_sweep: TestTone did not return any results.');
+end
+
+f0 = x(:,1);
+THD = x(:,3);
+THDN = x(:,4);
+t_settle = x(:,5);
+settled = x(:,6) > 0;
+HD = [ x(:,2) x(:,7:end) ];
+
+if any (~settled)
+	warning (sprintf('mataa_measure_HD_sweep: the DUT response did not settle within %g s at %i frequencies.',settle,sum(~settled)));
+end
+
+endfunction
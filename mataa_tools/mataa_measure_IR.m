@@ -8,7 +8,7 @@ function [h,t,unit] = mataa_measure_IR (test_signal,fs,N,latency,loopback,cal,un
 %
 % INPUT:
 % test_signal: test signal, vector of signal samples (can be a chirp, MLS, pink noise, Dirac, etc.).
-% N (optional): the impulse response is measured N times and the mean response is calculated from these measurements. N = 1 is used by default.
+% N (optional): the test signal is played N times back to back in a single audio stream, and the impulse response is calculated from the synchronous average of the recorded periods (see mataa_measure_signal_response). N = 1 is used by default.
 % latency: see mataa_measure_signal_response
 % loopback (optional): flag to control the behaviour of deconvolution of the DUT and REF channels. If loopback = 0, the DUT signal is not deconvolved from the REF signal (no loopback calibration). Otherwise, the DUT signal is deconvolved from the REF channel. The allocation of the DUT and REF channels is taken from mataa_settings('channel_DUT') and mataa_settings('channel_REF'). Default value (if not specified) is loopback = 0.
 % cal (optional): calibration data (struct or (cell-)string, see mataa_load_calibration and mataa_signal_calibrate)
@@ -70,61 +70,41 @@ if length (channels) == 2
 end
 
 
-for i = 1:N
-
-	% do the sound I/O	
-	if exist ('cal','var')
-		if exist ('unit','var')		
-			[out,in,t,out_unit,in_unit,X0_RMS] = mataa_measure_signal_response (test_signal,fs,latency,1,channels,cal,unit);
-		else
-			[out,in,t,out_unit,in_unit,X0_RMS] = mataa_measure_signal_response (test_signal,fs,latency,1,channels,cal);
-		end
-	else
-		[out,in,t,out_unit,in_unit,X0_RMS] = mataa_measure_signal_response (test_signal,fs,latency,1,channels);
-	end
-
-	% deconvolve in and out signals to yield h:
-	if exist ('OCTAVE_VERSION','builtin')
-		more ('off');
-	end
-		
-	l = length (in);
-	uu = flipud ([1:l]'/l);
-	
-	if ~loopback % no loopback calibration
-		disp ('Deconvolving data using raw test signal as reference (no loopback data available)...')
-		dut = out(:,1); dut_unit = out_unit{1};
-		ref = in; 	ref_unit = in_unit{1};
-
-	else % use loopback / REF data
-		disp ('Deconvolving data using loopback signal as reference...')
-		dut = out(:,1); dut_unit = out_unit{1};
-		ref = out(:,2);	ref_unit = out_unit{2};
-		
+% do the sound I/O (N periods of the test signal, averaged synchronously):
+has_cal = exist ('cal','var');
+if ~has_cal
+	for k = 1:length(channels)
+		cal{k} = [];
 	end
+end
+if ~exist ('unit','var')
+	unit = 'digital';
+end
+[out,in,t,out_unit,in_unit,X0_RMS] = mataa_measure_signal_response (test_signal,fs,latency,1,channels,cal,unit,N);
 
-	dut = [ dut ; uu*dut(end) ];	
-	ref = [ ref ; uu*ref(end) ];		
-	H = fft(dut) ./ fft(ref) ; % normalize by 'ref' signal
+if ~loopback % no loopback calibration
+	dut = out(:,1); dut_unit = out_unit{1};
+	ref = in; 	ref_unit = in_unit{1};
+else % use loopback / REF data
+	dut = out(:,1); dut_unit = out_unit{1};
+	ref = out(:,2);	ref_unit = out_unit{2};
+end
 
-	H(1) = 0; % remove DC
-	
-	dummy = ifft (H);	
-	dummy = dummy(1:l); % the other half is redundant since the signal is real
-	dummy = abs (dummy) .* sign (real(dummy)); % turn it back to the real-axis (complex part is much smaller than real part, so this works fine)
-	
-	disp ('...deconvolution done.');
-	
-	if i == 1
-		h = dummy / N;
-	else
-		h = h + dummy / N;
-	end
+% deconvolve in and out signals to yield h:
+if exist ('OCTAVE_VERSION','builtin')
+	more ('off');
+end
+if ~loopback
+	disp ('Deconvolving data using raw test signal as reference (no loopback data available)...')
+else
+	disp ('Deconvolving data using loopback signal as reference...')
 end
+h = mataa_deconvolve_IR (dut,ref,fs,'division');
+disp ('...deconvolution done.');
 
 if isna(X0_RMS)
 	warning ('mataa_measure_IR: DUT input voltage level is unknown, IR result is relative to DUT input signal level!')
-	if exist ('cal','var')
+	if has_cal
 		unit = sprintf ('%s/%s',dut_unit,ref_unit);
 	else
 		unit = '???';
@@ -132,7 +112,7 @@ if isna(X0_RMS)
 else
 	% remove normalisation to amplitude of DUT input signal due to deconvolution:
 	h = h * mean(X0_RMS);
-	if exist ('cal','var')
+	if has_cal
 		unit = sprintf ('%s',dut_unit);
 	else
 		unit = '???';
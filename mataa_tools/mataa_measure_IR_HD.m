@@ -5,6 +5,7 @@ function hi = mataa_measure_IR_HD (P, T, fs, N, tL, latency, cal, A, unit)
 % DESCRIPTION:
 % Measures the impulse response and the harmonic distortion products using the "Farina method". This uses an exponential sine sweep (chirp) as a test signal. The sweep of length T contains an integer number of octaves down from the Nyquist frequency. The impulse responses of the fundamental and harmonic distorion products are determined by convolving the DUT response with the inverse filter corresponding to the chirp signal. The magnitude spectrum ripple in the high-frequency extreme is minimized due to the sweep beginning and ending in phase zero. A Hanning fade-in is applied for the first octave, so the flat spectrum is (P - 1) octaves long. Similarly, a Hanning fade-out is applied to the last 1/24 octave to reduce the ripple even more.
 % The REF input channel is not used.
+% The analysis of the DUT response (overlap-save convolution with the inverse filter, separation of the harmonics) is done by mataa_deconvolve_IR_HD, which can also be used to analyse recorded data later on.
 %
 % REFERENCES:
 % A. Farina, “Simultaneous Measurement of Impulse Response and Distortion with a Swept-Sine Technique”, presented at 108th AES Convention, Paris, France, Feb. 19-22, 2000. Paper 5093. 
@@ -67,9 +68,6 @@ function hi = mataa_measure_IR_HD (P, T, fs, N, tL, latency, cal, A, unit)
 % Contact: info@audioroot.net
 % Further information: http://www.audioroot.net/MATAA
 
-warning ('mataa_measure_IR_HD: this function is under development and needs more testing. Please use with care!')
-
-
 % check input:
 if (P - fix(P)) ~= 0
   error('mataa_measure_IR_HD: P must be an integer');
@@ -99,25 +97,8 @@ if ~exist ('cal','var')
 	cal = [];
 end
 
-% Sweep Parameters
-Ns = round(fs * T);
-n = [0:Ns]';
-M = round(Ns / (log(2 ^ P) * (2 ^ (P + 1))));
-
 % Generate test signal (sweep):
-x = sin(2 .* pi .* M .* exp(n .* log(2 ^ P) ./ Ns));
-
-% 1 octave fade-in at beginning of test signal:
-fadeinlen = floor(Ns / P);
-window = flipud (mataa_signal_window (repmat(1,fadeinlen,1),'hann_half'));
-window = postpad(window, length(x), 1);
-x = x .* window;
-
-% 1/24 octave fade-out at end of test signal:
-fadeoutlen = floor(Ns / (24 * P));
-window = mataa_signal_window (repmat(1,fadeoutlen,1),'hann_half');
-window = prepad(window, length(x), 1);
-x = x .* window;
+[hi,x] = mataa_deconvolve_IR_HD ([],P,T,fs);
 
 % Measure sweep response:
 [responseSignal, inputSignal, t, unit] = mataa_measure_signal_response(A*x, fs, latency, 1, mataa_settings('channel_DUT'), cal, unit);
@@ -125,50 +106,5 @@ if iscell (unit)
 	unit = unit{1};
 end
 
-% Inverse filter
-invfilter = flipud(x) .* ((2 ^ (P / Ns)) .^ (-n)) .* (P * log(2)) ./ (1 - (2 ^ (-P)));
-L = length (responseSignal);
-invfilter = [ invfilter ; zeros(L-Ns-1,1) ]; % pad x with zeros to match the true length of the test signal (zero padding for latency)
-
-% Convolve the response with the inverse filter to get the IR and the harmonics:
-h = mataa_convolve (responseSignal,invfilter);
-h = real(h); % discard imaginary part
-h = (2 / Ns) * h; % scale the amplitude
-t = [0:length(h)-1]' ./ fs;
-
-% Find the start of main (fundamental) impulse response:
-k = round(length(h)*0.45);
-t0 = mataa_guess_IR_start(h(k:end),t(k:end));
-t = t-t0; % set pulse of fundamental to t = 0
-
-% Time shifts of harmonics:
-tN = 0; % fundamental is at t = 0
-if N > 1
-	tN = [ tN , round(fs * T) .* log([2:N]) ./ (fs * log(2 ^ P)) ];
-end
-
-% separate the fundamental and harmonics, convert to frequency domain:
-hi = [];
-for k = 1:N
-	if k == 1
-		[u.h,u.t] = mataa_signal_crop(h,t,0,tL); % extract the fundamental
-	else
-		L = min ( tL/k , 0.9*(tN(k)-tN(k-1)) );
-		[u.h,u.t] = mataa_signal_crop(h,t,-tN(k),-tN(k)+L); % extract the k-th harmonic
-	end
-	u.h_unit = unit;
-
-	[u.mag,u.phase,u.f,u.mag_unit] = mataa_IR_to_FR (u.h,u.t,[],u.h_unit); % convert to frequency domain
-	u.f = u.f / k;
-	kNyq = find (u.f < fs/2);
-	u.mag = u.mag(kNyq);
-	u.phase = u.phase(kNyq);
-	u.f = u.f(kNyq);
-	if k > 1
-		ref = interp1 (hi(1).f,hi(1).mag,u.f);
-		u.percent = 10.^((u.mag - ref)/20) * 100; % difference relative to fundamental, in percent
-	else
-		u.percent = repmat (100,size(u.f)); % set fundamental to 100%
-	end
-	hi = [ hi u ];
-end
+% Determine the impulse responses of the fundamental and the harmonics, and convert them to frequency domain:
+hi = mataa_deconvolve_IR_HD (responseSignal,P,T,fs,N,tL,unit);
@@ -19,6 +19,8 @@ function [Zmag,Zphase,f] = mataa_measure_impedance (fLow,fHigh,R,fs,resolution,c
 %
 % Note that the current flowing through the reference resistor R is identical to the current flowing through the DUT at all times. This allows calculating the impedance of the DUT using Ohm's Law with the voltages observed at the ADC inputs of the REF and DUT channels. 
 %
+% See mataa_measure_impedance_TF for a measurement with continuous noise excitation, which estimates the coherence of the data and stops as soon as the coherence is good enough.
+%
 % INPUT:
 % fLow: lower limit of the frequency range (Hz)
 % fHigh: upper limit of the frequency range (Hz)
@@ -0,0 +1,270 @@
+function [Zmag,Zphase,f,coh,N] = mataa_measure_impedance_TF (fLow,fHigh,R,fs,resolution,coh_target,T_max,fftSize,amplitude,estimator,live);
+
+% function [Zmag,Zphase,f,coh,N] = mataa_measure_impedance_TF (fLow,fHigh,R,fs,resolution,coh_target,T_max,fftSize,amplitude,estimator,live);
+%
+% DESCRIPTION:
+% This function measures the complex, frequency-dependent impedance Z(f) of a DUT using continuous noise excitation and a dual-channel FFT transfer-function estimate. The set up is the same as for mataa_measure_impedance (reference resistor R in series with the DUT, REF channel across R and DUT, DUT channel across the DUT only). The noise is played on the DAC channel given by mataa_settings('channel_DAC').
+%
+% Pink noise is played in a loop by TestTone, which runs as a transfer-function analyser (TestTone -R base -T, see TestTonePA19.c and ttTransfer.h; not available on Windows). TestTone averages the auto and cross spectra of overlapping Hann-windowed FFTs of the REF and DUT channels as the data arrive (Welch method), and publishes the H1 and H2 estimates of the transfer function H = U_DUT / U_REF and the coherence several times per second. The impedance is then Z = R * H / (1 - H). The measurement stops as soon as the coherence in the frequency range fLow...fHigh reaches the target value (or after T_max seconds), so a clean measurement is finished after a few averages, while a noisy one automatically takes longer. If 'live' is set, Z(f) and the coherence are plotted while the estimates converge, and the measurement can also be stopped by closing the plot window.
+%
+% INPUT:
+% fLow: lower limit of the frequency range (Hz)
+% fHigh: upper limit of the frequency range (Hz)
+% R: resistance of the reference resistor (Ohm)
+% fs: sampling frequency to be used for sound I/O (Hz)
+% resolution (optional): frequency resolution in octaves used to smooth the result (see mataa_measure_impedance). Default: resolution = 1/48. If you want no smoothing at all, use resolution = 0.
+% coh_target (optional): target value of the coherence (0...1). The measurement stops as soon as at least 95% of the frequency bins between fLow and fHigh reach coh_target (after at least 8 averaged FFTs). Default: coh_target = 0.99.
+% T_max (optional): maximum duration of the measurement in seconds (default: T_max = 30). If the coherence target is not reached within T_max, a warning is given and the result obtained so far is returned.
+% fftSize (optional): FFT size (power of two). Default: smallest power of two with a frequency resolution of fLow/4 or better (at least 4096).
+% amplitude (optional): peak amplitude of the noise signal (digital units, default: amplitude = 0.5)
+% estimator (optional): transfer-function estimator, 'H1' (default, not biased by noise in the DUT channel) or 'H2' (not biased by noise in the REF channel).
+% live (optional): plot Z(f) and the coherence while measuring (default: live = 1)
+%
+% OUTPUT:
+% Zmag: impedance magnitude (Ohm)
+% Zphase: impedance phase (degrees)
+% f: vector of frequency values
+% coh: coherence at frequencies f (interpolated to the frequencies of the smoothed data if resolution > 0)
+% N: number of averaged FFTs
+%
+% EXAMPLE (10 Hz to 20 kHz, reference resistor R = 8.0 Ohm):
+% > [Zmag,Zphase,f,coh] = mataa_measure_impedance_TF (10,20000,8.0,48000);
+% > subplot (2,1,1); semilogx (f,Zmag); ylabel ('Impedance (Ohm)')
+% > subplot (2,1,2); semilogx (f,coh); xlabel ('Frequency (Hz)'); ylabel ('Coherence')
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('resolution','var')
+	resolution = [];
+end
+if isempty (resolution)
+	resolution = 1/48;
+end
+if ~exist ('coh_target','var')
+	coh_target = 0.99;
+end
+if ~exist ('T_max','var')
+	T_max = 30;
+end
+if ~exist ('fftSize','var')
+	fftSize = [];
+end
+if isempty (fftSize)
+	fftSize = max (4096,2^ceil(log2(4*fs/fLow)));
+end
+if ~exist ('amplitude','var')
+	amplitude = 0.5;
+end
+if ~exist ('estimator','var')
+	estimator = 'H1';
+end
+if ~exist ('live','var')
+	live = 1;
+end
+
+N_min = 8; % minimum number of averaged FFTs before the coherence is used
+
+if strcmp (mataa_computer,'PCWIN')
+	error ('mataa_measure_impedance_TF: the TestTone transfer-function analyser is not available on Windows.');
+end
+if amplitude <= 0 || amplitude > 1
+	error ('mataa_measure_impedance_TF: amplitude must be larger than 0 and not larger than 1 (digital units).');
+end
+if ~any (strcmp (upper(estimator),{'H1','H2'}))
+	error (sprintf('mataa_measure_impedance_TF: unknown estimator ''%s'' (use ''H1'' or ''H2'').',estimator));
+end
+
+% the audio device must not be blocked by the TestTone server:
+mataa_TestTone_server ('stop');
+
+% excitation: pink noise, played in a loop by TestTone (a few seconds, so that consecutive FFTs see different noise):
+s = mataa_signal_generator ('pink',fs,max(4,8*fftSize/fs));
+s = s - mean (s);
+s = amplitude * s / max (abs(s));
+in_path = mataa_signal_to_TestToneFile (s,'',0,fs,'binary');
+
+% start the analyser (reference channel first, then the DUT channel):
+base = sprintf ('%s%smataa_impedance_TF_%s',tempdir,filesep,getenv('USER'));
+tfe_path = [ base '.tfe' ];
+pid_path = [ base '.pid' ];
+__delete_if_exists (tfe_path);
+__delete_if_exists (pid_path);
+TestTone = sprintf ('%s%s',mataa_path('TestTone'),'TestTonePA19');
+out_channel = mataa_settings ('channel_DAC');
+if isempty(out_channel) % settings don't have the channel_DAC field
+	mataa_settings ('channel_DAC',1); % set and store default
+	out_channel = 1;
+end
+options = mataa_TestTone_stream_options ([mataa_settings('channel_REF') mataa_settings('channel_DUT')],out_channel);
+system (sprintf('"%s" -R "%s" -T %s-F %i -V 0.5 -u 0.1 %s "%s" > /dev/null 2>&1 &',TestTone,base,options,fftSize,num2str(fs),in_path)); % the " are needed in case the paths contain spaces
+k = 0;
+while ~exist (pid_path,'file') && k < 100
+	pause (0.05); k = k+1;
+end
+pid = [];
+fid = fopen (pid_path,'rt');
+if fid ~= -1
+	pid = fscanf (fid,'%f',1);
+	fclose (fid);
+end
+if isempty (pid)
+	delete (in_path);
+	error ('mataa_measure_impedance_TF: could not start the TestTone transfer-function analyser (does your TestTone binary support the -T option?).');
+end
+
+% frequency values and interchannel delay correction:
+f = [1:fftSize/2]' * fs / fftSize; % without DC
+band = find (f >= fLow & f <= fHigh);
+delay = mataa_settings ('interchannel_delay');
+delay_correction = exp (-1i*2*pi*f*delay); % remove the excess phase in the DUT channel due to interchannel delay
+
+if live
+	fig = figure;
+	ax1 = subplot (2,1,1);
+	set (ax1,'box','on','xscale','log','xlim',[fLow fHigh]);
+	ylabel ('Impedance (Ohm)');
+	lineZ = line ('XData',f(band),'YData',repmat(R,size(band)));
+	ax2 = subplot (2,1,2);
+	set (ax2,'box','on','xscale','log','xlim',[fLow fHigh],'ylim',[0 1]);
+	xlabel ('Frequency (Hz)'); ylabel ('Coherence');
+	lineC = line ('XData',f(band),'YData',zeros(size(band)));
+	line ('XData',[fLow fHigh],'YData',[coh_target coh_target],'LineStyle',':');
+	drawnow;
+end
+
+% wait until the coherence target is met:
+H = []; coh = []; N = 0; info = [];
+done = 0;
+t_start = time;
+while ~done
+	[H1,H2,c,u] = __read_tfe (tfe_path);
+	if ~isempty (c) && u.numSpectra ~= N % new estimate
+		N = u.numSpectra;
+		info = u;
+		if strcmp (upper(estimator),'H2')
+			H = H2(2:end);
+		else
+			H = H1(2:end);
+		end
+		H = H .* delay_correction;
+		coh = c(2:end);
+		good = mean (coh(band) >= coh_target);
+		if live && ishandle (fig)
+			set (lineZ,'YData',abs (R * H(band) ./ (1 - H(band))));
+			set (lineC,'YData',coh(band));
+			title (ax1,sprintf('Average of %i FFTs (t = %.1f s), coherence target met at %.0f%% of the frequencies',N,u.time,100*good));
+		end
+		if N >= N_min && good >= 0.95
+			done = 1;
+		end
+	end
+	if time - t_start > T_max
+		if N >= N_min
+			warning (sprintf('mataa_measure_impedance_TF: coherence target not reached within %g s.',T_max));
+		end
+		done = 1;
+	end
+	if live
+		if ~ishandle (fig) % stopped by the user
+			done = 1;
+		else
+			drawnow;
+		end
+	end
+	pause (0.05);
+end
+
+% stop the analyser:
+kill (pid,15); % SIGTERM
+k = 0;
+while exist (pid_path,'file') && k < 50
+	pause (0.1); k = k+1;
+end
+__delete_if_exists (tfe_path);
+delete (in_path);
+
+if isempty (H)
+	error ('mataa_measure_impedance_TF: TestTone did not return any transfer-function estimate.');
+end
+if info.dropped
+	warning ('mataa_measure_impedance_TF: recorded samples were lost during the measurement.');
+end
+
+% calculate impedance using Ohm's Law (see mataa_measure_impedance):
+Z = R * H ./ (1 - H);
+
+% remove data outside frequency range:
+f = f(band);
+Z = Z(band);
+coh = coh(band);
+
+Zmag = abs(Z);
+Zphase = angle(Z)/pi*180;
+
+if resolution > 0 % smooth data:
+	[Zmag,Zphase,f_smooth] = mataa_FR_smooth (Zmag,Zphase,f,resolution);
+	coh = interp1 (f,coh,f_smooth);
+	f = f_smooth;
+end
+
+endfunction
+
+
+function [H1,H2,coh,info] = __read_tfe (path)
+	% read the transfer-function file written by TestTone -R -T (format see ttTransfer.h)
+	H1 = []; H2 = []; coh = []; info = [];
+	fid = fopen (path,'rb','native');
+	if fid == -1 % not written yet
+		return
+	end
+	magic = char (fread(fid,8,'char')');
+	if ~strcmp (magic,'MATAATFE')
+		fclose (fid);
+		return
+	end
+	headerSize      = fread (fid,1,'uint32');
+	nv              = fread (fid,1,'uint32');
+	nb              = fread (fid,1,'uint64');
+	info.fs         = fread (fid,1,'float64');
+	info.fftSize    = fread (fid,1,'uint32');
+	info.hop        = fread (fid,1,'uint32');
+	info.numSpectra = fread (fid,1,'uint64');
+	info.dropped    = fread (fid,1,'uint32');
+	fread (fid,1,'uint32'); % reserved
+	info.time       = fread (fid,1,'float64');
+	fseek (fid,headerSize,'bof');
+	x = fread (fid,[nv,nb],'float32=>double')';
+	fclose (fid);
+	if size (x,1) < nb
+		return
+	end
+	H1 = complex (x(:,1),x(:,2));
+	H2 = complex (x(:,3),x(:,4));
+	coh = x(:,5);
+endfunction
+
+
+function __delete_if_exists (f)
+	if exist (f,'file')
+		delete (f);
+	end
+endfunction
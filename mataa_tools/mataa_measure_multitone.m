@@ -0,0 +1,112 @@
+function [R,L,f,unit] = mataa_measure_multitone (fi,T,fs,N_h,latency,cal,amplitude,unit,N_avg,odd_bins);
+
+% function [R,L,f,unit] = mataa_measure_multitone (fi,T,fs,N_h,latency,cal,amplitude,unit,N_avg,odd_bins);
+%
+% DESCRIPTION:
+% Measures the harmonic and intermodulation distortion of a DUT at many frequencies at once using a multitone test signal (see mataa_signal_multitone). The tone frequencies are adjusted to the FFT bins of one signal period, and the tone phases are optimised for a low crest factor. N_avg+1 periods of the multitone signal are played back to back in a single audio stream. The first period is discarded (settling of the DUT), and the remaining N_avg periods are located in the recorded data by cross-correlation with the test signal and analysed with mataa_multitone_analysis (single FFT of all periods, averaging of the spectra, noise estimate from the variability of the periods).
+%
+% Compared to a series of sine measurements (see mataa_measure_sine_distortion and mataa_measure_HD_noise), this gives the distortion at all tone frequencies from a single measurement. Note that the distortion of a DUT driven by a multitone signal is not the same as with a single sine at the same RMS level, because all tones contribute to the intermodulation products.
+%
+% INPUT:
+% fi: frequencies of the tones (Hz). The frequencies are adjusted to integer multiples of 1/T (see mataa_signal_multitone).
+% T: length of one period of the multitone signal in seconds (frequency resolution 1/T).
+% fs: sampling frequency in Hz
+% N_h (optional): highest harmonic analysed (default: N_h = 5)
+% latency (optional): see mataa_measure_signal_response (default: latency = [])
+% cal (optional): calibration data for data calibration (see mataa_signal_calibrate for details).
+% amplitude and unit (optional): amplitude (zero-to-peak value of the multitone signal) and unit of test signal at DUT input (see mataa_measure_signal_response). Default: amplitude = 1, unit = 'digital'
+% N_avg (optional): number of periods used for the analysis (integer, default: N_avg = 4).
+% odd_bins (optional): adjust the tones to odd FFT bins only, so that even-order distortion products fall between the tones (see mataa_signal_multitone, default: odd_bins = 1).
+%
+% OUTPUT:
+% R: results for each tone (fundamental, harmonics, THD, IMD, noise), see mataa_multitone_analysis. In addition, R.crest is the crest factor of the test signal.
+% L: averaged spectrum of the DUT output signal at frequency values f. L(:,1) = amplitudes (zero-to-peak), L(:,2) = phase angles (radian), L(:,3) = noise amplitude
+% f: frequency values of spectrum (Hz).
+% unit: unit of data in L (and R.A and R.HD).
+%
+% EXAMPLE (1/3-octave tones from 20 Hz to 20 kHz, 1 s periods, 1 V-pk test signal):
+% > fi = 20 * 2.^([0:30]/3);
+% > [R,L,f,unit] = mataa_measure_multitone (fi,1,44100,5,0.2,'GENERIC_CHAIN_DIRECT.txt',1.0,'V');
+% > semilogx (R.f,20*log10([R.THD R.IMD R.noise])); xlabel ('Frequency (Hz)'); ylabel ('Level rel. fundamental (dB)'); legend ('THD','IMD','Noise')
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('N_h','var')
+	N_h = 5;
+end
+if ~exist('latency','var')
+	latency = []; % use default value (best guess)
+end
+if ~exist('cal','var')
+	cal=[];
+end
+if ~exist('amplitude','var')
+	amplitude = 1; % use default value
+end
+if ~exist('unit','var')
+	unit = 'digital';
+end
+if ~exist ('N_avg','var')
+	N_avg = 4;
+end
+if ~exist ('odd_bins','var')
+	odd_bins = 1;
+end
+
+% one period of the test signal:
+[s,t,fi,k,crest] = mataa_signal_multitone (fi,fs,T,odd_bins);
+N = length (s);
+s = s * amplitude;
+
+% do sound I/O (N_avg+1 periods in one continuous signal):
+x = repmat (s,N_avg+1,1);
+[y,in,t,unit] = mataa_measure_signal_response (x,fs,latency,1,mataa_settings('channel_DUT'),cal,unit);
+if iscellstr(unit)
+	unit = unit{1};
+end
+y = y(:,1);
+in = in(:,1);
+
+% find the start of the test signal in the recorded data:
+i0 = (length(in) - length(x)) / 2; % length of the zero padding
+d = __delay (y,in);
+i1 = d + i0 + N; % start of the second period
+if i1 + N_avg*N > length (y)
+	error (sprintf('mataa_measure_multitone: the recorded data do not contain all periods of the test signal (delay = %g s). Try a longer latency.',d/fs));
+end
+
+% analyse the periods:
+y = reshape (y(i1+1:i1+N_avg*N),N,N_avg);
+[R,L,f] = mataa_multitone_analysis (y,fs,k,N_h);
+R.crest = crest;
+
+endfunction
+
+
+function d = __delay (y,x)
+	% delay of y relative to x (samples), from the maximum of the cross correlation (only positive delays, i.e. y lagging x)
+	n = length (y);
+	nfft = mataa_fft_length (n + length(x));
+	c = real (ifft (fft(y,nfft) .* conj(fft(x,nfft))));
+	[m,d] = max (abs(c(1:n))); % abs: DUT may invert the signal
+	d = d - 1;
+endfunction
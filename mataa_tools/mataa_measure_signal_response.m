@@ -1,6 +1,6 @@
-function [dut_out,dut_in,t,dut_out_unit,dut_in_unit,X0_RMS] = mataa_measure_signal_response (X0,fs,latency,verbose,channels,cal,X0_unit);
+function [dut_out,dut_in,t,dut_out_unit,dut_in_unit,X0_RMS,noise] = mataa_measure_signal_response (X0,fs,latency,verbose,channels,cal,X0_unit,N_avg);
 
-% function [dut_out,dut_in,t,dut_out_unit,dut_in_unit] = mataa_measure_signal_response (X0,fs,latency,verbose,channels,cal,X0_unit);
+% function [dut_out,dut_in,t,dut_out_unit,dut_in_unit,X0_RMS,noise] = mataa_measure_signal_response (X0,fs,latency,verbose,channels,cal,X0_unit,N_avg);
 %
 % DESCRIPTION:
 % This function feeds one or more test signal(s) to the DUT(s) and records the response signal(s).
@@ -16,6 +16,7 @@ function [dut_out,dut_in,t,dut_out_unit,dut_in_unit,X0_RMS] = mataa_measure_sign
 % X0_unit (optional): unit of test signal data in X0 (string):
 %	If unit = 'digital' (default): X0 signal is given in digital domain. The X0 values are sent to the DAC without any amplitude conversion. X0 values are allowed to range from -1 to +1, corresponding to the min. and max. value of the analog signal at the DAC output.
 %	If unit = unit of the sensitivity value specified in the cal data for the DAC analog output signal (e.g., unit = 'V': X0 signal is given in the physical units of the ; X0 reflects the signal voltage that is generated at the DAC output. The X0 voltages are converted to "digital domain values" using the DAC sensitivity given in the 'cal' data before the data is sent the DAC. X0 values are allowed to range from the min. to max. voltages that can be generated by the DAC output.
+% N_avg (optional): number of synchronous averages (integer, default: N_avg = 1). If N_avg > 1, the test signal (including the zero padding) is played N_avg times back to back in a single audio stream, and the recorded periods are averaged sample by sample. This reduces the noise in the recorded data by a factor of sqrt(N_avg) without the overhead of starting a new measurement for every repetition. Note that the zero padding must be long enough for the DUT response to decay before the next period starts. With binary data exchange with TestTone (see mataa_settings 'audio_TestTone_binary' and 'audio_TestTone_server'), the averaging is done by TestTone, which returns the averaged period only.
 % 
 % OUTPUT:
 % dut_out: matrix containing the signal(s) at the DUT output(s) / SENSOR input(s) (all channels used for signal recording, each colum corresponds to one channel). If SENSOR and ADC cal data are available, these data are calibrated for the input sensitivity of the SENSOR and ADC.
@@ -24,6 +25,7 @@ function [dut_out,dut_in,t,dut_out_unit,dut_in_unit,X0_RMS] = mataa_measure_sign
 % dut_out_unit: unit of data in dut_out. If the signal has more than one channel, signal_unit is a cell string with each cell reflecting the units of each signal channel.
 % dut_in_unit: unit of data in dut_in (analogous to dut_out_unit)
 % X0_RMS: RMS amplitude of signal at DUT input / DAC(+BUFFER) output (same unit as dut_in data). This may be different from the RMS amplitude of dut_in due to the zero-padding of dut_in in order to accomodate for the latency of the analysis system; the X0_RMS value is determined from the test signal before zero padding.
+% noise: RMS noise of a single period in each channel of dut_out, estimated from the differences between the averaged periods (row vector, raw ADC data without calibration). The noise in the averaged data is noise/sqrt(N_avg). If N_avg = 1, noise = [].
 %
 %
 % NOTES:
@@ -113,6 +115,16 @@ if ~exist('verbose','var')
     verbose=1;
 end
 
+if ~exist('N_avg','var')
+	N_avg = 1;
+end
+if isempty(N_avg)
+	N_avg = 1;
+end
+if N_avg < 1 || N_avg ~= round(N_avg)
+	error(sprintf('mataa_measure_signal_response: number of averages must be a positive integer: N_avg = %g',N_avg))
+end
+
 % check computer platform:
 try
 	audio_IO_method = mataa_settings ('audio_IO_method');
@@ -202,6 +214,10 @@ while do_try_audio_IO
 
 	% assume this will be the last attempt (this may change later)
 	do_try_audio_IO = false;
+
+	% init flag for "recorded periods are averaged already":
+	is_averaged = (N_avg == 1);
+	noise = [];
 	
 	% init flag for "DAC output cal is okay":
 	cal_dac_out_ok = false;
@@ -263,6 +279,21 @@ while do_try_audio_IO
 
 		% determine latency:
 		default_latency = 0.1 * max([1 fs/44100]); % just from experience with Behringer UMC202HD and M-AUDIO FW-410
+		TestTone_trim = 0;
+		if any(strcmp(upper(audio_IO_method),{'TESTTONE','TESTTONEOCT'}))
+			% trim the recorded data to the test signal (TestTone removes the round-trip delay of the audio hardware, requires binary data exchange with TestTone):
+			TestTone_trim = mataa_settings ('audio_TestTone_trim');
+			if isempty(TestTone_trim) % settings don't have the audio_TestTone_trim field
+				mataa_settings ('audio_TestTone_trim',0); % set and store default
+				TestTone_trim = 0;
+			end
+			if strcmp(upper(audio_IO_method),'TESTTONE') && ~any ([ mataa_settings('audio_TestTone_binary') mataa_settings('audio_TestTone_server') ])
+				TestTone_trim = 0;
+			end
+		end
+		if TestTone_trim
+			default_latency = 0.02; % TestTone extends the recording by the measured round-trip delay, so the zero padding only needs to cover the decay of the DUT response (without trimming, the generic default is kept, because the stream latency reported by PortAudio excludes converter and transport delays)
+		end
 		if ~exist('latency','var')
 			latency = [];
 		end
@@ -277,10 +308,64 @@ while do_try_audio_IO
 
 			deleteInputFileAfterIO = 0;
 
+			% use binary data exchange with TestTone (much faster than text files for long signals, but requires a TestTone binary that supports the -b option):
+			TestTone_binary = mataa_settings ('audio_TestTone_binary');
+			if isempty(TestTone_binary) % settings don't have the audio_TestTone_binary field
+				mataa_settings ('audio_TestTone_binary',0); % set and store default
+				TestTone_binary = 0;
+			end
+			% use the TestTone server (keeps the audio stream open in between measurements):
+			TestTone_server = mataa_settings ('audio_TestTone_server');
+			if isempty(TestTone_server) % settings don't have the audio_TestTone_server field
+				mataa_settings ('audio_TestTone_server',0); % set and store default
+				TestTone_server = 0;
+			end
+			if TestTone_server
+				TestTone_binary = 1; % the server always writes binary data
+			end
+			if TestTone_binary
+				TestTone_format = 'binary';
+				TestTone_options = '-b ';
+
+				% audio stream options (these require a TestTone binary that supports the -b option, too):
+				TestTone_stream_options = mataa_TestTone_stream_options (channels); % record only the ADC channels given in channels
+				u = mataa_settings ('audio_TestTone_clipabort');
+				if isempty(u) % settings don't have the audio_TestTone_clipabort field
+					mataa_settings ('audio_TestTone_clipabort',0); % set and store default
+					u = 0;
+				end
+				if u
+					TestTone_stream_options = sprintf('%s-x ',TestTone_stream_options);
+				end
+				if TestTone_trim
+					TestTone_stream_options = sprintf('%s-t ',TestTone_stream_options);
+					u = mataa_settings ('audio_TestTone_loopback');
+					if isempty(u) % settings don't have the audio_TestTone_loopback field
+						mataa_settings ('audio_TestTone_loopback',0); % set and store default
+						u = 0;
+					end
+					if u > 0
+						TestTone_stream_options = sprintf('%s-L %i ',TestTone_stream_options,u);
+					end
+				end
+				TestTone_options = [ TestTone_options TestTone_stream_options ];
+				if N_avg > 1 % let TestTone do the averaging (this is not a stream option, the server gets N_avg with each request)
+					TestTone_options = sprintf('%s-A %i ',TestTone_options,N_avg);
+				end
+			else
+				TestTone_format = 'text';
+				TestTone_options = '';
+			end
+
 			if verbose
 				disp('Writing sound data to disk...');
 			end
-			in_path = mataa_signal_to_TestToneFile(X0,'',latency,fs);
+			if N_avg > 1 && ~TestTone_binary % play N_avg periods of the test signal and its zero padding back to back, average the recorded periods below
+				z = repmat(0,round(latency*fs),size(X0,2));
+				in_path = mataa_signal_to_TestToneFile(repmat([ z ; X0 ; z ],N_avg,1),'',0,fs,TestTone_format);
+			else
+				in_path = mataa_signal_to_TestToneFile(X0,'',latency,fs,TestTone_format);
+			end
 			if verbose
 				disp('...done');
 			end
@@ -309,15 +394,19 @@ while do_try_audio_IO
 			end
 			TestTone = sprintf('%s%s%s',mataa_path('TestTone'),'TestTonePA19',extension);
 			
-			if strcmp(plat,'PCWIN')
-				command = sprintf('"%s" %s %s > %s',TestTone,num2str(fs),in_path,out_path); % the ' are needed in case the paths contain spaces
+			if TestTone_server
+				mataa_TestTone_server ('play',fs,in_path,out_path,strtrim(TestTone_stream_options),N_avg);
 			else
-				command = sprintf('"%s" %s %s > %s 2>/dev/null',TestTone,num2str(fs),in_path,out_path); % the ' are needed in case the paths contain spaces
-			end
-			[output,status] = system(command);
+				if strcmp(plat,'PCWIN')
+					command = sprintf('"%s" %s%s %s > %s',TestTone,TestTone_options,num2str(fs),in_path,out_path); % the ' are needed in case the paths contain spaces
+				else
+					command = sprintf('"%s" %s%s %s > %s 2>/dev/null',TestTone,TestTone_options,num2str(fs),in_path,out_path); % the ' are needed in case the paths contain spaces
+				end
+				[output,status] = system(command);
 
-			if status ~= 0
-				error('mataa_measure_signal_response: an error has occurred during sound I/O.')
+				if status ~= 0
+					error('mataa_measure_signal_response: an error has occurred during sound I/O.')
+				end
 			end
 
 			if verbose
@@ -325,61 +414,43 @@ while do_try_audio_IO
 				disp('Reading sound data from disk...')
 			end
 
+			[dut_out,t,fs_out,TestTone_info] = mataa_TestToneFile_to_signal(out_path);
+			TestTone_stream_latency = TestTone_info.inputLatency + TestTone_info.outputLatency;
 
-			fid = fopen(out_path,'rt');
-			if fid == -1
-				error('mataa_measure_signal_response: could not find input file.');
-			else
-				frewind(fid);
-				numChan = [];
-				doRead = 1;
-				while doRead % read the header
-					l = fgetl(fid);
-					if isempty(l)
-						error('mataa_measure_signal_response: found empty line in header, cannot continue.')
-					end
-					if l==-1
-						error('mataa_measure_signal_response: end of data file reached prematurely! Is the data file corrupted?');
-					end
-					if strfind(upper(l),'ERROR')
-						error(sprintf('mataa_measure_signal_response: %s',l));
-					end
-					if strfind(l,'Number of sound input channels =')
-						numChan = str2num(l(strfind(l,'=')+1:end));
-						elseif strfind(l,'time (s)') % this was the last line of the header
-						doRead = 0;
-					elseif ~isempty(str2num(l));
-						% this is the first line of the data block
-						doRead = 0;
-						fseek(fid,ftell(fid)-length(l)-1); % go back to the end of the previous line so that we won't miss the first line of the data later on
+			if verbose
+				disp('...data reading done.');
+				if TestTone_stream_latency > 0
+					disp(sprintf('Audio stream latency: %g s (input) + %g s (output)',TestTone_info.inputLatency,TestTone_info.outputLatency));
+				end
+				if TestTone_info.delay > 0
+					if TestTone_trim
+						disp(sprintf('Round-trip delay: %g s (removed from recorded data)',TestTone_info.delay));
+					else
+						disp(sprintf('Round-trip delay: %g s',TestTone_info.delay));
 					end
-				end % while doRead
-				
-				if isempty(numChan)
-					error('mataa_measure_signal_response: could not determine number of channels in recorded data.');
 				end
-				
-				% read the data:
-				out = fscanf(fid,'%f');
-				l = length(out);
-				if l < 1
-					error('mataa_measure_signal_response: no data found in TestTone output file.');
+				if TestTone_info.numAverages > 1
+					disp(sprintf('Number of averaged periods: %i',TestTone_info.numAverages));
 				end
-				out = reshape(out',numChan+1,l/(numChan+1))';
-				fclose(fid);
-				clear numChan % avoid confusion with numChan below
 			end
-
-			if verbose
-				disp('...data reading done.');
+			if TestTone_binary && N_avg > 1
+				is_averaged = true;
+				noise = TestTone_info.noise;
 			end
 
-			t=out(:,1);dut_out=out(:,2:end);
-
-			% keep only ADC channels as given in channels, discard the rest:
-			dut_out = dut_out(:,channels);
+			if ~TestTone_binary
+				% keep only ADC channels as given in channels, discard the rest (in binary mode, TestTone records the ADC channels given in channels only):
+				dut_out = dut_out(:,channels);
+			end
 
-			dut_in=load(in_path); % octave can easily read 1-row ASCII files
+			if TestTone_binary
+				dut_in = mataa_TestToneFile_to_signal(in_path);
+			else
+				dut_in=load(in_path); % octave can easily read 1-row ASCII files
+				if N_avg > 1
+					dut_in = dut_in(1:round(size(dut_in,1)/N_avg),:);
+				end
+			end
 			
 			% clean up:
 			delete(out_path);
@@ -387,6 +458,49 @@ while do_try_audio_IO
 			    delete(in_path);
 			end
 
+		elseif strcmp(upper(audio_IO_method),'TESTTONEOCT')
+
+			% play and record directly from / to Octave matrices with the TestToneOct module (no temporary files, no external process):
+			if exist ('TestToneOct') ~= 3
+				addpath (mataa_path('TestTone')); % TestToneOct.oct lives with the TestTone binaries
+				if exist ('TestToneOct') ~= 3
+					error ('mataa_measure_signal_response: could not find the TestToneOct module. Please compile it (see TestTone/source/README.txt) or use another audio I/O method.')
+				end
+			end
+			opts.input_channels = channels;
+			opts.input_device = mataa_settings ('audio_TestTone_InputDevice');
+			opts.output_device = mataa_settings ('audio_TestTone_OutputDevice');
+			opts.frames_per_buffer = mataa_settings ('audio_TestTone_FramesPerBuffer');
+			u = mataa_settings ('audio_TestTone_SuggestedLatency');
+			if u > 0
+				opts.latency = u;
+			end
+			opts.trim = TestTone_trim;
+
+			% zeroes for latency, N_avg periods back to back (averaged below):
+			z = repmat(0,round(latency*fs),size(X0,2));
+			dut_in = [ z ; X0 ; z ];
+
+			if verbose
+				disp('Sound input / output started...');
+				disp(sprintf('Sound output device: %s',audioInfo.output.name));
+				disp(sprintf('Sound input device: %s',audioInfo.input.name));
+				disp(sprintf('Sampling rate: %.3f samples per second',fs));
+			end
+			[dut_out,TestTone_info] = TestToneOct (single(repmat(dut_in,N_avg,1)),fs,opts);
+			dut_out = double (dut_out);
+			t = [0:size(dut_out,1)-1]' / fs;
+			TestTone_stream_latency = TestTone_info.inputLatency + TestTone_info.outputLatency;
+			if verbose
+				disp('...sound I/O done.');
+				disp(sprintf('Audio stream latency: %g s (input) + %g s (output)',TestTone_info.inputLatency,TestTone_info.outputLatency));
+				if TestTone_trim
+					disp(sprintf('Round-trip delay: %g s (removed from recorded data)',TestTone_info.delay));
+				else
+					disp(sprintf('Round-trip delay: %g s',TestTone_info.delay));
+				end
+			end
+
 		elseif strcmp(upper(audio_IO_method),'PLAYREC')
 			
 			% make sure PlayRec is initialised as needed:
@@ -406,8 +520,8 @@ while do_try_audio_IO
 			z = repmat(0,round(latency*fs),size(X0,2));
 			dut_in = [ z ; X0 ; z ];
 			
-			% Start audio input / output (with zero padding for latency):
-			pageNumber = playrec('playrec', dut_in, 1:max(channels), -1, channels );
+			% Start audio input / output (with zero padding for latency, N_avg periods back to back):
+			pageNumber = playrec('playrec', repmat(dut_in,N_avg,1), 1:max(channels), -1, channels );
 			
 			% Wait until audio input / output is done:
 			%%% while ( playrec('isFinished', pageNumber) == 0 ); end; % this will run the CPU at full power!
@@ -425,17 +539,55 @@ while do_try_audio_IO
 		else
 			error (sprintf('mataa_measure_signal_response: unknown audio I/O method <%s>.',audio_IO_method))
 
-		end % audio_IO_method = TESTTONE or PlayRec
+		end % audio_IO_method = TESTTONE, TESTTONEOCT or PlayRec
 
-		if verbose
+		if ~is_averaged
+			% average the recorded periods:
+			n = round(size(dut_out,1)/N_avg);
+			u = reshape(dut_out(1:n*N_avg,:),n,N_avg,size(dut_out,2));
+			dut_out = reshape(mean(u,2),n,size(dut_out,2));
+			noise = sqrt(sum(sum((u-repmat(reshape(dut_out,n,1,size(dut_out,2)),1,N_avg,1)).^2,1),2)/(n*(N_avg-1)));
+			noise = noise(:)';
+			t = [0:n-1]' / fs;
+		end
+
+		% level statistics of the raw recorded data determined by TestTone while recording. Only used with binary data exchange, where TestTone records the ADC channels given in channels only (with text data exchange, the statistics are for all ADC channels and all recorded periods):
+		TestTone_levels = exist('TestTone_binary','var') && TestTone_binary && exist('TestTone_info','var') && isfield(TestTone_info,'peak') && ~isempty(TestTone_info.peak);
+
+		if exist('TestTone_info','var') && isfield(TestTone_info,'aborted') && TestTone_info.aborted
+			beep
+			u = find(TestTone_info.clipped > 0,1); % column of the level statistics
+			if TestTone_levels
+				u = channels(u);
+			end
+			if isempty(u)
+				disp('TestTone stopped the recording because the signal was clipped!');
+			else
+				disp(sprintf('TestTone stopped the recording because the signal was clipped (channel %i)!',u));
+			end
+			if verbose
+				do_try_audio_IO = __retry_audio_IO();
+			else
+				error ('mataa_measure_signal_response: the recording was stopped because the signal was clipped.')
+			end
+		end
+
+		if verbose && ~do_try_audio_IO
 		% check for clipping:
 			for chan=1:size(dut_out,2)
-				m = max(abs(dut_out(:,chan)));
 				m0 = 0.95;
+				if TestTone_levels % no need to scan the recorded data
+					m = TestTone_info.peak(chan);
+					frac = sum(TestTone_info.clipped(chan)) / ( size(dut_out,1) * max(1,TestTone_info.numAverages) ); % samples at the clip level of TestTone
+				else
+					m = max(abs(dut_out(:,chan)));
+				end
 				if m >= m0
-					k = find(abs(dut_out(:,chan)) >= m0);
+					if ~TestTone_levels
+						frac = sum(abs(dut_out(:,chan)) >= m0) / size(dut_out,1);
+					end
 					beep
-					disp(sprintf('Signal in channel %i may be clipped (%0.3g%% of all samples)!',channels(chan),length(k)/length(dut_out(:,1))*100));		
+					disp(sprintf('Signal in channel %i may be clipped (%0.3g%% of all samples)!',channels(chan),frac*100));		
 					%%% input('If you want to continue, press ENTER. To abort, press CTRL-C.');
 					do_try_audio_IO = __retry_audio_IO();
 				else
@@ -4,6 +4,7 @@ function [L,f,fi,L0,unit] = mataa_measure_sine_distortion (fi,T,fs,latency,cal,a
 %
 % DESCRIPTION:
 % Play sine signals with frequencies fi and return the spectrum of the resulting signal in the DUT channel (e.g., measure harmonic distortion spectrum, or intermodulation distortion spectrum).
+% To measure the harmonic and intermodulation distortion at many frequencies in a single measurement, see mataa_measure_multitone.
 % 
 % INPUT:
 % fi: base frequency in Hz (if fi is a scalar), or frequency values of simultaneous sine signals (if fi is a vector).
@@ -16,7 +17,7 @@ function [L,f,fi,L0,unit] = mataa_measure_sine_distortion (fi,T,fs,latency,cal,a
 %	window.name = 'window' input argument of mataa_signal_window(...)
 %	window.par  = 'par' input argument of mataa_signal_window(...)
 % 	window.len  = 'len' input argument of mataa_signal_window(...) 
-% N_avg (optional): number of averages (integer, default: N_avg = 1). If N_avg > 1, the measurement is repeated N_avg times, and the mean result is returned. This is useful to reduce the noise floor.
+% N_avg (optional): number of averages (integer, default: N_avg = 1). If N_avg > 1, the test signal is played N_avg times in a single audio stream, and the recorded periods are averaged synchronously before the spectrum is calculated (see mataa_measure_signal_response). This is useful to reduce the noise floor.
 %
 % OUTPUT:
 % L: spectrum of DUT output signal at frequency values f. L(:,1) = amplitudes (zero-to-peak), L(:,2) = phase angles (radian)
@@ -99,57 +100,47 @@ s = s / max(abs(s));
 
 s = s * amplitude;
 
-L = [];
-unit0 = unit;
+% do sound I/O (with synchronous averaging of N_avg periods):
+[y,in,t,unit] = mataa_measure_signal_response(s,fs,latency,1,mataa_settings('channel_DUT'),cal,unit,N_avg);
 
-for k = 1:N_avg
-	% do sound I/O:
-	[y,in,t,unit] = mataa_measure_signal_response(s,fs,latency,1,mataa_settings('channel_DUT'),cal,unit0);
+% remove the zero padding and make the remaining signal length equal to length(t):
+i = find(abs(y) > 0.5*max(abs(y)));
+i1=min(i); i2=max(i);
+i1=round((i1+i2)/2 - T*fs/2);
+if i1 < 1
+	i1 = 1;
+end
+i2=i1+T*fs-1;
+if i2 > length(y)
+	i2 = length (y);
+	i1 = i2 - (T*fs-1);
+end
+y = y(i1:i2);
+t = [0:length(y)-1]/fs;
 
-	% remove the zero padding and make the remaining signal length equal to length(t):
-	i = find(abs(y) > 0.5*max(abs(y)));
-	i1=min(i); i2=max(i);
-	i1=round((i1+i2)/2 - T*fs/2);
-	if i1 < 1
-		i1 = 1;
-	end
-	i2=i1+T*fs-1;
-	if i2 > length(y)
-		i2 = length (y);
-		i1 = i2 - (T*fs-1);
-	end
-	y = y(i1:i2);
-	t = [0:length(y)-1]/fs;
-	
-	% window the signal to minimize frequency leakage
-	if isstruct (window)
-		y = mataa_signal_window (y,window.name,window.par,window.len);
-	else
-		y = mataa_signal_window (y,window);
-	end
-	
-	if length(y) < n % pad zeros to maintain frequency resolution
-		y = [ y ; repmat(0,n-length(y),1) ];
-	end
-	
-	% calculate signal spectrum (voltages!)
-	[LL,f] = mataa_realFT (y,t);
-	
-	% determine amplitude and phase angle:
-	PP = arg (LL);
-	LL = abs (LL);
-	
-	% normalize L to length of spectrum:
-	LL = LL / length(LL)*2;
-		
-	if k == 1
-		L  = [ LL(:) , PP(:) ] / N_avg ;
-	else
-		L  = L + [ LL(:) , PP(:) ] / N_avg;
-	end
-	
+% window the signal to minimize frequency leakage
+if isstruct (window)
+	y = mataa_signal_window (y,window.name,window.par,window.len);
+else
+	y = mataa_signal_window (y,window);
+end
+
+if length(y) < n % pad zeros to maintain frequency resolution
+	y = [ y ; repmat(0,n-length(y),1) ];
 end
 
+% calculate signal spectrum (voltages!)
+[LL,f] = mataa_realFT (y,t);
+
+% determine amplitude and phase angle:
+PP = arg (LL);
+LL = abs (LL);
+
+% normalize L to length of spectrum:
+LL = LL / length(LL)*2;
+
+L  = [ LL(:) , PP(:) ];
+
 % find signal level of fundamental(s)
 L0 = interp1 (f,L(:,1),fi,'nearest');
 L0 = mean (L0);
@@ -0,0 +1,131 @@
+function [R,L,f] = mataa_multitone_analysis (y,fs,k,N_h);
+
+% function [R,L,f] = mataa_multitone_analysis (y,fs,k,N_h);
+%
+% DESCRIPTION:
+% Analyses the response of a DUT to a periodic multitone signal (see mataa_signal_multitone and mataa_measure_multitone). y contains one or more consecutive periods of the steady-state response. All periods are transformed with a single multi-column FFT (no window, because the multitone signal and its distortion products fall exactly on the FFT bins), and the spectra are averaged. The fundamentals, the harmonics and the intermodulation products of all tones are then read from the averaged spectrum, and the noise is estimated from the differences between the spectra of the individual periods.
+%
+% For each tone, the harmonics h*k (h = 2...N_h) are read from the corresponding FFT bins. The intermodulation distortion (IMD) of a tone is the sum of all other FFT bins in the frequency band of the tone (between the geometric means of the tone frequency and the frequencies of the neighbouring tones) that are neither tones nor harmonics of a tone. The noise contribution, estimated from the variability of the periods, is subtracted from the IMD if more than one period is available.
+%
+% INPUT:
+% y: steady-state response to the multitone signal: column vector with one period, or matrix with one period per column (the number of rows is the period length).
+% fs: sampling rate (Hz)
+% k: FFT bins of the tones (see mataa_signal_multitone)
+% N_h (optional): highest harmonic analysed (default: N_h = 5)
+%
+% OUTPUT:
+% R: struct with the results for each tone (all ratios are amplitude ratios relative to the fundamental of the tone):
+%	R.f: tone frequencies (Hz)
+%	R.A: amplitude (zero-to-peak) of the fundamental
+%	R.phase: phase of the fundamental (radian)
+%	R.HD: amplitudes of the fundamental and the harmonics, one row per tone (R.HD(:,1) = R.A, R.HD(:,h) = h-th harmonic). Harmonics above the Nyquist frequency or at the frequency of another tone are NaN.
+%	R.fHD: frequencies of R.HD (Hz)
+%	R.THD: total harmonic distortion
+%	R.IMD: intermodulation distortion (see above)
+%	R.noise: noise in the frequency band of the tone (noise in the averaged spectrum, NaN if y contains one period only)
+%	R.TDN: total distortion plus noise of the whole signal (all non-tone FFT bins relative to all tones)
+% L: averaged spectrum at frequency values f. L(:,1) = amplitudes (zero-to-peak), L(:,2) = phase angles (radian), L(:,3) = noise amplitude (NaN if y contains one period only)
+% f: frequency values of L (Hz, without DC)
+%
+% EXAMPLE:
+% > fs = 48000; [s,t,fi,k] = mataa_signal_multitone (logspace(log10(50),log10(5000),12),fs,1,1);
+% > y = s + 0.01*s.^2 + 0.001*s.^3; % DUT with some distortion
+% > R = mataa_multitone_analysis (y,fs,k);
+% > semilogx (R.f,20*log10([R.THD R.IMD]))
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('N_h','var')
+	N_h = 5;
+end
+if isvector (y)
+	y = y(:);
+end
+
+[N,P] = size (y);
+nf = floor (N/2); % number of frequency values without DC (see mataa_realFT)
+k = sort (k(:));
+K = length (k);
+if any (k < 1 | k > nf)
+	error (sprintf('mataa_multitone_analysis: tone bins must be between 1 and %i.',nf));
+end
+
+% spectra of all periods, averaged spectrum and noise of the average:
+Y = fft (y);
+Y = Y(2:nf+1,:) * 2/N; % zero-to-peak amplitudes, bin b is in row b
+Ym = mean (Y,2);
+if P > 1
+	An = sqrt ( sum(abs(Y - repmat(Ym,1,P)).^2,2) / (P-1) / P );
+else
+	An = repmat (NaN,nf,1);
+end
+A = abs (Ym);
+f = [1:nf]' * fs / N;
+L = [ A , arg(Ym) , An ];
+
+% fundamentals and harmonics:
+kh = k * [1:N_h]; % bins of the harmonics (one row per tone)
+valid = kh <= nf;
+valid(:,2:end) = valid(:,2:end) & ~ismember (kh(:,2:end),k);
+HD = repmat (NaN,K,N_h);
+HD(valid) = A(kh(valid));
+
+R.f = k * fs / N;
+R.A = HD(:,1);
+R.phase = arg (Ym(k));
+R.HD = HD;
+R.fHD = kh * fs / N;
+u = HD(:,2:end); u(isnan(u)) = 0;
+R.THD = sqrt (sum(u.^2,2)) ./ R.A;
+
+% intermodulation products: all bins that are neither tones nor harmonics
+is_dist = true (nf,1);
+is_dist(kh(kh <= nf)) = false;
+
+% frequency bands of the tones (bin numbers, edges at the geometric means of neighbouring tones):
+if K > 1
+	e = sqrt (k(1:end-1).*k(2:end));
+	e = [ k(1)^2/e(1) ; e ; k(end)^2/e(end) ];
+else
+	e = k * [ 1/sqrt(2) ; sqrt(2) ];
+end
+e = min (max (e,1),nf+1);
+
+% sums of the distortion and noise powers in the bands (prefix sums):
+cD = [ 0 ; cumsum(is_dist .* A.^2) ];
+cN = [ 0 ; cumsum(is_dist .* An.^2) ];
+j1 = ceil (e(1:end-1));
+j2 = ceil (e(2:end)) - 1;
+D = cD(j2+1) - cD(j1);
+Nz = cN(j2+1) - cN(j1);
+if P > 1
+	D = max (D - Nz,0); % remove the noise contribution
+end
+R.IMD = sqrt (D) ./ R.A;
+R.noise = sqrt (Nz) ./ R.A;
+
+% total distortion plus noise:
+is_tone = false (nf,1);
+is_tone(k) = true;
+R.TDN = sqrt ( sum(A(~is_tone).^2) / sum(A(is_tone).^2) );
+
+endfunction
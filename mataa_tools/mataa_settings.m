@@ -10,6 +10,8 @@ function val = mataa_settings (field,value)
 % mataa_settings(field,val) sets the value of the setting 'field' to 'val'.
 % mataa_settings('reset') resets the settings to default values
 %
+% The settings are kept in memory after they were read from the settings file for the first time, so that repeated calls of mataa_settings do not need to read the file again. The file is read again only if it was changed (for instance by another Octave process using MATAA). New settings are written to a temporary file, which then replaces the settings file, so that other processes reading the settings at the same time never see a partially written file.
+%
 % EXAMPLES:
 % ** get the current settings (this also shows you the available fields):
 % > mataa_settings
@@ -44,10 +46,20 @@ function val = mataa_settings (field,value)
 % Contact: info@audioroot.net
 % Further information: http://www.audioroot.net/MATAA
 
-path = mataa_path ('settings');
-path = sprintf('%s.mataa_settings.mat',path);
+persistent cache = struct ('path','','stamp',[],'settings',[]); % settings file, its status when it was read, and the settings read from it
+
+if isempty (cache.path)
+	path = mataa_path ('settings');
+	path = sprintf('%s.mataa_settings.mat',path);
+	if exist ('tilde_expand')
+		path = tilde_expand (path); % make sure stat(...) sees the same file as load(...)
+	end
+	cache.path = path;
+end
+path = cache.path;
 
-reset_to_def = ~exist(path,'file');
+stamp = __file_stamp (path);
+reset_to_def = isempty (stamp);
 
 if (~reset_to_def && exist('field','var'))
 	reset_to_def = strcmp(field,'reset');
@@ -69,8 +81,18 @@ if reset_to_def
 	
 	mataa_settings.channel_DUT = 1;
 	mataa_settings.channel_REF = 2;
+	mataa_settings.channel_DAC = 1; % DAC channel used for test signals played on a single channel (e.g. mataa_measure_HD_sweep, mataa_measure_impedance_TF)
 
-	mataa_settings.audio_IO_method = 'TestTone';
+	mataa_settings.audio_IO_method = 'TestTone'; % 'TestTone' (TestTone program), 'TestToneOct' (TestTone module for Octave, no temporary files or external processes, see TestTone/source/README.txt), or 'PlayRec'
+	mataa_settings.audio_TestTone_binary = 0; % exchange data with TestTone using binary files instead of text files (much faster, requires a TestTone binary supporting the -b option)
+	mataa_settings.audio_TestTone_server = 0; % use the TestTone server, which keeps the audio stream open in between measurements (see mataa_TestTone_server, requires a TestTone binary supporting the -S option, not available on Windows)
+	mataa_settings.audio_TestTone_InputDevice = ''; % sound input device used by TestTone (device number or (part of the) device name, '' = default device; binary data exchange only)
+	mataa_settings.audio_TestTone_OutputDevice = ''; % sound output device used by TestTone (device number or (part of the) device name, '' = default device; binary data exchange only)
+	mataa_settings.audio_TestTone_FramesPerBuffer = 0; % buffer size of the TestTone audio stream (frames, 0 = TestTone default; binary data exchange only)
+	mataa_settings.audio_TestTone_trim = 0; % let TestTone remove the round-trip delay of the audio hardware from the recorded data, so that the zero padding of the test signals can be short (binary data exchange only)
+	mataa_settings.audio_TestTone_loopback = 0; % ADC channel with a loopback of the test signal, used by TestTone to determine the round-trip delay if audio_TestTone_trim is set (0 = none, use the time stamps of the audio device)
+	mataa_settings.audio_TestTone_SuggestedLatency = 0; % latency of the TestTone audio stream requested from the audio device (seconds, 0 = device default; binary data exchange only)
+	mataa_settings.audio_TestTone_clipabort = 0; % let TestTone stop the recording as soon as a recorded channel clips, so that the measurement can be repeated without waiting for the end of the test signal (binary data exchange only)
 	
 	mataa_settings.audio_PlayRec_InputDeviceName  = 'unknown';
 	mataa_settings.audio_PlayRec_OutputDeviceName = 'unknown';
@@ -79,16 +101,20 @@ if reset_to_def
 	
 	mataa_settings.audioinfo_skipcheck = 0; % don't run the TestDevices check and return generic audio info instead (suitable for a typical audio interface, stereo, full duplex). This is useful to skip the query to audio interfaces which do nasty things when TestDevices asks them for their properties (such as the RTX-6001 which goes crazy with relays clicking)
 	
-	cc = [ 'save -mat ' path ' mataa_settings ; ' ];
-	disp(sprintf('Creating / resetting to MATAA default settings (command: %s)...',cc));
-	eval( cc );
+	disp(sprintf('Creating / resetting to MATAA default settings (%s)...',path));
+	cache.stamp = __save (path,mataa_settings);
+	cache.settings = mataa_settings;
 	val = mataa_settings;
 	disp(mataa_settings);
 	disp('...done.');
+elseif ~isequal (stamp,cache.stamp)
+	% (re)load settings from disk (first call, or file changed by another process):
+	u = load (path);
+	cache.settings = u.mataa_settings;
+	cache.stamp = stamp;
 end
 
-% load settings from disk:
-load(path);
+mataa_settings = cache.settings;
 
 if nargin==0 % return all settings
 	val = mataa_settings;	
@@ -96,7 +122,7 @@ if nargin==0 % return all settings
 else
 	if nargin == 1 % read and return the value of the specified field
 		if isfield(mataa_settings,field)
-			eval( ['val = mataa_settings.' field ';' ] );
+			val = mataa_settings.(field);
 		else
 			if ~strcmp(field,'reset')
 				warning(sprintf('mataa_settings: Unknown field value in mataa_settings: %s.',field));
@@ -104,8 +130,9 @@ else
 			end
 		end		
 	elseif nargin == 2 % set the field to the specified value and save the settings file	
-		eval( [ 'mataa_settings.' field ' = value ; ' ] );
-		eval( [ 'save -mat ' path ' mataa_settings ; ' ] );
+		mataa_settings.(field) = value;
+		cache.stamp = __save (path,mataa_settings);
+		cache.settings = mataa_settings;
 		val = value;
 	
 	else
@@ -114,5 +141,31 @@ else
 
 end
 
+endfunction
+
+
+function stamp = __file_stamp (path)
+	% modification time, size and inode of the settings file (empty if the file does not exist). The inode changes whenever the file is replaced by __save, even if this happens within the resolution of the modification time.
+	[st,err] = stat (path);
+	if err ~= 0
+		stamp = [];
+	else
+		stamp = [ st.mtime st.size st.ino ];
+	end
+endfunction
+
+
+function stamp = __save (path,mataa_settings)
+	% write the settings to a temporary file in the same directory and rename it to the settings file (atomic replacement), return the status of the new file
+	tmp = sprintf ('%s.%i.tmp',path,getpid);
+	save ('-mat',tmp,'mataa_settings');
+	[err,msg] = rename (tmp,path);
+	if err ~= 0
+		delete (tmp);
+		error (sprintf('mataa_settings: could not write the settings file %s (%s).',path,msg));
+	end
+	stamp = __file_stamp (path);
+endfunction
+
 	
 	
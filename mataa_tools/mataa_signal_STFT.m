@@ -0,0 +1,139 @@
+function [M,t,f,state] = mataa_signal_STFT (s,fs,nwin,hop,state);
+
+% function [M,t,f,state] = mataa_signal_STFT (s,fs,nwin,hop,state);
+%
+% DESCRIPTION:
+% Short-time Fourier transform (STFT) of the signal s: the signal is cut into frames of nwin samples, starting every hop samples (frames overlap if hop < nwin). Each frame is detrended and multiplied by a Hann window, and all frames are transformed with a single multi-column FFT into a preallocated matrix. The frames are sliced from the signal by index (no searching of time values), and the window is kept in memory for repeated calls with the same frame length. This is the engine used by mataa_signal_spectrogram.
+%
+% The STFT can also be computed incrementally from a signal that is still being recorded (streaming): if the state argument is given (use state = [] for the first call), s contains the new samples only, and only complete frames are transformed. The samples needed for the next frames are kept in state. Instead of the new samples, s may also be the path to a binary TestTone file that is still being written (e.g. the output file of a running TestTone process, see mataa_TestToneFile_to_signal). The frames written since the last call are then read from the file (channel state.channel, default: 1).
+%
+% INPUT:
+% s: signal samples (vector), or path to a binary TestTone file (streaming only)
+% fs: sampling rate (Hz)
+% nwin: number of samples per frame
+% hop (optional): number of samples between the starts of consecutive frames (default: hop = nwin, i.e. no overlap)
+% state (optional): streaming state returned by the previous call (use [] for the first call). If state is not given, s is the full signal, and the last frame is padded with zeros if needed.
+%
+% OUTPUT:
+% M: magnitude spectra in dB-FS(rms) (see mataa_IR_to_FR), one column per frame (DC is not included)
+% t: time values of the frames (centre of each frame, in seconds from the start of the signal), row vector
+% f: frequency values (Hz), column vector
+% state: streaming state to be passed to the next call
+%
+% EXAMPLE:
+% (1) STFT of a sweep with 50% overlap:
+% > fs = 44100; [s,t] = mataa_signal_generator ('sweep_log',fs,3,[100 20000]);
+% > [M,t,f] = mataa_signal_STFT (s,fs,2048,1024);
+% > imagesc (t,f,M); axis xy
+%
+% (2) Streaming the same data in chunks of 10000 samples:
+% > state = []; M = []; t = [];
+% > for k = 1:10000:length(s)
+% >     [MM,tt,f,state] = mataa_signal_STFT (s(k:min(k+9999,end)),fs,2048,1024,state);
+% >     M = [ M MM ]; t = [ t tt ];
+% > end
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+persistent cache = struct ('nwin',0,'W',[],'A',[],'P',[]); % window and detrending matrices of the last frame length
+
+if ~exist ('hop','var') || isempty (hop)
+	hop = nwin;
+end
+if hop < 1 || nwin < 2
+	error ('mataa_signal_STFT: nwin must be at least 2 and hop must be at least 1.');
+end
+streaming = exist ('state','var');
+
+if streaming
+	if isempty (state)
+		state.buffer = [];	% samples not yet used by a complete frame
+		state.start = 0;	% sample index of the first sample in buffer (zero-based)
+		state.framesRead = 0;	% frames read from the TestTone file
+		state.channel = 1;	% channel read from the TestTone file
+	end
+	if ischar (s)
+		[s,state.framesRead] = __read_new_frames (s,state.framesRead,state.channel);
+	end
+	s = [ state.buffer ; s(:) ];
+else
+	s = s(:);
+	L = max (1,ceil((length(s)-nwin)/hop)+1); % number of frames
+	s = [ s ; zeros((L-1)*hop+nwin-length(s),1) ]; % pad zeros to complete the last frame
+end
+
+% frames (one column per frame), sliced by index:
+L = max (0,floor((length(s)-nwin)/hop)+1);
+X = reshape (s([1:nwin]' + hop*[0:L-1]),nwin,L); % (reshape makes sure X has nwin rows even if L == 0)
+
+% window and detrending matrices (least-squares fit of constant and linear trends, A*P is the projection onto the trends):
+if cache.nwin ~= nwin
+	cache.nwin = nwin;
+	cache.W = mataa_signal_window (ones(nwin,1),'hann'); cache.W = cache.W(:);
+	cache.A = [ ones(nwin,1) [1:nwin]'/nwin ];
+	cache.P = pinv (cache.A);
+end
+
+X = X - cache.A * (cache.P * X); % detrend (the nwin x 2 and 2 x nwin matrices avoid the nwin x nwin projection matrix)
+X = X .* repmat (cache.W,1,L);
+
+% FFT of all frames:
+nf = floor (nwin/2); % number of frequency values without DC (see mataa_realFT)
+X = fft (X);
+M = 20*log10 (abs(X(2:nf+1,:))/sqrt(0.5)); % dB-FS(rms), see mataa_IR_to_FR
+f = [1:nf]' * fs / nwin;
+
+if streaming
+	t = ( state.start + hop*[0:L-1] + nwin/2 ) / fs;
+	state.buffer = s(L*hop+1:end); % samples of the next frames
+	state.start  = state.start + L*hop;
+else
+	t = ( hop*[0:L-1] + nwin/2 ) / fs;
+end
+
+endfunction
+
+
+function [s,framesRead] = __read_new_frames (pathToFile,framesRead,channel)
+	% read the frames written to a binary TestTone file since the last call
+	s = [];
+	fid = fopen (pathToFile,'rb','native');
+	if fid == -1 % file not created yet
+		return
+	end
+	magic = char (fread(fid,8,'char')');
+	if ~strcmp (magic,'MATAAF32') % header not written yet
+		fclose (fid);
+		return
+	end
+	headerSize  = fread (fid,1,'uint32');
+	numChannels = fread (fid,1,'uint32');
+	fseek (fid,0,'eof');
+	n = floor ( (ftell(fid) - headerSize) / (4*numChannels) ) - framesRead; % complete frames available
+	if n > 0
+		fseek (fid,headerSize + 4*numChannels*framesRead,'bof');
+		x = fread (fid,[numChannels,n],'float32=>double');
+		s = x(channel,:)';
+		framesRead = framesRead + n;
+	end
+	fclose (fid);
+endfunction
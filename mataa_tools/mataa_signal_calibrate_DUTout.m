@@ -129,48 +129,8 @@ function [h,t] = __calib (h,t,subcal,type,verbose)
     	   signal_cropped = 1;
     	end
 
-    	T = max(t)-min(t); % length of h
-    	f = [1/T:1/T:length(t)/2*1/T]'; % frequency values corresponding to Fourier transform of h
-    	clear T
-    	    
-    	% Interpolate device frequency response to frequency values f:
-        gain = interp1 (subcal.transfer.f,subcal.transfer.gain,f);
-        if isfield (subcal.transfer,'phase') % phase given explicitly
-	        phase = interp1 (subcal.transfer.f,subcal.transfer.phase,f);
-    	end
-    	
-    	% make sure gain (and phase) does not contain any NA or NaN values (data out of frequency range of calibration file will be dealt with later):
-    	if any( f < subcal.transfer.f(1) )
-    	    gain( f < subcal.transfer.f(1) ) = subcal.transfer.gain(1);
-    	    if exist ('phase','var')
-    	    	phase( f < subcal.transfer.f(1) ) = subcal.transfer.phase(1);
-    	    end
-    	end
-    	if any( f > subcal.transfer.f(end) )
-    	    gain( f > subcal.transfer.f(end) ) = subcal.transfer.gain(end);
-    	    if exist ('phase','var')
-    	    	phase( f > subcal.transfer.f(end) ) = subcal.transfer.phase(end);
-    	    end
-    	end
-		
-    	% calculate minimum phase of device if necessary:    	
-    	if ~exist ('phase','var')
-	    	i = sqrt(-1); % make sure we don't have something else assigned to 'i'
-    		%%% phase = -mataa_hilbert(gain/20); % phase in radians THIS SEEMS WRONG DUE TO MIXUP BETWEEN LOG-10 (from dB scale) vs. LOG-NAT (as needed for Hilbert transform)
-    		phase = mataa_minimum_phase (gain)/180*pi; % phase in radians
-    	end
-    	
-    	% complex fourier spectrum of sensor transfer function:
-    	pp = 10.^(gain/20) .* exp(i*phase); 
-    	    	
-    	% make up second half of fourier spectrum:
-    	% first entry: DC component ( set this to NaN )
-    	% first half = pp
-    	% middle point belongs to both halves
-    	% second half = conj(fliplr(pp)), because the impulse response of the sensor is real
-    	
-    	pp = pp(:)';
-    	P = [ NaN pp conj(fliplr(pp(1:end-1))) ];
+    	% inverse of the complex Fourier spectrum of the transfer function at the frequencies of the Fourier transform of h:
+    	Pinv = __inverse_transfer (subcal.transfer,max(t)-min(t),length(t));
     	
     	H = mataa_realFT(h,t); % get the 'real' half of the fourier specturm of h
 
@@ -186,9 +146,7 @@ function [h,t] = __calib (h,t,subcal,type,verbose)
     	% normalize H by P (deconvolve h from impulse response of sensor):
 		H0 = H;
 
-    	H = H ./ P;
-    	
-    	H(1) = 0; % 'repair' the NaN DC-value, remember: P(1)=NaN )
+    	H = H .* Pinv; % (Pinv(1) = 0, i.e. the DC value is removed)
 		
 	h0 = h;
     	h = ifft(H);
@@ -293,3 +251,63 @@ else
 end
 
 end % main function
+
+
+
+% helper function: inverse of the complex transfer function on the FFT frequency grid of a signal with length T and N samples
+function Pinv = __inverse_transfer (transfer,T,N)
+	% The result depends only on the transfer function and the FFT grid. It is kept in memory for the last few transfer functions / FFT grids, so that repeated calibrations of signals with the same length (e.g. the DUT and REF channels of every measurement) need no interpolation and no minimum-phase calculation.
+	persistent memo = struct ('transfer',{},'T',{},'N',{},'Pinv',{});
+
+	for k = 1:length (memo)
+		if memo(k).N == N && memo(k).T == T && isequal (memo(k).transfer,transfer)
+			Pinv = memo(k).Pinv;
+			return
+		end
+	end
+
+	f = [1/T:1/T:N/2*1/T]'; % frequency values corresponding to Fourier transform of h
+	    
+	% Interpolate device frequency response to frequency values f:
+	gain = interp1 (transfer.f,transfer.gain,f);
+	if isfield (transfer,'phase') % phase given explicitly
+		phase = interp1 (transfer.f,transfer.phase,f);
+	end
+	
+	% make sure gain (and phase) does not contain any NA or NaN values (data out of frequency range of calibration file will be dealt with later):
+	if any( f < transfer.f(1) )
+		gain( f < transfer.f(1) ) = transfer.gain(1);
+		if exist ('phase','var')
+			phase( f < transfer.f(1) ) = transfer.phase(1);
+		end
+	end
+	if any( f > transfer.f(end) )
+		gain( f > transfer.f(end) ) = transfer.gain(end);
+		if exist ('phase','var')
+			phase( f > transfer.f(end) ) = transfer.phase(end);
+		end
+	end
+	
+	% calculate minimum phase of device if necessary:    	
+	if ~exist ('phase','var')
+		%%% phase = -mataa_hilbert(gain/20); % phase in radians THIS SEEMS WRONG DUE TO MIXUP BETWEEN LOG-10 (from dB scale) vs. LOG-NAT (as needed for Hilbert transform)
+		phase = mataa_minimum_phase (gain)/180*pi; % phase in radians
+	end
+	
+	% complex fourier spectrum of sensor transfer function:
+	pp = 10.^(gain/20) .* exp(1i*phase); 
+	
+	% make up second half of fourier spectrum:
+	% first entry: DC component (the inverse is set to zero, which removes the DC value of the calibrated signal)
+	% first half = pp
+	% middle point belongs to both halves
+	% second half = conj(fliplr(pp)), because the impulse response of the sensor is real
+	pp = pp(:)';
+	Pinv = 1 ./ [ Inf pp conj(fliplr(pp(1:end-1))) ];
+
+	memo(end+1) = struct ('transfer',transfer,'T',T,'N',N,'Pinv',Pinv);
+	if length (memo) > 8 % keep the most recent ones only
+		memo(1) = [];
+	end
+
+end % __inverse_transfer function
@@ -14,7 +14,7 @@ function [s,t,info] = mataa_signal_generator (kind,fs,T,param);
 % kind can be one of the following:
 % 'white':            White noise (no additional parameters required)
 % 'pink':             Pink noise (no additional parameters required)
-% 'MLS':              Maximum length sequence (MLS). The 'T' parameter is ignored, and param = n is the number of taps to be used for the MLS. The length of the MLS will be 2^n-1 samples.
+% 'MLS':              Maximum length sequence (MLS). The 'T' parameter is ignored, and param = n is the number of taps to be used for the MLS (2 <= n <= 32). The length of the MLS will be 2^n-1 samples. Use mataa_MLS_correlate or mataa_deconvolve_IR to determine the impulse response from the response to an MLS.
 % 'sine','sin':       Sine wave (param = frequency in Hz)
 % 'cosine','cos':     Cosine wave (param = frequency in Hz)
 % 'sweep','sweep_log':Sine sweep, where frequency increases exponentially with time (param = [f1 f2], where f1 and f2 are the min. and max frequencies in Hz)
@@ -279,7 +279,7 @@ x = real(x);
 
 
 
-% FROM http://www.mathworks.com/matlabcentral/fileexchange/loadFile.do?objectId=1246&objectkind=file
+% BASED ON http://www.mathworks.com/matlabcentral/fileexchange/loadFile.do?objectId=1246&objectkind=file
 function  y = M_mls(n,flag)
 
 %y = mls(n,{flag});
@@ -287,7 +287,7 @@ function  y = M_mls(n,flag)
 %Generates a Maximum Length Sequence of n bits by utilizing a 
 %linear feedback shift register with an XOR gate on the tap bits 
 %
-%Function can accept bit lengths of between 2 and 24
+%Function can accept bit lengths of between 2 and 32
 %
 %y is a vector of 1's & -1's that is (2^n)-1 in length.
 %
@@ -296,11 +296,12 @@ function  y = M_mls(n,flag)
 %  1 for an initial sequence of all ones (repeatable)
 %  0 for an initial sequence that is random (default)
 %
-%note: Because of the recursive nature of this process, it is not 
-%possible to completely vectorize this code (at least I don't know 
-%how to do it). As a result, longer bit lengths will take quite a 
-%long time to process, perhaps hours. If you figure out a way to 
-%vectorize the for loop, please let me know.
+%The feedback bit of the shift register at step k is x(k) = xor(x(k-tap1),x(k-tap2),...).
+%Because x(k) may depend on x(k-1), the register cannot be vectorized directly. However,
+%the sequence also obeys x(k) = xor(x(k-2^s*tap1),x(k-2^s*tap2),...) for any s (squaring
+%the feedback polynomial in GF(2)), so blocks of 2^s*min(taps) bits can be computed at once
+%from the bits already known. The block length doubles as the sequence grows, so the
+%sequence is computed in a few hundred vectorized steps instead of 2^n-1 loop iterations.
 %
 %reference:
 %	Davies, W.D.T. (June, July, August, 1966). Generation and 
@@ -308,157 +309,16 @@ function  y = M_mls(n,flag)
 %
 %Spring 2001, Christopher Brown, cbrown@phi.luc.edu
 
-switch n								%assign taps which will yeild a maximum
-case 2								%length sequence for a given bit length
-   taps=2;							%I forget the reference I used, but theres
-   tap1=1;							%a list of appropriate tap values in
-   tap2=2;							%Vanderkooy, JAES, 42(4), 1994.
-case 3
-   taps=2;
-   tap1=1;
-   tap2=3;
-case 4
-   taps=2;
-   tap1=1;
-   tap2=4;
-case 5
-   taps=2;
-   tap1=2;
-   tap2=5;
-case 6
-   taps=2;
-   tap1=1;
-   tap2=6;
-case 7
-   taps=2;
-   tap1=1;
-   tap2=7;
-case 8
-   taps=4;
-   tap1=2;
-   tap2=3;
-   tap3=4;
-   tap4=8;
-case 9
-   taps=2;
-   tap1=4;
-   tap2=9;
-case 10
-   taps=2;
-   tap1=3;
-   tap2=10;
-case 11
-   taps=2;
-   tap1=2;
-   tap2=11;
-case 12
-   taps=4;
-   tap1=1;
-   tap2=4;
-   tap3=6;
-   tap4=12;
-case 13
-   taps=4;
-   tap1=1;
-   tap2=3;
-   tap3=4;
-   tap4=13;
-case 14
-   taps=4;
-   tap1=1;
-   tap2=3;
-   tap3=5;
-   tap4=14;
-case 15
-   taps=2;
-   tap1=1;
-   tap2=15;
-case 16
-   taps=4;
-   tap1=2;
-   tap2=3;
-   tap3=5;
-   tap4=16;
-case 17
-   taps=2;
-   tap1=3;
-   tap2=17;
-case 18
-   taps=2;
-   tap1=7;
-   tap2=18;
-case 19
-   taps=4;
-   tap1=1;
-   tap2=2;
-   tap3=5;
-   tap4=19;
-case 20
-   taps=2;
-   tap1=3;
-   tap2=20;
-case 21
-   taps=2;
-   tap1=2;
-   tap2=21;
-case 22
-   taps=2;
-   tap1=1;
-   tap2=22;
-case 23
-   taps=2;
-   tap1=5;
-   tap2=23;
-case 24
-   taps=4;
-   tap1=1;
-   tap2=3;
-   tap3=4;
-   tap4=24;
-%case 25
-%   taps=2;
-%   tap1=3;
-%   tap2=25;
-%case 26
-%   taps=4;
-%   tap1=1;
-%   tap2=7;
-%   tap3=8;
-%   tap4=26;
-%case 27
-%   taps=4;
-%   tap1=1;
-%   tap2=7;
-%   tap3=8;
-%   tap4=27;
-%case 28
-%   taps=2;
-%   tap1=3;
-%   tap2=28;
-%case 29
-%   taps=2;
-%   tap1=2;
-%   tap2=29;
-%case 30
-%   taps=4;
-%   tap1=1;
-%   tap2=15;
-%   tap3=16;
-%   tap4=30;
-%case 31
-%   taps=2;
-%   tap1=3;
-%   tap2=31;
-%case 32
-%   taps=4;
-%   tap1=1;
-%   tap2=27;
-%   tap3=28;
-%   tap4=32;
-otherwise
-   disp(' ');
-   disp('input bits must be between 2 and 24');
-   return
+% taps which will yield a maximum length sequence for a given bit length (see Vanderkooy, JAES, 42(4), 1994):
+mls_taps = { [1 2] , [1 3] , [1 4] , [2 5] , [1 6] , [1 7] , [2 3 4 8] , [4 9] , [3 10] , [2 11] , [1 4 6 12] , [1 3 4 13] , [1 3 5 14] , [1 15] , [2 3 5 16] , [3 17] , [7 18] , [1 2 5 19] , [3 20] , [2 21] , [1 22] , [5 23] , [1 3 4 24] , [3 25] , [1 7 8 26] , [1 7 8 27] , [3 28] , [2 29] , [1 15 16 30] , [3 31] , [1 27 28 32] };
+
+if n < 2 || n > 32
+   error('mataa_signal_generator: MLS bit length must be between 2 and 32.');
+end
+taps = mls_taps{n-1};
+
+if n > 28
+	warning(sprintf('mataa_signal_generator: the MLS with %i bits has %i samples, this needs a lot of memory!',n,2^n-1));
 end
 
 if (nargin == 1) 
@@ -483,15 +343,21 @@ else
 	end
 end
 
-for i = (2^n)-1:-1:1
-      
-   xorbit = xor(abuff(tap1),abuff(tap2));		%feedback bit
-   
-   if taps==4
-      xorbit2 = xor(abuff(tap3),abuff(tap4));%4 taps = 3 xor gates & 2 levels of logic
-      xorbit = xor(xorbit,xorbit2);				%second logic level
-   end
-   
-	abuff = [xorbit abuff(1:n-1)];
-	y(i) = (-2 .* xorbit) + 1;  	%yields one's and negative one's (0 -> 1; 1 -> -1)
+% sequence of feedback bits, starting with the initial register contents:
+P = 2^n-1;
+x = false(1,n+P);
+x(1:n) = fliplr(abuff);
+K = n; % number of bits known so far
+while K < n+P
+	s = floor(log2(K/n)); % largest s with 2^s*n <= K
+	B = min([ 2^s*min(taps) , 2^22 , n+P-K ]); % number of bits that can be computed from the known bits
+	k = K+1:K+B;
+	u = x(k-2^s*taps(1));
+	for j = 2:length(taps)
+		u = xor(u,x(k-2^s*taps(j)));
+	end
+	x(k) = u;
+	K = K+B;
 end
+
+y = 1 - 2*fliplr(x(n+1:end)); %yields one's and negative one's (0 -> 1; 1 -> -1)
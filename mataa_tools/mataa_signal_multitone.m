@@ -0,0 +1,101 @@
+function [s,t,fi,k,crest] = mataa_signal_multitone (fi,fs,T,odd_bins,N_iter);
+
+% function [s,t,fi,k,crest] = mataa_signal_multitone (fi,fs,T,odd_bins,N_iter);
+%
+% DESCRIPTION:
+% Creates one period of a multitone signal (sum of sine waves with equal amplitudes). The tone frequencies are adjusted to the nearest frequencies of the FFT of one signal period (i.e. integer multiples of 1/T), so that the periodic signal and its harmonics and intermodulation products fall exactly on the FFT bins (no frequency leakage, no need for a window function). The signal is synthesised with a single inverse FFT.
+%
+% The phases of the tones are chosen to keep the crest factor (peak / RMS value) of the signal low, so that the signal can be played at a high RMS level without clipping: the initial phases are those of Schroeder (1970), phi(i) = -pi*i*(i-1)/K for the i-th of K tones, which are then refined by N_iter iterations of clipping the signal peaks and restoring the tone amplitudes (keeping the phases of the clipped signal). The signal with the lowest crest factor is returned.
+%
+% INPUT:
+% fi: frequencies of the tones (Hz). Tones that are adjusted to the same FFT bin are merged.
+% fs: sampling rate (Hz)
+% T: length of the signal period (seconds). The frequency resolution is 1/T.
+% odd_bins (optional): if odd_bins is not zero, the tones are adjusted to odd-numbered FFT bins only (frequencies (2m+1)/T). The even-order harmonics and intermodulation products (2*f1, f1+f2, f2-f1, ...) then fall between the tones. Default: odd_bins = 0.
+% N_iter (optional): number of iterations of the crest-factor optimisation (default: N_iter = 20). Use N_iter = 0 for the Schroeder phases only.
+%
+% OUTPUT:
+% s: signal samples of one period (column vector, normalised to max(abs(s)) = 1). The signal is periodic, i.e. s can be repeated seamlessly.
+% t: time values of the samples (seconds)
+% fi: frequencies of the tones after adjustment to the FFT bins (Hz)
+% k: FFT bins of the tones (fi = k*fs/length(s), bin 0 is DC)
+% crest: crest factor of s (peak / RMS value)
+%
+% EXAMPLE:
+% > [s,t,fi,k,crest] = mataa_signal_multitone (logspace(log10(20),log10(20000),30),48000,1,1);
+% > plot (t,s); crest
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
+
+if ~exist ('odd_bins','var')
+	odd_bins = 0;
+end
+if ~exist ('N_iter','var')
+	N_iter = 20;
+end
+
+N = round (T*fs); % number of samples per period
+
+% FFT bins of the tones:
+if odd_bins
+	k = 2*round ((fi(:)*N/fs-1)/2) + 1;
+else
+	k = round (fi(:)*N/fs);
+end
+k = unique (k);
+k = k(k > 0 & k < N/2); % no DC and Nyquist tones
+if isempty (k)
+	error (sprintf('mataa_signal_multitone: no tone frequencies between DC and Nyquist frequency (frequency resolution: %g Hz).',fs/N));
+end
+K = length (k);
+fi = k*fs/N;
+
+% Schroeder phases:
+phi = -pi * [0:K-1]' .* [1:K]' / K;
+s = __synth (phi,k,N);
+crest = max (abs(s)) / sqrt (mean(s.^2));
+
+% crest-factor optimisation (clip the peaks, then restore the tone amplitudes and remove everything else):
+x = s;
+for i = 1:N_iter
+	a = 0.9 * max (abs(x));
+	X = fft (max (min (x,a),-a));
+	x = __synth (arg(X(k+1)),k,N);
+	c = max (abs(x)) / sqrt (mean(x.^2));
+	if c < crest
+		s = x;
+		crest = c;
+	end
+end
+
+s = s / max (abs(s));
+t = [0:N-1]' / fs;
+
+endfunction
+
+
+function s = __synth (phi,k,N)
+	% sum of cosines with unit amplitude and phases phi at FFT bins k (one period of N samples)
+	X = zeros (N,1);
+	X(k+1) = N/2 * exp (1i*phi);
+	s = 2 * real (ifft(X));
+endfunction
@@ -1,15 +1,16 @@
-function [m,t,f] = mataa_signal_spectrogram (s,t,dt,smooth);
+function [m,t,f] = mataa_signal_spectrogram (s,t,dt,smooth,overlap);
 
-% function [m,t,f] = mataa_signal_spectrogram (s,t,dt,smooth);
+% function [m,t,f] = mataa_signal_spectrogram (s,t,dt,smooth,overlap);
 %
 % DESCRIPTION:
-% Calculate spectrogram (aka sonogram) of the signal s(t).
+% Calculate spectrogram (aka sonogram) of the signal s(t). The signal is cut into chunks of length dt, which are detrended, windowed (Hann window) and transformed all at once using mataa_signal_STFT. The chunks may overlap (see overlap). To compute the spectrogram of a signal that is still being recorded, use mataa_signal_STFT directly (streaming mode).
 %
 % INPUT:
 % s: vector containing the samples values of the signal.
 % t: time values of samples in h (vector, in seconds) or sampling rate of h (scalar, in Hz)
 % dt: width time chunks used to calculate of spectrogram lines
-% smooth (optional): if specified, the data is smoothed in the frequency domain over the octave interval smooth_interval.
+% smooth (optional): if specified and not empty, the data is smoothed in the frequency domain over the octave interval smooth_interval.
+% overlap (optional): overlap of consecutive chunks, as a fraction of the chunk length (0 <= overlap < 1, default: overlap = 0)
 % 
 % OUTPUT:
 % m: magnitude values in dB (matrix)
@@ -51,40 +52,29 @@ function [m,t,f] = mataa_signal_spectrogram (s,t,dt,smooth);
 
 if isscalar(t)
     fs = t;
-    t = [0:1/fs:(length(s)-1)/fs];
+    N = length (s);
 else
     fs = (length(t)-1)/(max(t)-min(t));
-    t  = t-t(1); % shift impulse response to zero-based time
+    N = length (t);
 end
 
-% make sure we've got column vectors:
-s = s(:);
-t = t(:);
+if ~exist ('overlap','var') || isempty (overlap)
+    overlap = 0;
+end
+if overlap < 0 || overlap >= 1
+    error ('mataa_signal_spectrogram: overlap must be in the range 0 ... 1 (excluding 1).');
+end
 
-T  = t(end) + 1/fs; % total length of signal
-tt = [0:dt:T]; % time bins
-nt = ceil ( length (t) / (length(tt)-1) ) ; % number of samples per signal chunk
+T  = N/fs; % total length of signal
+nt = ceil ( N / (length([0:dt:T])-1) ) ; % number of samples per signal chunk
+hop = max (1,round (nt*(1-overlap))); % number of samples between the starts of consecutive chunks
 
-nf = floor (nt/2); % number of frequency values in each spectrogram line
+[m,t,f] = mataa_signal_STFT (s,fs,nt,hop);
 
-m = [];
-for i = 1:length(tt)-1
-    j = find ( t >= tt(i)  &  t < tt(i+1) );
-    x = s(j); x = x(:);
-    x = detrend (x); 
-    x = mataa_signal_window (x,'hann');
-    if length(x) < nt % pad zeros
-        x = [ x ; repmat(0,nt-length(x),1) ];
+if exist ('smooth','var') && ~isempty (smooth)
+    [m,phase,f] = mataa_FR_smooth (m,zeros(size(m)),f,smooth); % all lines in one pass
+    if size (m,1) == 1
+        m = m(:);
     end
-    x = x(1:nt); % in case there's one too many
-        
-    if exist ('smooth','var')
-	    [M,u,f] = mataa_IR_to_FR (x,fs,smooth);
-	    
-	else
-	    [M,u,f] = mataa_IR_to_FR (x,fs);
-	end
-	m = [ m M ];
+    f = f(:);
 end
-
-t = ( tt(1:end-1) + tt(2:end) ) / 2;
\ No newline at end of file
@@ -1,6 +1,6 @@
-function pathToFile = mataa_signal_to_TestToneFile (s,pathToFile,zeroTime,fs);
+function pathToFile = mataa_signal_to_TestToneFile (s,pathToFile,zeroTime,fs,format);
 
-% function pathToFile = mataa_signal_to_TestToneFile (s,pathToFile,zeroTime,fs);
+% function pathToFile = mataa_signal_to_TestToneFile (s,pathToFile,zeroTime,fs,format);
 %
 % DESCRIPTION:
 % Saves the test signals in matrix s to a file on disk (for use with TestTone). Optionally, the signals are  padded with zeroes at the beginning and the end.
@@ -12,12 +12,14 @@ function pathToFile = mataa_signal_to_TestToneFile (s,pathToFile,zeroTime,fs);
 %
 % zeroTime (optional): duration of 'zero signal' to be padded to the beginning and the end of the signal (in seconds). If not specified, no zeros will be padded to the signal.
 %
-% fs (only if zeroTime is specified): the sample rate of the signal (in Hz). This is required to determine the number of 'zero samples'.
+% fs (only if zeroTime is specified): the sample rate of the signal (in Hz). This is required to determine the number of 'zero samples'. Use zeroTime = 0 if you want to specify fs without zero padding.
+%
+% format (optional): file format, either 'text' (default) or 'binary'. The text format is a CSV file with one line per frame. The binary format consists of a short header (number of frames, number of channels, sample rate) followed by the interleaved samples as float32 values, which is much faster to write and read for long signals (see mataa_TestToneFile_to_signal).
 % 
 % OUTPUT:
 % pathToFile: the path (including the file name) of the file to which the data was written.
 % 
-% NOTE 1: TestTone assumes that all information regarding the sample rate / time interval in between the samples is handled appropriately. mataa_signal_to_TestToneFile therefore does NOT handle any sample timing information. Only the sample VALUES are written to disk.
+% NOTE 1: TestTone assumes that all information regarding the sample rate / time interval in between the samples is handled appropriately. mataa_signal_to_TestToneFile therefore does NOT handle any sample timing information. Only the sample VALUES are written to disk (the sample rate in the header of binary files is for information only).
 %
 % NOTE 2: the data in s should be padded with zeros at the beginning and the end of the signal to avoid problems with sound-I/O latency. If s does not include zeros at the beginning and the end, use the zeroTime option.
 % 
@@ -57,6 +59,10 @@ if strcmp(pathToFile,'')
     pathToFile = mataa_tempfile;
 end
 
+if ~exist('format','var')
+    format = 'text';
+end
+
 if exist('zeroTime','var')
     if ~exist('fs','var')
         error('mataa_signal_to_TestToneFile: need fs to determine number of zeros to be padded the the signal')
@@ -70,23 +76,49 @@ if exist('zeroTime','var')
     s = [ z ; s ; z ];
 end
 
-% open the file for writing:
-fid = fopen(pathToFile,'wt');
-if fid == -1
-    error('mataa_signal_to_TestToneFile: could not open file for writing data.');
+if ~exist('fs','var')
+    fs = 0; % unknown
 end
 
-% write the data to the file:
-format = '';
-for i=1:nChannels
-    if i > 1
-        format = sprintf('%s , ',format); % add a comma
-    end
-    format = sprintf('%s %%0.24g',format);
-end
-format = sprintf('%s\n',format); % add newline character
+switch lower(format)
+    case 'text'
+        % open the file for writing:
+        fid = fopen(pathToFile,'wt');
+        if fid == -1
+            error('mataa_signal_to_TestToneFile: could not open file for writing data.');
+        end
+
+        % write the data to the file:
+        fmt = '';
+        for i=1:nChannels
+            if i > 1
+                fmt = sprintf('%s , ',fmt); % add a comma
+            end
+            fmt = sprintf('%s %%0.24g',fmt);
+        end
+        fmt = sprintf('%s\n',fmt); % add newline character
 
-fprintf(fid,format,s');
+        fprintf(fid,fmt,s');
+
+    case 'binary'
+        % open the file for writing (TestTone uses the native byte order):
+        fid = fopen(pathToFile,'wb','native');
+        if fid == -1
+            error('mataa_signal_to_TestToneFile: could not open file for writing data.');
+        end
+
+        % write the header (see TestTonePA19.c for the format description):
+        fwrite(fid,'MATAAF32','char');
+        fwrite(fid,[32 size(s,2)],'uint32'); % header size, number of channels
+        fwrite(fid,size(s,1),'uint64'); % number of frames
+        fwrite(fid,fs,'float64'); % sample rate
+
+        % write the interleaved samples in one go:
+        fwrite(fid,s','float32');
+
+    otherwise
+        error(sprintf('mataa_signal_to_TestToneFile: unknown file format ''%s''.',format));
+end
 
 % close the file:
 if fclose(fid) == -1
@@ -2,16 +2,52 @@ function mataa_spectrum_analyser( chan_out, chan_in, fx, fs, N_len, N_avg )
 
 % function mataa_spectrum_analyser( chan_out, chan_in, fx, fs, N_len, N_avg )
 %
-% Real-time spectrum analyser (PlayRec only). THIS IS WORK IN PROGRESS!!!
-% 
+% DESCRIPTION:
+% Real-time spectrum analyser. A sine signal with frequency fx is played through the DAC channel(s) chan_out, and the spectra of the signals recorded in the ADC channel(s) chan_in are plotted continuously until the plot window is closed. THIS IS WORK IN PROGRESS!!!
+%
+% With TestTone (mataa_settings('audio_IO_method') = 'TestTone'), the analysis is done by TestTone in spectrum-analyser mode (TestTone -R, not available on Windows): TestTone records continuously, computes overlapping Hann-windowed FFTs of the recorded data, averages the power spectra exponentially, keeps a peak hold, and publishes the spectra to a file that is read here whenever it was updated. The capture therefore does not drop samples if Octave is slow with the plotting. The plot shows the averaged amplitude spectra (solid lines) and the peak hold (dotted lines).
+% With PlayRec (mataa_settings('audio_IO_method') = 'PlayRec'), the data are recorded in PlayRec pages of N_len samples and analysed in Octave.
+%
+% INPUT:
+% chan_out: DAC channel(s) used for the sine signal (row vector)
+% chan_in: ADC channel(s) to be analysed (row vector)
+% fx: frequency of the sine signal (Hz). With TestTone, fx is adjusted slightly to fit an integer number of periods into the signal, which is played in a loop. Use fx = 0 or fx = [] to play silence.
+% fs: sampling rate (Hz)
+% N_len: the FFT size is 2*N_len (N_len is rounded to a power of two)
+% N_avg: number of averaged spectra (time constant of the exponential averaging with TestTone)
+%
+% OUTPUT:
+% (none)
+%
 % EXAMPLE:
 % > mataa_spectrum_analyser( 1, 1, 1000.0, 44100, 1024, 5 )
+%
+% DISCLAIMER:
+% This file is part of MATAA.
+%
+% MATAA is free software; you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation; either version 2 of the License, or
+% (at your option) any later version.
+%
+% MATAA is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with MATAA; if not, write to the Free Software
+% Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+%
+% Copyright (C) 2006, 2007, 2008 Matthias S. Brennwald.
+% Contact: info@audioroot.net
+% Further information: http://www.audioroot.net/MATAA
 
-N_len = 2^(round(log2(N_len)));
-
-pageBufCount = 5;   %number of PlayRec pages of buffering
+if ~exist ('N_avg','var')
+	N_avg = 1;
+end
 
-fftSize = N_len * 2;
+N_len = 2^(round(log2(N_len)));
 
 if((ndims(chan_out)~=2) || (size(chan_out, 1)~=1))
     error ('mataa_spectrum_analyser: chan_out must be a row vector');
@@ -20,88 +56,240 @@ if((ndims(chan_in)~=2) || (size(chan_in, 1)~=1))
     error ('mataa_spectrum_analyser: chan_in must be a row vector');
 end
 
-%Test if current initialisation is ok
-output_ID = mataa_settings ('audio_PlayRec_OutputDevice');
-input_ID  = mataa_settings ('audio_PlayRec_InputDevice');
-if ~mataa_audio_init_playrec(fs, output_ID, input_ID, length(chan_out), length(chan_in));
-	error ('mataa_spectrum_analyser: could not init PlayRec as needed.')
+try
+	audio_IO_method = mataa_settings ('audio_IO_method');
+catch
+	audio_IO_method = 'TestTone';
 end
 
-%Clear all previous pages
-playrec('delPage');
-
-% init plots:
-fig = figure;
-timeAxes = subplot(2,1,1);
-set(timeAxes, 'box', 'on', 'xlimmode', 'manual', 'ylimmode', 'manual', 'xscale', 'linear', 'yscale', 'linear', 'xlim', [1 N_len], 'ylim', [-1, 1]);
-for i=1:length(chan_in)
-    timeLine(i) = line('XData', 1:N_len,'YData', ones(1, N_len));
-end
-fftAxes  = subplot(2,1,2);
-set(fftAxes, 'box', 'on', 'xlimmode', 'manual', 'ylimmode', 'manual', 'xscale', 'log', 'yscale', 'log', 'xlim', [10 fs/2], 'ylim', [1E-6, 100]);
-for i=1:length(chan_in)
-    fftLine(i) = line('XData', (0:(fftSize/2))*fs/fftSize,'YData', ones(1, fftSize/2 + 1));
+if strcmp (upper(audio_IO_method),'PLAYREC')
+	__playrec_analyser ( chan_out, chan_in, fs, N_len );
+else
+	__TestTone_analyser ( chan_out, chan_in, fx, fs, N_len, N_avg );
 end
 
-drawnow;
+endfunction
+
+
+function __TestTone_analyser ( chan_out, chan_in, fx, fs, N_len, N_avg )
+	% spectrum analyser using TestTone -R
+	
+	if strcmp (mataa_computer,'PCWIN')
+		error ('mataa_spectrum_analyser: the TestTone spectrum analyser is not available on Windows.');
+	end
+	
+	fftSize = N_len * 2;
+	base = sprintf ('%s%smataa_spectrum_analyser_%s',tempdir,filesep,getenv('USER'));
+	
+	% the audio device must not be blocked by the TestTone server:
+	mataa_TestTone_server ('stop');
+	
+	% sine signal with an integer number of periods (played in a loop by TestTone):
+	in_path = '';
+	if ~isempty (fx) && fx > 0
+		n = max (1,round(fx)); % number of periods in about one second
+		L = round (n*fs/fx);
+		fx = n*fs/L;
+		in_path = mataa_signal_to_TestToneFile (0.5*sin(2*pi*fx/fs*[0:L-1]'),'',0,fs,'binary');
+		disp (sprintf('Sine frequency: %g Hz',fx));
+	end
+	
+	% start the analyser:
+	chanlist = @(c) strjoin (arrayfun(@num2str,c,'UniformOutput',false),',');
+	TestTone = sprintf ('%s%s',mataa_path('TestTone'),'TestTonePA19');
+	__delete_if_exists ([base '.spc']);
+	__delete_if_exists ([base '.pid']);
+	system (sprintf('"%s" -R "%s" -c %s -C %s -F %i -A %i -e %s %s > /dev/null 2>&1 &',TestTone,base,chanlist(chan_in),chanlist(chan_out),fftSize,N_avg,num2str(fs),in_path)); % the ' are needed in case the paths contain spaces
+	k = 0;
+	while ~exist ([base '.pid'],'file') && k < 100
+		pause (0.05); k = k+1;
+	end
+	pid = [];
+	fid = fopen ([base '.pid'],'rt');
+	if fid ~= -1
+		pid = fscanf (fid,'%f',1);
+		fclose (fid);
+	end
+	if isempty (pid)
+		error ('mataa_spectrum_analyser: could not start the TestTone spectrum analyser (does your TestTone binary support the -R option?).');
+	end
+	
+	% init plot:
+	fig = figure;
+	f = [0:fftSize/2]' * fs / fftSize;
+	fftAxes = axes;
+	set(fftAxes, 'box', 'on', 'xlimmode', 'manual', 'ylimmode', 'manual', 'xscale', 'log', 'yscale', 'log', 'xlim', [10 fs/2], 'ylim', [1E-7, 1]);
+	xlabel ('Frequency (Hz)'); ylabel ('Amplitude (digital)');
+	for i=1:length(chan_in)
+		fftLine(i) = line('XData', f, 'YData', ones(size(f)));
+		peakLine(i) = line('XData', f, 'YData', ones(size(f)), 'LineStyle', ':', 'Color', get(fftLine(i),'Color'));
+	end
+	drawnow;
+	
+	disp('SPECTRUM ANALYSER IS RUNNING -- CLOSE PLOT WINDOW TO STOP!')
+	
+	numSpectra = -1;
+	while ishandle (fig)
+		[A,P,info] = __read_spectrum ([base '.spc']);
+		if ~isempty (A) && info.numSpectra ~= numSpectra % new spectrum
+			numSpectra = info.numSpectra;
+			for i=1:length(chan_in)
+				set(fftLine(i), 'YData', max(A(:,i),1E-12));
+				set(peakLine(i), 'YData', max(P(:,i),1E-12));
+			end
+			u = sprintf ('Average of %i spectra (t = %.1f s)',info.numAveraged,info.time);
+			if info.dropped
+				u = [ u ' -- SAMPLES WERE LOST!' ];
+			end
+			title (fftAxes,u);
+		end
+		drawnow;
+		pause (0.05);
+	end
+	
+	% stop the analyser:
+	kill (pid,15); % SIGTERM
+	k = 0;
+	while exist ([base '.pid'],'file') && k < 50
+		pause (0.1); k = k+1;
+	end
+	__delete_if_exists ([base '.spc']);
+	if ~isempty (in_path)
+		delete (in_path);
+	end
+endfunction
+
 
-recSampleBuffer = zeros(fftSize, length(chan_in));
+function [A,P,info] = __read_spectrum (path)
+	% read the spectrum file written by TestTone -R (format see ttSpectrum.h). A: averaged amplitude spectra, P: peak hold (one column per channel)
+	A = []; P = []; info = [];
+	fid = fopen (path,'rb','native');
+	if fid == -1 % not written yet
+		return
+	end
+	magic = char (fread(fid,8,'char')');
+	if ~strcmp (magic,'MATAASPC')
+		fclose (fid);
+		return
+	end
+	headerSize       = fread (fid,1,'uint32');
+	nc               = fread (fid,1,'uint32');
+	nb               = fread (fid,1,'uint64');
+	info.fs          = fread (fid,1,'float64');
+	info.fftSize     = fread (fid,1,'uint32');
+	info.hop         = fread (fid,1,'uint32');
+	info.numSpectra  = fread (fid,1,'uint64');
+	info.numAveraged = fread (fid,1,'uint32');
+	info.dropped     = fread (fid,1,'uint32');
+	info.time        = fread (fid,1,'float64');
+	fseek (fid,headerSize,'bof');
+	A = fread (fid,[nc,nb],'float32=>double')';
+	P = fread (fid,[nc,nb],'float32=>double')';
+	fclose (fid);
+	if size (P,1) < nb
+		A = []; P = [];
+	end
+endfunction
 
-% Create vector to act as FIFO for page numbers
-pageNumList = repmat(-1, [1 pageBufCount]);
 
-firstTimeThrough = true;
+function __delete_if_exists (f)
+	if exist (f,'file')
+		delete (f);
+	end
+endfunction
 
-window = hanning(fftSize);
 
-disp('SPECTRUM ANALYSER IS RUNNING -- CLOSE PLOT WINDOW TO STOP!')
+function __playrec_analyser ( chan_out, chan_in, fs, N_len )
+	% spectrum analyser using PlayRec pages, analysed in Octave
 
-while ishandle(fig)
-    pageNumList = [pageNumList playrec('rec', N_len, chan_in)];
+	pageBufCount = 5;   %number of PlayRec pages of buffering
 
-    if(firstTimeThrough)
-        %This is the first time through so reset the skipped sample count
-        playrec('resetSkippedSampleCount');
-        firstTimeThrough = false;
-    else
-        if(playrec('getSkippedSampleCount'))
-            fprintf('%d samples skipped!!\n', playrec('getSkippedSampleCount'));
-            %return
-            %Let the code recover and then reset the count
-            firstTimeThrough = true;
-        end
-    end
-    playrec('block', pageNumList(1));
+	fftSize = N_len * 2;
+
+	%Test if current initialisation is ok
+	output_ID = mataa_settings ('audio_PlayRec_OutputDevice');
+	input_ID  = mataa_settings ('audio_PlayRec_InputDevice');
+	if ~mataa_audio_init_playrec(fs, output_ID, input_ID, length(chan_out), length(chan_in));
+		error ('mataa_spectrum_analyser: could not init PlayRec as needed.')
+	end
+
+	%Clear all previous pages
+	playrec('delPage');
+
+	% init plots:
+	fig = figure;
+	timeAxes = subplot(2,1,1);
+	set(timeAxes, 'box', 'on', 'xlimmode', 'manual', 'ylimmode', 'manual', 'xscale', 'linear', 'yscale', 'linear', 'xlim', [1 N_len], 'ylim', [-1, 1]);
+	for i=1:length(chan_in)
+	    timeLine(i) = line('XData', 1:N_len,'YData', ones(1, N_len));
+	end
+	fftAxes  = subplot(2,1,2);
+	set(fftAxes, 'box', 'on', 'xlimmode', 'manual', 'ylimmode', 'manual', 'xscale', 'log', 'yscale', 'log', 'xlim', [10 fs/2], 'ylim', [1E-6, 100]);
+	for i=1:length(chan_in)
+	    fftLine(i) = line('XData', (0:(fftSize/2))*fs/fftSize,'YData', ones(1, fftSize/2 + 1));
+	end
+
+	drawnow;
+
+	recSampleBuffer = zeros(fftSize, length(chan_in));
+
+	% Create vector to act as FIFO for page numbers
+	pageNumList = repmat(-1, [1 pageBufCount]);
+
+	firstTimeThrough = true;
+
+	window = hanning(fftSize);
+
+	disp('SPECTRUM ANALYSER IS RUNNING -- CLOSE PLOT WINDOW TO STOP!')
+
+	while ishandle(fig)
+	    pageNumList = [pageNumList playrec('rec', N_len, chan_in)];
+
+	    if(firstTimeThrough)
+	        %This is the first time through so reset the skipped sample count
+	        playrec('resetSkippedSampleCount');
+	        firstTimeThrough = false;
+	    else
+	        if(playrec('getSkippedSampleCount'))
+	            fprintf('%d samples skipped!!\n', playrec('getSkippedSampleCount'));
+	            %return
+	            %Let the code recover and then reset the count
+	            firstTimeThrough = true;
+	        end
+	    end
+	    playrec('block', pageNumList(1));
    
-    lastRecording = playrec('getRec', pageNumList(1));
-    if(~isempty(lastRecording))
-        %very basic processing - windowing would produce a better output
-        recSampleBuffer = [recSampleBuffer(length(lastRecording) + 1:end, :); lastRecording];
-
-	% do some processing to give better spectrum:
-	%%%% recSampleBuffer = recSampleBuffer - mean (recSampleBuffer);
-	recSampleBuffer = detrend(recSampleBuffer,1);
-	recSampleBuffer = recSampleBuffer .* window;
-
-        recFFT = fft(recSampleBuffer)';
-
-	% subplot(2,1,1)
-        for i=1:length(chan_in)
-                set(timeLine(i), 'YData', lastRecording(:,i));
-        end
-	% subplot(2,1,2)
-        for i=1:length(chan_in)
-		%% set(fftLine(i), 'YData', 20*log10(abs(recFFT(i, 1:fftSize/2 + 1))));
-		set(fftLine(i), 'YData', abs(recFFT(i, 1:fftSize/2 + 1)));
-        end
-    end
-
-    drawnow;
+	    lastRecording = playrec('getRec', pageNumList(1));
+	    if(~isempty(lastRecording))
+	        %very basic processing - windowing would produce a better output
+	        recSampleBuffer = [recSampleBuffer(length(lastRecording) + 1:end, :); lastRecording];
+
+		% do some processing to give better spectrum:
+		%%%% recSampleBuffer = recSampleBuffer - mean (recSampleBuffer);
+		recSampleBuffer = detrend(recSampleBuffer,1);
+		recSampleBuffer = recSampleBuffer .* window;
+
+	        recFFT = fft(recSampleBuffer)';
+
+		% subplot(2,1,1)
+	        for i=1:length(chan_in)
+	                set(timeLine(i), 'YData', lastRecording(:,i));
+	        end
+		% subplot(2,1,2)
+	        for i=1:length(chan_in)
+			%% set(fftLine(i), 'YData', 20*log10(abs(recFFT(i, 1:fftSize/2 + 1))));
+			set(fftLine(i), 'YData', abs(recFFT(i, 1:fftSize/2 + 1)));
+	        end
+	    end
+
+	    drawnow;
     
-    playrec('delPage', pageNumList(1));
-    %pop page number from FIFO
-    pageNumList = pageNumList(2:end);
-end
+	    playrec('delPage', pageNumList(1));
+	    %pop page number from FIFO
+	    pageNumList = pageNumList(2:end);
+	end
     
-%delete all pages now loop has finished
-playrec('delPage');
+	%delete all pages now loop has finished
+	playrec('delPage');
+
+endfunction